@@ -0,0 +1,23 @@
+/**
+  ******************************************************************************
+  * @file    CtlCoef.h
+  * @brief   Voltage loop coefficients, written by Host/tools/coefgen.py.
+  *
+  *          coefgen.py --coef 5203 -10246 5044 0
+  *          Given coefficients, checked on L 22.0uH, C 470uF, ESR 10mohm, RL 30mohm, Rload 12.0ohm, Vin 18:30V
+  *          Predicted loop at fsw 100kHz, one period delay:
+  *            Vin  18.0V  fc     54Hz  PM 118.5deg  GM  27.5dB
+  *            Vin  24.0V  fc     78Hz  PM 129.8deg  GM  25.0dB
+  *            Vin  30.0V  fc    113Hz  PM 144.2deg  GM  23.1dB
+  *          int32 range: |u0| <= 85529222, 4 bits spare
+  ******************************************************************************
+  */
+#ifndef __CTLCOEF_H
+#define __CTLCOEF_H
+
+#define BUCKPIDb0	5203		//Q8 duty per Q12 error code
+#define BUCKPIDb1	-10246		//Q8
+#define BUCKPIDb2	5044		//Q8
+#define BUCKPIDa	0			//Q10, second pole, 0 for the PID form
+
+#endif
@@ -3,11 +3,44 @@
 
 #include "stm32g4xx_it.h"
 #include "function.h"
+#include "burst.h"
 
 void BUCKVLoopCtlPID(void);
 
+// 1: four-switch buck-boost HRTIM layout, Control_Period() runs the voltage
+// loop with its burst mode and pulse skipping every period. MX_HRTIM1_Init()
+// on this board sets up the 50% bridge, whose outputs the loop's CMP1 writes
+// do not drive, so it is off here; the host plant is a buck-boost stage and
+// builds with it. Needs ADC_VOUT_SENSE.
+#ifndef VLOOP_BUCKBOOST
+#define VLOOP_BUCKBOOST	0
+#endif
+#if VLOOP_BUCKBOOST && !ADC_VOUT_SENSE
+#error "VLOOP_BUCKBOOST regulates on Vout and switches modes on Iout: set ADC_VOUT_SENSE"
+#endif
+
+// 1: Control_Period() runs the voltage loop through VLoopHook, which the
+// host bench points at each compensator it compares. Host builds only, the
+// firmware calls BUCKVLoopCtlPID() directly.
+#ifndef VLOOP_HOOK
+#define VLOOP_HOOK	0
+#endif
+#if VLOOP_HOOK
+extern void (*VLoopHook)(void);
+#define VLOOP_RUN()	VLoopHook()
+#else
+#define VLOOP_RUN()	BUCKVLoopCtlPID()
+#endif
+
 extern int32_t  VErr0,VErr1,VErr2;
-extern int32_t	u0,u1;
+extern int32_t	u0,u1,u2;
+
+//Lowest loop output, Q8 duty: pulse skipping covers the duties below MIN_BUKC_DUTY
+#if PFM_ENABLE
+#define VLOOP_U_MIN	0
+#else
+#define VLOOP_U_MIN	(MIN_BUKC_DUTY << 8)
+#endif
 
 
 //һ 
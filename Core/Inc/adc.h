@@ -35,12 +35,25 @@ extern "C" {
 extern ADC_HandleTypeDef hadc1;
 
 /* USER CODE BEGIN Private defines */
-
+// Vout and Iout sense. main.h names PA2/PA3 ADCVout/ADCIout, but on this
+// board they carry USART2, so the scan converts only PA0 and PA1 and
+// ADC1_RESULT[2]/[3] stay 0. The loops and protections that work on Vout
+// and Iout are built only with the sense wired to ADC1_IN3/IN4 and USART2
+// moved off PA2/PA3.
+#ifndef ADC_VOUT_SENSE
+#define ADC_VOUT_SENSE	0
+#endif
+#if ADC_VOUT_SENSE
+#define ADC_RANKS		4	// Vin, Iin, Vout, Iout, one scan per HRTIM trigger
+#else
+#define ADC_RANKS		2	// Vin (potentiometer), Iin
+#endif
 /* USER CODE END Private defines */
 
 void MX_ADC1_Init(void);
 
 /* USER CODE BEGIN Prototypes */
+HAL_StatusTypeDef ADC1_StartScan(uint16_t *buf);
 
 /* USER CODE END Prototypes */
 
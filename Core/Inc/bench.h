@@ -0,0 +1,33 @@
+#ifndef __BENCH_H
+#define __BENCH_H
+
+#include "main.h"
+
+// Set to 1 to run the hot path benchmark at boot and print it on USART2
+#define BENCH_ENABLE	0
+
+#define BENCH_CALLS		64	// Timed calls per item
+
+/***************************** Items *****************/
+#define BENCH_ADC		0	// ADCSample()
+#define BENCH_VLOOP		1	// BUCKVLoopCtlPID()
+#define BENCH_FAULT		2	// Fault_Sample()
+#define BENCH_SETP		3	// Setp_Apply(), empty queue
+#define BENCH_ISR		4	// Control_Period(), the control ISR body
+#define BENCH_PROT		5	// Protect_Task(), protection checks
+#define BENCH_FMT		6	// OLED_ShowFix(), display number formatter
+#define BENCH_NUM		7
+
+struct _BENCH
+{
+	uint32_t	Min;//Cycles per call
+	uint32_t	Max;//Cycles per call
+	uint32_t	Sum;//Cycles of all calls, for the mean
+};
+
+extern struct _BENCH Bench[BENCH_NUM];
+
+void Bench_Run(void);
+uint8_t Bench_Format(uint8_t line, char *buf);
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef __BLACKBOX_H
+#define __BLACKBOX_H
+
+#include "main.h"
+
+#define BB_MAGIC	0xB1ACB0C5	// Record valid marker
+#define BB_DEPTH	64			// Control-cycle snapshots kept, must be a power of two
+
+/***************************** Record source *****************/
+#define BB_SRC_NONE			0	// No fault pending
+#define BB_SRC_ERROR		1	// Error_Handler()
+#define BB_SRC_NMI			2	// BB_NMI_Handler(), the NMI vector
+#define BB_SRC_HARDFAULT	3	// BB_HardFault_Handler()
+#define BB_SRC_MEMMANAGE	4	// BB_MemManage_Handler(), enabled by BlackBox_Init()
+#define BB_SRC_BUSFAULT		5	// BB_BusFault_Handler(), likewise
+#define BB_SRC_USAGEFAULT	6	// BB_UsageFault_Handler(), likewise
+
+// Return address of the calling function, used by Error_Handler()
+#if defined(__CC_ARM)
+#define BB_RETURN_ADDR()	((uint32_t)__return_address())
+#else
+#define BB_RETURN_ADDR()	((uint32_t)(uintptr_t)__builtin_return_address(0))
+#endif
+
+// One control-cycle snapshot
+struct _BB_SNAP
+{
+	uint32_t	Tick;//HAL tick (ms) at sample time
+	uint16_t	Adc[4];//Raw ADC1_RESULT codes
+	uint16_t	Per;//Timer A period
+	uint16_t	TaCmp1;//Timer A compare 1
+	uint16_t	TaCmp2;//Timer A compare 2
+	uint16_t	TbCmp1;//Timer B compare 1
+	uint16_t	SMFlag;//State machine flag
+	uint16_t	ErrFlag;//Fault flag
+};
+
+// Fault context captured by Error_Handler() or the fault handlers
+struct _BB_FAULT
+{
+	uint32_t	Source;//BB_SRC_xxx
+	uint32_t	PC;//Stacked PC, or Error_Handler() caller
+	uint32_t	LR;//Stacked LR
+	uint32_t	PSR;//Stacked xPSR
+	uint32_t	SP;//Stack pointer before exception entry
+	uint32_t	CFSR;//Configurable fault status
+	uint32_t	HFSR;//Hard fault status
+	uint32_t	MMFAR;//MemManage fault address
+	uint32_t	BFAR;//Bus fault address
+	uint32_t	Check;//Checksum over the fields above
+};
+
+struct _BLACKBOX
+{
+	uint32_t	Magic;//BB_MAGIC once initialised
+	uint32_t	BootCnt;//Boots since the record was created
+	uint32_t	Head;//Free-running write index into Snap[]
+	uint32_t	Frozen;//Set once a fault was captured, stops recording
+	struct _BB_FAULT	Fault;
+	struct _BB_SNAP		Snap[BB_DEPTH];
+};
+
+extern struct _BLACKBOX BlackBox;
+
+void BlackBox_Init(void);
+void BlackBox_Record(void);
+void BlackBox_Error(uint32_t caller);
+void BlackBox_Fault(uint32_t *frame, uint32_t source);
+void BlackBox_Report(void);
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef __BURST_H
+#define __BURST_H
+
+#include "main.h"
+
+// Both act only where Control_Period() runs the duty loop, VLOOP_BUCKBOOST in CtlLoop.h
+// Set to 0 to switch continuously down to no load
+#define BURST_ENABLE	1
+// Set to 0 to hold the loop at MIN_BUKC_DUTY instead of skipping pulses below it
+#define PFM_ENABLE		1
+
+/***************************** Thresholds *****************/
+#define BURST_IOUT_ENTER	2141	// Q12 IoutAvg below which the loop goes to burst mode, 0.3A, 2048 = 0A
+#define BURST_IOUT_EXIT		2203	// Q12 IoutAvg above which it leaves, 0.5A
+#define BURST_ENTER_CNT		1000	// Control periods below BURST_IOUT_ENTER before entering, 10ms
+#define BURST_VBAND			20		// Q12 Vout above Voref that starts an idle burst, about 1%
+#define BURST_VDROP			60		// Q12 Vout below Voref that leaves burst mode, about 3%
+#define BURST_DUTY_UP		48		// Q12 buck duty added to the loop output between bursts, lifts Vout into the band
+#define BURST_IDLE			20		// PWM periods the outputs idle per burst
+#define PFM_DUTY			160		// Q12 buck duty of each pulse when skipping, the loop goes back to PWM above it
+
+struct _BURST
+{
+	uint8_t		Active;//1 in burst mode
+	uint16_t	Cnt;//Light-load periods towards BURST_ENTER_CNT
+	uint32_t	Entries;//Times burst mode was entered
+	uint32_t	Bursts;//Idle bursts started
+	uint32_t	Periods;//Control periods in burst mode
+	uint32_t	Idle;//Of those, periods with the burst controller running
+	uint8_t		Pfm;//1 while skipping pulses
+	int32_t		PfmAcc;//Q8 loop output summed since the last pulse
+	uint32_t	PfmEntries;//Times pulse skipping was entered
+	uint32_t	Skips;//Periods skipped
+};
+
+extern struct _BURST Burst;
+
+void Burst_Init(void);
+uint8_t Burst_Step(int32_t err);
+uint8_t Burst_Pfm(int32_t u);
+uint8_t Burst_Format(uint8_t line, char *buf);
+
+#endif
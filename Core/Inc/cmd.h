@@ -0,0 +1,12 @@
+#ifndef __CMD_H
+#define __CMD_H
+
+#include "main.h"
+
+#define CMD_RX_LEN		64	// Received bytes in flight, must be a power of two
+#define CMD_LINE_LEN	32	// Longest command line, longer ones are refused
+
+void Cmd_Init(void);
+void Cmd_Task(void);
+
+#endif
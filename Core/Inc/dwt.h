@@ -0,0 +1,22 @@
+#ifndef __DWT_H
+#define __DWT_H
+
+#include "main.h"
+
+// Core clock cycles, free running, wraps every 2^32 / 100MHz = 42.9s
+#define DWT_CYCLES()	(DWT->CYCCNT)
+
+/** ===================================================================
+**     Function Name : void DWT_Init(void)
+**     Description : Enable the DWT cycle counter. Safe to call more than
+**       once, the counter keeps running.
+**     Parameters  :
+**     Returns     :
+** ===================================================================*/
+static __inline void DWT_Init(void)
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef __FAULT_H
+#define __FAULT_H
+
+#include "main.h"
+
+/***************************** Event types *****************/
+#define FLT_EV_VOUT_PEAK	1	// A Vout sample went above VOUT_OVP_VAL
+#define FLT_EV_IOUT_PEAK	2	// An Iout sample went above IOUT_OCP_VAL
+#define FLT_EV_SETP_REJECT	3	// The control ISR refused a setpoint, Value = SETP_xxx
+#define FLT_EV_NUM			4
+
+#define FLT_PEAK_HYST	64		// Q12 drop below the threshold that re-arms a peak event
+#define FLT_QUEUE_LEN	16		// Events in flight, must be a power of two
+
+struct _FLT_EVENT
+{
+	uint8_t		Type;//FLT_EV_xxx
+	uint16_t	Value;//Sample or setpoint type
+	uint32_t	Tick;//HAL tick (ms) of the event
+};
+
+void Fault_Post(uint8_t type, uint16_t value);
+void Fault_Sample(void);
+void Fault_Poll(void);
+uint8_t Fault_Format(uint8_t line, char *buf);
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef __FM_H
+#define __FM_H
+
+#include "main.h"
+
+/***************************** Frequency range *****************/
+#define FM_FREQ_MIN		70000	// Hz, the longest period the loop may set
+#define FM_FREQ_MAX		130000	// Hz, the shortest period, where the loop starts
+#define FM_FREQ_START	100000	// Hz, the period written by Fm_Start() until the first step
+
+/***************************** Compensator *****************/
+// Incremental PI from Q12 Vout error to Q8 period counts at MUL8. Above
+// resonance the gain falls with frequency: Vout low, period longer.
+#define FM_KP			64		// Q8 counts per Q12 error step
+#define FM_KI			16		// Q8 counts per Q12 error per control period
+#define FM_SLEW			8		// Counts the period may move per control period, 6.6ms over the range
+
+struct _FM
+{
+	uint8_t		Active;//1 while the voltage loop sets the frequency
+	uint16_t	PerMin;//Period at FM_FREQ_MAX, counts at MUL8
+	uint16_t	PerMax;//Period at FM_FREQ_MIN
+	uint16_t	Per;//Period last written
+	int32_t		U;//Compensator output, Q8 counts
+	int32_t		Err1;//Previous error, Q12
+	uint32_t	SlewCnt;//Steps the slew limit held the period back
+};
+
+extern struct _FM Fm;
+
+HAL_StatusTypeDef Fm_Start(void);
+void Fm_Stop(void);
+void Fm_Step(void);
+uint32_t Fm_FreqHz(void);
+
+#endif
@@ -14,6 +14,7 @@ extern uint16_t OLEDShowCnt;
 
 //
 void ADCSample(void);
+void Control_Period(void);
 void StateM(void);
 void StateMInit(void);
 void StateMWait(void);
@@ -33,24 +34,30 @@ void BBMode(void);
 void OLEDShow(void);
 void MX_OLED_Init(void);
 
-uint8_t Key_Scan(GPIO_TypeDef* GPIOx,uint16_t GPIO_Pin);
 void Button_Task(void);
+void Protect_Task(void);
+void SoftStart_Task(void);
+void Display_Task(void);
 HAL_StatusTypeDef Set_HRTIM_CompareValue(uint32_t D1,uint32_t D2,uint32_t T1,uint32_t T2);
 HAL_StatusTypeDef SetPWMFrequency(uint32_t req_tim_freq);
+HAL_StatusTypeDef RequestPWMFrequency(uint32_t req_tim_freq);
 void SetDeadTimeManual(uint8_t dead_time_percent);
+uint8_t RequestDeadTime(uint8_t dead_time_px10);
 HAL_StatusTypeDef SetDutyCycle_TA1_TB1(uint8_t duty_percent);
 HAL_StatusTypeDef SetDutyCycle_TA2_TB2(uint8_t duty_percent);
 
 void UpdateDisplay(void); // sWƭ쫬
 void Mode_Switch(void);    // sWƭ쫬
 void Open_Mode_Init(void);
-void DisplayDutyCycle(float duty_percent);
-void DisplayDeadTime(float dead_time_percent);
-void UpdateHRTIM(int period, int half_period, int duty_cycle, int dead_time);
+void DisplayDutyCycle(uint16_t duty_px10);
+void DisplayDeadTime(uint16_t dead_time_px10);
+HAL_StatusTypeDef UpdateHRTIM(int period, int half_period, int duty_cycle, int dead_time);
 
 // ŧib function.c wqܼ
 extern volatile float currentPWMFreq;        
+extern volatile uint32_t currentPWMFreqHz;
 extern volatile uint32_t currentPLLFreq;   
+extern HRTIM_TimeBaseCfgTypeDef pGlobalTimeBaseCfg;
 
 
 /**********************************************/
@@ -62,6 +69,15 @@ extern volatile uint32_t currentPLLFreq;
 #define     F_SW_IOUT_OCP    	0x0010//
 #define     F_SW_SHORT  			0x0020//·
 
+#define VOUT_OVP_VAL	3600//Q12 Vout over-voltage threshold
+#define IOUT_OCP_VAL	3600//Q12 Iout over-current threshold, 2048 = 0A
+#define PROT_TRIP_CNT	10//Protection task runs over the threshold before tripping
+#define IOUT_SHORT_VAL	4050//Q12 Iout short-circuit threshold, near the top of the ADC range
+#define SHORT_TRIP_CNT	3//Control periods in a row over IOUT_SHORT_VAL before tripping
+#define VOUT_REF_SET	2048//Q12 Voref at the end of soft-start
+#define SS_WAIT_CNT		10//Soft-start task runs without fault before the ramp
+#define SS_STEP			(VOUT_REF_SET / 50)//Voref step per soft-start task run, 0.5s ramp
+
 #define MIN_BUKC_DUTY	80//BUCKСռձ
 #define MAX_BUCK_DUTY 3809//BUCKռձȣ93%*Q12
 #define	MAX_BUCK_DUTY1 3277//MIXģʽ BUCK̶ռձ80%
@@ -70,6 +86,15 @@ extern volatile uint32_t currentPLLFreq;
 #define MAX_BOOST_DUTY	2662//ռձ 65%ռձ
 #define MAX_BOOST_DUTY1	3809//BUCKռձȣ93%*Q12
 
+// Dead time parameters (Unit: 0.1%, each step adjusts by 0.1%)
+#define DEADTIME_MIN_PX1000 1     // 0.1%, at 0 CMP2 meets the period reset and TA1 stays on
+#define DEADTIME_MAX_PX1000 50    // 5.0%
+#define DEADTIME_STEP_PX1000 1    // 0.1%
+
+// Timer A/B period limits, HRTIM counts
+#define CNTR_MIN 1000
+#define CNTR_MAX 16000
+
 #define KEY_ON	1
 #define KEY_OFF	0
 
@@ -157,5 +182,11 @@ typedef enum
 #define getReg(reg)           	(reg)
 
 #define CCMRAM  __attribute__((section("ccmram")))
+//Not cleared by the C library at reset, placed in the UNINIT region of the scatter file
+#if defined(__CC_ARM)
+#define NOINIT  __attribute__((section(".bss.NoInit"), zero_init))
+#else
+#define NOINIT  __attribute__((section(".bss.NoInit")))
+#endif
 
 #endif
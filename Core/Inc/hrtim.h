@@ -35,6 +35,9 @@ extern "C" {
 extern HRTIM_HandleTypeDef hhrtim1;
 
 /* USER CODE BEGIN Private defines */
+// ADC1 scan trigger: Timer A CMP3, a quarter period in, the middle of the
+// TA1 pulse. Every writer of the Timer A period moves it along.
+#define HRTIM_ADC_POINT(per)	((per) / 4)
 
 /* USER CODE END Private defines */
 
@@ -0,0 +1,33 @@
+#ifndef __JITTER_H
+#define __JITTER_H
+
+#include "main.h"
+
+// Set to 1 to record the control ISR entry jitter and print it with the telemetry
+#define JITTER_PROBE	0
+
+#define JIT_BINS		16	// Histogram bins
+#define JIT_BIN_CYC		4	// Cycles per bin, bins centred on zero jitter
+
+#if JITTER_PROBE
+#define JITTER_SAMPLE()	Jitter_Sample()
+#else
+#define JITTER_SAMPLE()
+#endif
+
+struct _JITTER
+{
+	uint32_t	Last;//DWT cycles at the previous ISR entry
+	uint32_t	Nom;//Nominal interval at the previous entry, cycles
+	uint32_t	Cnt;//Intervals recorded
+	int32_t		Min;//Smallest interval minus nominal, cycles
+	int32_t		Max;//Largest interval minus nominal, cycles
+	uint32_t	Hist[JIT_BINS];//Intervals per jitter bin, outer bins collect the tails
+};
+
+extern struct _JITTER Jitter;
+
+void Jitter_Sample(void);
+uint8_t Jitter_Format(uint8_t line, char *buf);
+
+#endif
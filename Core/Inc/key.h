@@ -0,0 +1,42 @@
+#ifndef __KEY_H
+#define __KEY_H
+
+#include "main.h"
+
+/***************************** Key IDs *****************/
+#define KEY_INC_FREQ	0	// KEY1/PA6
+#define KEY_DEC_FREQ	1	// KEY2/PA7
+#define KEY_INC_DT		2	// KEY3/PB4
+#define KEY_DEC_DT		3	// KEY4/PB5
+#define KEY_INC_DUTY	4	// KEY5/PB6
+#define KEY_DEC_DUTY	5	// KEY6/PB7
+#define KEY_SWITCH_MODE	6	// KEY7/PB9
+#define KEY_NUM			7
+
+/***************************** Event types *****************/
+#define KEY_EV_PRESS	1	// Debounced press
+#define KEY_EV_LONG		2	// Held for KEY_LONG_MS, sent once
+#define KEY_EV_REPEAT	3	// Auto-repeat while held after KEY_EV_LONG
+
+/***************************** Timing *****************/
+#define KEY_TICK_HZ		2000	// Key_Tick() call rate, TIM2 update
+#define KEY_SCAN_DIV	10		// Ticks per scan, 5ms
+#define KEY_SCAN_MS		(1000 * KEY_SCAN_DIV / KEY_TICK_HZ)
+#define KEY_LONG_MS		500		// Hold time until KEY_EV_LONG
+#define KEY_REP_MS		200		// First auto-repeat interval
+#define KEY_REP_MIN_MS	20		// Auto-repeat interval after acceleration
+
+#define KEY_QUEUE_LEN	16		// Event queue depth, must be a power of two
+
+struct _KEY_EVENT
+{
+	uint8_t		Key;//KEY_xxx
+	uint8_t		Type;//KEY_EV_xxx
+	uint16_t	Rep;//Repeats sent so far in this hold, 0 for press/long
+};
+
+void Key_Init(void);
+void Key_Tick(void);
+uint8_t Key_GetEvent(struct _KEY_EVENT *ev);
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef __LOAD_H
+#define __LOAD_H
+
+#include "main.h"
+#include "dwt.h"
+
+struct _LOAD
+{
+	uint32_t	IdleCyc;//DWT cycles counted across WFI in this window
+	volatile uint32_t	IsrCyc;//DWT cycles in the timed ISRs in this window
+	uint32_t	WinCyc;//DWT cycles at the start of the window
+	uint32_t	WinTick;//Scheduler tick at the start of the window
+	uint16_t	Load;//CPU load of the last window, 0.1%
+	uint16_t	Peak;//Highest Load since boot, 0.1%
+	uint16_t	Isr;//Timed ISR share of the last window, 0.1%
+	uint16_t	Thread;//Thread share of the last window, 0.1%
+};
+
+extern struct _LOAD Load;
+
+// Time an ISR body, both in the same block. Nested timed ISRs are not counted twice.
+#define LOAD_ISR_ENTER()	uint32_t LoadT0 = DWT_CYCLES(), LoadI0 = Load.IsrCyc
+#define LOAD_ISR_EXIT()		Load.IsrCyc = LoadI0 + (DWT_CYCLES() - LoadT0)
+
+void Load_Init(void);
+void Load_Idle(void);
+void Load_Task(void);
+uint8_t Load_Format(uint8_t line, char *buf);
+
+#endif
@@ -98,6 +98,13 @@ void Error_Handler(void);
 
 
 
+
+/* Interrupt preemption priorities, NVIC_PRIORITYGROUP_4, 0 is the highest */
+#define IRQ_PRIO_CONTROL	0	// HRTIM timer A: control ISR
+#define IRQ_PRIO_FAULT		1	// ADC1 overrun / watchdog
+#define IRQ_PRIO_DMA		2	// DMA1 channels: ADC1, I2C3 and USART2 transfers
+#define IRQ_PRIO_TICK		3	// TIM2: key scan and scheduler tick
+#define IRQ_PRIO_COMM		4	// USART2, I2C3
 /* USER CODE END Private defines */
 
 #ifdef __cplusplus
@@ -0,0 +1,24 @@
+#ifndef __MEMMON_H
+#define __MEMMON_H
+
+#include "main.h"
+
+#define MEM_PAINT		0xC5C5C5C5	// Fill pattern of the unused stack
+#define MEM_PAINT_GAP	64			// Bytes below the SP left unpainted in Mem_Init()
+
+struct _MEM
+{
+	uint32_t	StackBase;//Lowest address of the MSP stack
+	uint32_t	StackSize;//Stack size, bytes
+	uint32_t	StackPeak;//Deepest stack use seen, bytes
+	uint32_t	HeapSize;//C library heap size, bytes
+	uint32_t	RamUsed;//Static RAM, .data + .bss incl. stack and heap, bytes
+};
+
+extern struct _MEM Mem;
+
+void Mem_Init(void);
+void Mem_Task(void);
+uint8_t Mem_Format(uint8_t line, char *buf);
+
+#endif
@@ -10,7 +10,15 @@
 #define COM				0x00  // OLED ָֹ޸ģ
 #define DAT 			0x40  // OLED ݣֹ޸ģ
 
-void WriteCmd(unsigned char I2C_Command);//д
+#define OLED_WIDTH		128  // Panel columns
+#define OLED_PAGES		8    // Panel pages of 8 rows each
+#define OLED_FIX_MAXCH	12   // Widest OLED_ShowFix() field
+
+// Set to 1 to print the number rendering benchmark on USART2 at boot
+#define OLED_FMT_BENCH	0
+
+extern uint8_t OLED_GRAM[OLED_PAGES][OLED_WIDTH];
+
 void WriteDat(unsigned char I2C_Data);//д
 void OLED_Init(void);//ʼ
 void OLED_SetPos(unsigned char x, unsigned char y);
@@ -18,13 +26,17 @@ void OLED_Fill(unsigned char fill_Data);//ȫ
 void OLED_CLS(void);
 void OLED_ON(void);
 void OLED_OFF(void);
+void OLED_Refresh(void);//Send the changed parts of the frame buffer to the panel
+void OLED_MarkDirty(u8 page,u8 x0,u8 x1);
 void OLED_ShowStr(unsigned char x, unsigned char y, unsigned char ch[], unsigned char TextSize);//ʾַ
 void OLED_ShowCN(unsigned char x, unsigned char y, unsigned char N);//ʾ
 void OLED_DrawBMP(unsigned char x0,unsigned char y0,unsigned char x1,unsigned char y1,unsigned char BMP[]);//ʾͼƬ
 
 void OLED_ShowChar(u8 x,u8 y,u8 chr,u8 Char_Size);
-u32 oled_pow(u8 m,u8 n);
+void OLED_PutChar(u8 x,u8 y,u8 chr,u8 size);//size 1:6*8, 2:8*16
 void OLED_ShowNum(u8 x,u8 y,u32 num,u8 len,u8 size2);//size2(16|12)
 void OLEDShowData(u8 x,u8 y,u8 temp);
+void OLED_ShowFix(u8 x,u8 y,int32_t val,u8 frac,u8 width,u8 size);//Fixed-point number, right aligned
+void OLED_FmtBench(void);
 
 #endif
@@ -0,0 +1,44 @@
+#ifndef __PROF_H
+#define __PROF_H
+
+#include "main.h"
+#include "dwt.h"
+
+// Set to 1 to time the probes below and print them with the telemetry
+#define PROF_ENABLE		0
+
+/***************************** Probes *****************/
+#define PROF_ADCSAMPLE	0	// ADCSample(), control ISR
+#define PROF_ISR		1	// Control_Period(), the whole control ISR body
+#define PROF_SETFREQ	2	// SetPWMFrequency(), successful calls
+#define PROF_DISPLAY	3	// UpdateDisplay()
+#define PROF_OLEDFLUSH	4	// OLED_Refresh(), CPU part of the frame buffer flush
+#define PROF_VLOOP		5	// BUCKVLoopCtlPID(), where Control_Period() runs it
+#define PROF_NUM		6
+
+#define PROF_BINS		20	// log2 bins: bin k counts 2^k..2^(k+1)-1 cycles, the last bin all above
+
+struct _PROF
+{
+	uint32_t	Cnt;//Measurements
+	uint32_t	Min;//Cycles
+	uint32_t	Max;//Cycles
+	uint64_t	Sum;//Cycles, for the mean
+	uint32_t	Hist[PROF_BINS];
+};
+
+extern struct _PROF Prof[PROF_NUM];
+
+// Bracket a code section, both in the same block. Compile to nothing when disabled.
+#if PROF_ENABLE
+#define PROF_START(id)	uint32_t ProfT0_##id = DWT_CYCLES()
+#define PROF_STOP(id)	Prof_Add(id, DWT_CYCLES() - ProfT0_##id)
+#else
+#define PROF_START(id)
+#define PROF_STOP(id)
+#endif
+
+void Prof_Add(uint8_t id, uint32_t cycles);
+uint8_t Prof_Format(uint8_t line, char *buf);
+
+#endif
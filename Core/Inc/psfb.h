@@ -0,0 +1,29 @@
+#ifndef __PSFB_H
+#define __PSFB_H
+
+#include "main.h"
+
+// Set to 1 to run the HRTIM as a phase-shifted full bridge from boot
+#define PSFB_ENABLE		0
+
+/***************************** Bridge *****************/
+#define PSFB_PERIOD		16000	// Master counts, 100kHz at MUL16
+#define PSFB_DEAD		160		// Master counts of dead time per leg, 100ns; rounded down to an even count
+#define PSFB_DEAD_MAX	1022	// Largest dead time, 511 dead-time generator steps of 2 counts
+#define PSFB_PHASE_MIN	48		// Smallest Master CMP1, 3 fHRTIM periods at MUL16
+#define PSFB_TIMB_PER	0xFFDF	// Timer B period: it only restarts on the phase reset
+
+struct _PSFB
+{
+	uint8_t		Active;//1 with the bridge set up by Psfb_Init()
+	uint16_t	Per;//Period, master counts
+	uint16_t	Phase;//Master CMP1 last written, master counts
+};
+
+extern struct _PSFB Psfb;
+
+HAL_StatusTypeDef Psfb_Init(uint32_t period, uint32_t dead);
+void Psfb_SetPhase(uint32_t phase);
+void Psfb_SetDuty(int32_t duty);
+
+#endif
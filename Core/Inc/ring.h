@@ -0,0 +1,31 @@
+#ifndef __RING_H
+#define __RING_H
+
+#include "main.h"
+
+// Single-producer / single-consumer ring of fixed-size entries
+struct _RING
+{
+	uint8_t		*Buf;//Entry storage, (Mask + 1) entries
+	uint16_t	Size;//Entry size, bytes
+	uint16_t	Mask;//Entries - 1, the entry count is a power of two
+	volatile uint16_t	Head;//Free running put count, written only by the producer
+	volatile uint16_t	Tail;//Free running get count, written only by the consumer
+	uint32_t	Drop;//Puts refused because the ring was full, producer side
+};
+
+/*
+ * Define a ring of len entries of type, with static storage. len must be a
+ * power of two up to 32768, anything else fails to compile.
+ */
+#define RING_DEFINE(name, type, len) \
+	typedef char name##_LenCheck[((len) > 0 && ((len) & ((len) - 1)) == 0 && (len) <= 32768) ? 1 : -1]; \
+	static type name##Buf[len]; \
+	static struct _RING name = {(uint8_t *)name##Buf, sizeof(type), (len) - 1, 0, 0, 0}
+
+uint8_t Ring_Put(struct _RING *r, const void *e);
+uint8_t Ring_Get(struct _RING *r, void *e);
+uint16_t Ring_Count(const struct _RING *r);
+void Ring_Flush(struct _RING *r);
+
+#endif
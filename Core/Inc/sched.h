@@ -0,0 +1,38 @@
+#ifndef __SCHED_H
+#define __SCHED_H
+
+#include "main.h"
+
+#define SCHED_TICK_HZ		2000	// Sched_Tick() call rate, TIM2 update
+#define SCHED_MAX_TASKS		10
+#define SCHED_MS(ms)		((uint16_t)((ms) * SCHED_TICK_HZ / 1000))
+
+struct _SCHED_TASK
+{
+	const char	*Name;
+	void		(*Func)(void);
+	uint16_t	Period;//Release period in ticks
+	uint16_t	Count;//Ticks until the next release
+	volatile uint8_t	Ready;//Released, not started yet
+	uint32_t	Release;//Tick of the pending release
+	uint32_t	Last;//Execution time of the last run, DWT cycles
+	uint32_t	Max;//Longest execution time, DWT cycles
+	uint32_t	Avg;//Average execution time x16, DWT cycles
+	uint32_t	Runs;//Completed runs
+	uint32_t	Lost;//Releases dropped because the previous one had not started
+	uint32_t	Late;//Runs completed more than one period after their release
+};
+
+extern struct _SCHED_TASK SchedTask[SCHED_MAX_TASKS];
+extern uint8_t SchedTaskNum;
+
+void Sched_Init(void);
+uint8_t Sched_Add(const char *name, void (*func)(void), uint16_t period_ms);
+void Sched_Tick(void);
+uint8_t Sched_Run(void);
+uint8_t Sched_Pending(void);
+uint32_t Sched_GetTicks(void);
+uint8_t Sched_Format(uint8_t line, char *buf);
+void Telemetry_Task(void);
+
+#endif
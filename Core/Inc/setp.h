@@ -0,0 +1,22 @@
+#ifndef __SETP_H
+#define __SETP_H
+
+#include "main.h"
+
+/***************************** Setpoint types *****************/
+#define SETP_FREQ		1	// PWM frequency, Hz
+#define SETP_DEADTIME	2	// Dead time, 0.1% of the period
+
+#define SETP_QUEUE_LEN	8	// Pending setpoint changes, must be a power of two
+
+struct _SETP
+{
+	uint8_t		Type;//SETP_xxx
+	uint32_t	Value;
+};
+
+uint32_t Setp_FreqPeriod(uint32_t hz);
+uint8_t Setp_Post(uint8_t type, uint32_t value);
+void Setp_Apply(void);
+
+#endif
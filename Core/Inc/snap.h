@@ -0,0 +1,22 @@
+#ifndef __SNAP_H
+#define __SNAP_H
+
+#include "main.h"
+#include "function.h"
+
+// Control state published by the control ISR once per PWM period
+struct _SNAP
+{
+	uint32_t	Seq;//Publish count, 0 = nothing published yet
+	struct _ADI	Adc;//SADC
+	struct _Ctr_value	Ctr;//CtrValue
+	struct _FLAG	Flag;//DF
+};
+
+extern uint32_t SnapRetry;
+
+void Snap_Publish(void);
+uint32_t Snap_Read(struct _SNAP *s);
+uint8_t Snap_Format(uint8_t line, char *buf);
+
+#endif
@@ -62,6 +62,15 @@ void ADC1_2_IRQHandler(void);
 void TIM2_IRQHandler(void);
 void USART2_IRQHandler(void);
 /* USER CODE BEGIN EFP */
+void BB_FaultEntry(void);
+void BB_NMI_Handler(void);
+void BB_HardFault_Handler(void);
+void BB_MemManage_Handler(void);
+void BB_BusFault_Handler(void);
+void BB_UsageFault_Handler(void);
+void HRTIM1_TIMA_IRQHandler(void);
+void I2C3_EV_IRQHandler(void);
+void I2C3_ER_IRQHandler(void);
 
 /* USER CODE END EFP */
 
@@ -41,6 +41,8 @@ extern UART_HandleTypeDef huart2;
 void MX_USART2_UART_Init(void);
 
 /* USER CODE BEGIN Prototypes */
+void USART2_SendString(const char *str);
+uint8_t USART2_SendAsync(const char *str);
 
 /* USER CODE END Prototypes */
 
@@ -24,10 +24,17 @@
 	
 /* USER CODE END Header */
 #include "CtlLoop.h"
+#include "CtlCoef.h"
+#include "burst.h"
+#include "psfb.h"
+#include "prof.h"
 
 /****************·**********************/
 int32_t   VErr0=0,VErr1=0,VErr2=0;//ѹQ12
 int32_t		u0=0,u1=0,u2=0;//ѹ
+#if VLOOP_HOOK
+void (*VLoopHook)(void) = BUCKVLoopCtlPID;//Loop Control_Period() runs
+#endif
 /*
 ** ===================================================================
 **     Funtion Name :  void BUCKVLoopCtlPI(void)
@@ -45,26 +52,44 @@ int32_t		u0=0,u1=0,u2=0;//
 ** ===================================================================
 */
 //·Ĳmathcadļbuck-ѹ-PIDͲ
-#define BUCKPIDb0	5203		//Q8
-#define BUCKPIDb1	-10246	//Q8
-#define BUCKPIDb2	5044		//Q8
+// The coefficients are in CtlCoef.h, written by Host/tools/coefgen.py with their int32 range check
 CCMRAM void BUCKVLoopCtlPID(void)
 {
 	int32_t VoutTemp=0;//ѹ
+	PROF_START(PROF_VLOOP);
 	
 	//ѹ
 	VoutTemp = ((uint32_t )ADC1_RESULT[2]*CAL_VOUT_K>>12)+CAL_VOUT_B;
 	//ѹοѹѹռձӣ
 	VErr0= CtrValue.Voref  - VoutTemp;
+	// Light load: the burst controller takes over the output and the loop holds its state
+	if(!Psfb.Active && Burst_Step(VErr0))
+	{
+		PROF_STOP(PROF_VLOOP);
+		return;
+	}
 	//PID·㹫ʽPID·ĵ
 	u0 = u1 + VErr0*BUCKPIDb0 + VErr1*BUCKPIDb1 + VErr2*BUCKPIDb2;	
+	// Second pole of a 2P2Z design, folded away when BUCKPIDa is 0
+	u0 += (BUCKPIDa * (u1 - u2)) >> 10;
+	// Anti-windup: keep the output and so u1 within the duty limits, at rest while the output is off
+	if(u0 > ((int32_t)CtrValue.BUCKMaxDuty << 8))
+		u0 = (int32_t)CtrValue.BUCKMaxDuty << 8;
+	if(DF.PWMENFlag == 0)
+		u0 = MIN_BUKC_DUTY << 8;
+	else if(u0 < VLOOP_U_MIN)
+		u0 = VLOOP_U_MIN;
 	//ʷݷֵ
 	VErr2 = VErr1;
 	VErr1 = VErr0;
+	u2 = u1;
 	u1 = u0;
 	//·ֵu08λΪBUCKPIDb0-2ΪΪŴQ8
 	CtrValue.BuckDuty= u0>>8;
 	CtrValue.BoostDuty=MIN_BOOST_DUTY1;//BOOSTϹ̶ܹռձ93%¹7%			
+	// Below MIN_BUKC_DUTY: pulses of PFM_DUTY with periods skipped in between
+	if(!Psfb.Active && Burst_Pfm(u0))
+		CtrValue.BuckDuty = PFM_DUTY;
 	//·Сռձ
 	if(CtrValue.BuckDuty > CtrValue.BUCKMaxDuty)
 		CtrValue.BuckDuty = CtrValue.BUCKMaxDuty;	
@@ -73,9 +98,17 @@ CCMRAM void BUCKVLoopCtlPID(void)
 	//PWMENFlagPWM־λλΪ0ʱ,buckռձΪ0;
 	if(DF.PWMENFlag==0)
 		CtrValue.BuckDuty = MIN_BUKC_DUTY;
+	// Full bridge: the duty sets the phase of leg B instead
+	if(Psfb.Active)
+	{
+		Psfb_SetDuty(CtrValue.BuckDuty);
+		PROF_STOP(PROF_VLOOP);
+		return;
+	}
 	//¶ӦĴ
 	HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A].CMP1xR = CtrValue.BuckDuty * PERIOD>>12; //buckռձ
   HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A].CMP3xR = HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A].CMP1xR>>1; //ADC
 	HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_B].CMP1xR = PERIOD - (CtrValue.BoostDuty * PERIOD>>12);//Boostռձ
+	PROF_STOP(PROF_VLOOP);
 }
 
@@ -0,0 +1,158 @@
+/**
+  ******************************************************************************
+  * @file    bench.c
+  * @brief   Cycle benchmark of the control hot path.
+  *
+  *          Bench_Run() calls each item BENCH_CALLS times from a fixed set
+  *          of ADC samples with interrupts masked and keeps min, max and
+  *          mean DWT cycles per call, less the cost of reading the counter.
+  *          It runs once at boot, before the ADC, the PWM outputs and the
+  *          scheduler start, and puts the control state back afterwards.
+  *          Bench_Format() prints the results with the compiler that built
+  *          them; MDK-ARM/bench_gate.py compares a captured log against a
+  *          baseline so a change that makes the control ISR slower shows
+  *          up before it reaches the board.
+  ******************************************************************************
+  */
+#include "bench.h"
+#include "dwt.h"
+#include "function.h"
+#include "CtlLoop.h"
+#include "setp.h"
+#include "fault.h"
+#include "burst.h"
+#include "oled.h"
+#include "stdio.h"
+#include "string.h"
+
+struct _BENCH Bench[BENCH_NUM];
+
+static const char *const BenchName[BENCH_NUM] = {"adc", "vloop", "fault", "setp", "isr", "prot", "fmt"};
+
+// Vin, Iin, Vout, Iout codes around the operating point, all below the protection thresholds
+static const uint16_t BenchAdc[8][4] = {
+	{2000, 2100, 1990, 2150}, {2010, 2300, 2048, 2400}, {1990, 2050, 2100, 2080}, {2005, 2200, 1900, 2300},
+	{2000, 2600, 2020, 2700}, {1980, 2048, 2200, 2048}, {2020, 2150, 1800, 2200}, {2000, 2400, 2060, 2500},
+};
+
+static uint16_t BenchIdx;//Call number within the item
+
+static void Bench_Fmt(void)
+{
+	OLED_ShowFix(45, 2, (int32_t)(7000 + BenchIdx * 97), 2, 6, 2);
+}
+
+static void (*const BenchFn[BENCH_NUM])(void) = {
+	ADCSample, BUCKVLoopCtlPID, Fault_Sample, Setp_Apply, Control_Period, Protect_Task, Bench_Fmt
+};
+
+/** ===================================================================
+**     Function Name : void Bench_Run(void)
+**     Description : Time every item and restore the control state, the
+**       compare and burst mode registers the loop writes and the frame
+**       buffer. Called once at boot with BENCH_ENABLE set.
+**     Parameters  :
+**     Returns     :
+** ===================================================================*/
+void Bench_Run(void)
+{
+	struct _ADI adi = SADC;
+	struct _Ctr_value ctr = CtrValue;
+	struct _FLAG flag = DF;
+	struct _BURST burst = Burst;
+	uint16_t adc[4];
+	int32_t e0 = VErr0, e1 = VErr1, e2 = VErr2, v0 = u0, v1 = u1, v2 = u2;
+	uint32_t cmp1a = HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A].CMP1xR;
+	uint32_t cmp3a = HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A].CMP3xR;
+	uint32_t cmp1b = HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_B].CMP1xR;
+	uint32_t bmcr = HRTIM1->sCommonRegs.BMCR, bmcmpr = HRTIM1->sCommonRegs.BMCMPR, bmper = HRTIM1->sCommonRegs.BMPER;
+	uint32_t bmtrgr = HRTIM1->sCommonRegs.BMTRGR & ~HRTIM_BMTRGR_SW;
+	uint32_t t0, t, over = 0xFFFFFFFF;
+	uint8_t id;
+
+	memcpy(adc, ADC1_RESULT, sizeof(adc));
+	DWT_Init();
+	__disable_irq();
+
+	// Cost of the counter reads themselves
+	for(BenchIdx=0;BenchIdx<BENCH_CALLS;BenchIdx++)
+	{
+		t0 = DWT_CYCLES();
+		t = DWT_CYCLES() - t0;
+		if(t < over)
+			over = t;
+	}
+
+	// The loop runs its full path: output enabled, reference at the set point
+	DF.PWMENFlag = 1;
+	CtrValue.Voref = VOUT_REF_SET;
+	for(id=0;id<BENCH_NUM;id++)
+	{
+		struct _BENCH *b = &Bench[id];
+
+		b->Min = 0xFFFFFFFF;
+		b->Max = 0;
+		b->Sum = 0;
+		for(BenchIdx=0;BenchIdx<BENCH_CALLS;BenchIdx++)
+		{
+			memcpy(ADC1_RESULT, BenchAdc[BenchIdx & 7], sizeof(adc));
+			t0 = DWT_CYCLES();
+			BenchFn[id]();
+			t = DWT_CYCLES() - t0 - over;
+			if(t < b->Min)
+				b->Min = t;
+			if(t > b->Max)
+				b->Max = t;
+			b->Sum += t;
+		}
+	}
+
+	SADC = adi;
+	CtrValue = ctr;
+	DF = flag;
+	Burst = burst;
+	VErr0 = e0; VErr1 = e1; VErr2 = e2;
+	u0 = v0; u1 = v1; u2 = v2;
+	memcpy(ADC1_RESULT, adc, sizeof(adc));
+	HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A].CMP1xR = cmp1a;
+	HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A].CMP3xR = cmp3a;
+	HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_B].CMP1xR = cmp1b;
+	HRTIM1->sCommonRegs.BMTRGR = bmtrgr;
+	HRTIM1->sCommonRegs.BMCMPR = bmcmpr;
+	HRTIM1->sCommonRegs.BMPER = bmper;
+	HRTIM1->sCommonRegs.BMCR = bmcr;
+	OLED_Fill(0x00);
+	__enable_irq();
+}
+
+/** ===================================================================
+**     Function Name : uint8_t Bench_Format(uint8_t line, char *buf)
+**     Description : Result lines: the compiler first, then min, max and
+**       mean cycles per call of each item
+**     Parameters  : line - line number, from 0
+**                   buf - receives the line, at least 128 bytes
+**     Returns     : 1 if a line was written, 0 past the last line
+** ===================================================================*/
+uint8_t Bench_Format(uint8_t line, char *buf)
+{
+	struct _BENCH *b;
+
+	if(line == 0)
+	{
+#if defined(__ARMCC_VERSION)
+		sprintf(buf, "[BEN] build armcc %u calls=%u\r\n", (unsigned)__ARMCC_VERSION, BENCH_CALLS);
+#elif defined(__GNUC__)
+		sprintf(buf, "[BEN] build gcc %u.%u.%u calls=%u\r\n", __GNUC__, __GNUC_MINOR__, __GNUC_PATCHLEVEL__, BENCH_CALLS);
+#else
+		sprintf(buf, "[BEN] build other calls=%u\r\n", BENCH_CALLS);
+#endif
+		return 1;
+	}
+	if(line > BENCH_NUM)
+		return 0;
+
+	b = &Bench[line - 1];
+	sprintf(buf, "[BEN] %s min=%u max=%u mean=%u cyc\r\n", BenchName[line - 1],
+		(unsigned)b->Min, (unsigned)b->Max, (unsigned)(b->Sum / BENCH_CALLS));
+	return 1;
+}
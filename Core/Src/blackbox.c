@@ -0,0 +1,190 @@
+/**
+  ******************************************************************************
+  * @file    blackbox.c
+  * @brief   Post-mortem black-box recorder kept in no-init RAM.
+  *
+  *          The control ISR appends one snapshot per PWM period to a circular
+  *          buffer. Error_Handler() and the NMI/HardFault handlers freeze the
+  *          buffer and store the fault registers and stacked PC/LR. The record
+  *          lives in the UNINIT execution region of the scatter file, so it
+  *          survives a reset and is printed on USART2 at the next boot.
+  ******************************************************************************
+  */
+#include "blackbox.h"
+#include "function.h"
+#include "usart.h"
+#include "stdio.h"
+#include "string.h"
+
+NOINIT struct _BLACKBOX BlackBox;
+
+static uint32_t BlackBox_Checksum(const struct _BB_FAULT *f)
+{
+	const uint32_t *p = (const uint32_t *)f;
+	uint32_t sum = BB_MAGIC;
+	uint32_t i;
+
+	for(i = 0; i < (sizeof(struct _BB_FAULT) / 4) - 1; i++)
+		sum = (sum << 1 | sum >> 31) ^ p[i];
+	return sum;
+}
+
+/** ===================================================================
+**     Function Name : void BlackBox_Init(void)
+**     Description : Validate the record left in no-init RAM.
+**       A cold power-up leaves random contents behind, which fail the
+**       magic check and are cleared. A pending fault is kept for
+**       BlackBox_Report(). MemManage, BusFault and UsageFault get their
+**       own vectors instead of escalating to HardFault.
+**     Parameters  :
+**     Returns     :
+** ===================================================================*/
+void BlackBox_Init(void)
+{
+	if(BlackBox.Magic != BB_MAGIC)
+	{
+		memset(&BlackBox, 0, sizeof(BlackBox));
+		BlackBox.Magic = BB_MAGIC;
+	}
+	else if(BlackBox.Fault.Source != BB_SRC_NONE
+		&& BlackBox.Fault.Check != BlackBox_Checksum(&BlackBox.Fault))
+	{
+		// Fault record torn by a reset during capture, nothing usable
+		memset(&BlackBox.Fault, 0, sizeof(BlackBox.Fault));
+		BlackBox.Frozen = 0;
+	}
+
+	BlackBox.BootCnt++;
+	SCB->SHCSR |= SCB_SHCSR_MEMFAULTENA_Msk | SCB_SHCSR_BUSFAULTENA_Msk | SCB_SHCSR_USGFAULTENA_Msk;
+}
+
+/** ===================================================================
+**     Function Name : void BlackBox_Record(void)
+**     Description : Append one control-cycle snapshot, called from the
+**       control ISR once per PWM period.
+**     Parameters  :
+**     Returns     :
+** ===================================================================*/
+CCMRAM void BlackBox_Record(void)
+{
+	struct _BB_SNAP *s;
+
+	if(BlackBox.Frozen)
+		return;
+
+	s = &BlackBox.Snap[BlackBox.Head & (BB_DEPTH - 1)];
+	s->Tick    = uwTick;
+	s->Adc[0]  = ADC1_RESULT[0];
+	s->Adc[1]  = ADC1_RESULT[1];
+	s->Adc[2]  = ADC1_RESULT[2];
+	s->Adc[3]  = ADC1_RESULT[3];
+	s->Per     = HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A].PERxR;
+	s->TaCmp1  = HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A].CMP1xR;
+	s->TaCmp2  = HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A].CMP2xR;
+	s->TbCmp1  = HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_B].CMP1xR;
+	s->SMFlag  = DF.SMFlag;
+	s->ErrFlag = DF.ErrFlag;
+	BlackBox.Head++;
+}
+
+static void BlackBox_Freeze(void)
+{
+	BlackBox.Fault.CFSR  = SCB->CFSR;
+	BlackBox.Fault.HFSR  = SCB->HFSR;
+	BlackBox.Fault.MMFAR = SCB->MMFAR;
+	BlackBox.Fault.BFAR  = SCB->BFAR;
+	BlackBox.Fault.Check = BlackBox_Checksum(&BlackBox.Fault);
+	BlackBox.Frozen = 1;
+}
+
+/** ===================================================================
+**     Function Name : void BlackBox_Error(uint32_t caller)
+**     Description : Capture an Error_Handler() call
+**     Parameters  : caller - return address of Error_Handler()
+**     Returns     :
+** ===================================================================*/
+void BlackBox_Error(uint32_t caller)
+{
+	if(BlackBox.Frozen)
+		return;
+
+	memset(&BlackBox.Fault, 0, sizeof(BlackBox.Fault));
+	BlackBox.Fault.Source = BB_SRC_ERROR;
+	BlackBox.Fault.PC = caller;
+	BlackBox_Freeze();
+}
+
+/** ===================================================================
+**     Function Name : void BlackBox_Fault(uint32_t *frame, uint32_t source)
+**     Description : Capture an exception. Entered by a tail branch from
+**       BB_FaultEntry in stm32g4xx_it.c with the exception stack frame
+**       {r0,r1,r2,r3,r12,lr,pc,xpsr}. Does not return.
+**     Parameters  : frame - stacked exception frame
+**                   source - BB_SRC_xxx
+**     Returns     :
+** ===================================================================*/
+void BlackBox_Fault(uint32_t *frame, uint32_t source)
+{
+	__disable_irq();
+
+	if(!BlackBox.Frozen || BlackBox.Fault.Source == BB_SRC_ERROR)
+	{
+		memset(&BlackBox.Fault, 0, sizeof(BlackBox.Fault));
+		BlackBox.Fault.Source = source;
+		BlackBox.Fault.LR  = frame[5];
+		BlackBox.Fault.PC  = frame[6];
+		BlackBox.Fault.PSR = frame[7];
+		BlackBox.Fault.SP  = (uint32_t)(uintptr_t)(frame + 8);
+		BlackBox_Freeze();
+	}
+
+	while(1)
+	{
+	}
+}
+
+/** ===================================================================
+**     Function Name : void BlackBox_Report(void)
+**     Description : Print a pending fault record and its snapshot history
+**       on USART2, oldest snapshot first, then re-arm the recorder.
+**       Called once at boot after USART2 is initialised.
+**     Parameters  :
+**     Returns     :
+** ===================================================================*/
+void BlackBox_Report(void)
+{
+	static const char *SrcName[] = {"None", "Error_Handler", "NMI", "HardFault", "MemManage", "BusFault", "UsageFault"};
+	struct _BB_FAULT *f = &BlackBox.Fault;
+	struct _BB_SNAP *s;
+	char line[96];
+	uint32_t n, i, start;
+
+	if(f->Source == BB_SRC_NONE)
+		return;
+
+	sprintf(line, "\r\n[BB] %s, boot %u\r\n",
+		f->Source <= BB_SRC_USAGEFAULT ? SrcName[f->Source] : "?", (unsigned)BlackBox.BootCnt);
+	USART2_SendString(line);
+	sprintf(line, "[BB] PC=%08X LR=%08X PSR=%08X SP=%08X\r\n",
+		(unsigned)f->PC, (unsigned)f->LR, (unsigned)f->PSR, (unsigned)f->SP);
+	USART2_SendString(line);
+	sprintf(line, "[BB] CFSR=%08X HFSR=%08X MMFAR=%08X BFAR=%08X\r\n",
+		(unsigned)f->CFSR, (unsigned)f->HFSR, (unsigned)f->MMFAR, (unsigned)f->BFAR);
+	USART2_SendString(line);
+
+	n = BlackBox.Head < BB_DEPTH ? BlackBox.Head : BB_DEPTH;
+	start = BlackBox.Head - n;
+	USART2_SendString("[BB] tick adc0 adc1 adc2 adc3 per tacmp1 tacmp2 tbcmp1 sm err\r\n");
+	for(i = 0; i < n; i++)
+	{
+		s = &BlackBox.Snap[(start + i) & (BB_DEPTH - 1)];
+		sprintf(line, "[BB] %u %u %u %u %u %u %u %u %u %u %04X\r\n",
+			(unsigned)s->Tick, s->Adc[0], s->Adc[1], s->Adc[2], s->Adc[3],
+			s->Per, s->TaCmp1, s->TaCmp2, s->TbCmp1, s->SMFlag, s->ErrFlag);
+		USART2_SendString(line);
+	}
+
+	memset(f, 0, sizeof(*f));
+	BlackBox.Head = 0;
+	BlackBox.Frozen = 0;
+}
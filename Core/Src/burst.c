@@ -0,0 +1,204 @@
+/**
+  ******************************************************************************
+  * @file    burst.c
+  * @brief   Light-load burst mode and pulse skipping of the voltage loop.
+  *
+  *          Below BURST_IOUT_ENTER for BURST_ENTER_CNT periods in the Run
+  *          state the loop stops regulating and the stage switches at its
+  *          duty plus BURST_DUTY_UP, which lifts Vout. Each time Vout is
+  *          BURST_VBAND above Voref the HRTIM burst mode controller is
+  *          triggered and idles all four outputs for BURST_IDLE periods.
+  *          The lighter the load, the longer Vout stays in the band and the
+  *          fewer periods switch. Above BURST_IOUT_EXIT, BURST_VDROP below
+  *          Voref or with the output off the burst is cut short and the loop
+  *          takes over again from the state it had on entry.
+  *
+  *          Pulse skipping works on the loop output instead: when it
+  *          falls below MIN_BUKC_DUTY, e.g. at the start of the soft-start
+  *          ramp or a low reference, each switching period is a pulse of
+  *          PFM_DUTY or idles, so often that the average duty follows the
+  *          loop output. The switching frequency falls with the demand.
+  *          Above PFM_DUTY the stage goes back to fixed-frequency PWM, the
+  *          gap to MIN_BUKC_DUTY is the hysteresis.
+  *
+  *          The timers keep their clock during a burst
+  *          (HRTIM_TIMERBURSTMODE_MAINTAINCLOCK), so the ADC trigger and
+  *          the control ISR keep running while the outputs are idle.
+  *
+  *          Both run inside BUCKVLoopCtlPID(), which Control_Period() calls
+  *          only with VLOOP_BUCKBOOST and ADC_VOUT_SENSE set. This board
+  *          has neither, so on target they stay off; the host build has
+  *          both.
+  ******************************************************************************
+  */
+#include "burst.h"
+#include "function.h"
+#include "CtlLoop.h"
+#include "stdio.h"
+#include "string.h"
+
+struct _BURST Burst;
+
+// Trigger the burst controller to idle the outputs for a number of periods
+static CCMRAM void Burst_Idle(uint16_t periods)
+{
+	HRTIM1->sCommonRegs.BMCMPR = periods - 1;
+	HRTIM1->sCommonRegs.BMPER = periods - 1;
+	HRTIM1->sCommonRegs.BMTRGR |= HRTIM_BMTRGR_SW;
+}
+
+/** ===================================================================
+**     Function Name : void Burst_Init(void)
+**     Description : Set up the burst mode controller: single shot on a
+**       software trigger, clocked by the Timer A roll-over, outputs idle
+**       for BURST_IDLE periods. Left disabled until Burst_Step() needs it.
+**       Called from MX_HRTIM1_Init().
+**     Parameters  :
+**     Returns     :
+** ===================================================================*/
+void Burst_Init(void)
+{
+	HRTIM_BurstModeCfgTypeDef cfg = {0};
+
+	cfg.Mode = HRTIM_BURSTMODE_SINGLESHOT;
+	cfg.ClockSource = HRTIM_BURSTMODECLOCKSOURCE_TIMER_A;
+	cfg.Prescaler = HRTIM_BURSTMODEPRESCALER_DIV1;
+	cfg.PreloadEnable = HRIM_BURSTMODEPRELOAD_DISABLED;
+	cfg.Trigger = HRTIM_BURSTMODETRIGGER_NONE;
+	// BMCMPR = BMPER: idle for the whole burst, no run period forced at its end
+	cfg.IdleDuration = BURST_IDLE - 1;
+	cfg.Period = BURST_IDLE - 1;
+	if (HAL_HRTIM_BurstModeConfig(&hhrtim1, &cfg) != HAL_OK)
+	{
+		Error_Handler();
+	}
+	memset(&Burst, 0, sizeof(Burst));
+}
+
+/** ===================================================================
+**     Function Name : uint8_t Burst_Step(int32_t err)
+**     Description : Enter, run and leave burst mode. Called from the
+**       voltage loop each control period with its new error. On the way
+**       out the error history is set to the present error so the loop
+**       restarts from its duty without a kick.
+**     Parameters  : err - Voref minus Vout, Q12
+**     Returns     : 1 if the loop is to hold its output this period
+** ===================================================================*/
+CCMRAM uint8_t Burst_Step(int32_t err)
+{
+#if BURST_ENABLE
+	uint32_t bmcr = HRTIM1->sCommonRegs.BMCR;
+	int32_t duty;
+
+	if(!Burst.Active)
+	{
+		if(SADC.IoutAvg >= BURST_IOUT_ENTER || DF.SMFlag != Run || DF.PWMENFlag == 0)
+		{
+			Burst.Cnt = 0;
+			return 0;
+		}
+		if(++Burst.Cnt < BURST_ENTER_CNT)
+			return 0;
+		// Switch a little above the regulated duty between bursts
+		duty = (u1 >> 8) + BURST_DUTY_UP;
+		if(duty > CtrValue.BUCKMaxDuty)
+			duty = CtrValue.BUCKMaxDuty;
+		CtrValue.BuckDuty = duty;
+		HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A].CMP1xR = duty * PERIOD >> 12;
+		HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A].CMP3xR = HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A].CMP1xR >> 1;
+		HRTIM1->sCommonRegs.BMCR = bmcr | HRTIM_BMCR_BME;
+		Burst.Active = 1;
+		Burst.Pfm = 0;
+		Burst.Entries++;
+		return 1;
+	}
+
+	// The load is back, Vout sags or the output is off: cut the burst short and regulate
+	if(SADC.IoutAvg > BURST_IOUT_EXIT || err > BURST_VDROP || DF.SMFlag != Run || DF.PWMENFlag == 0)
+	{
+		HRTIM1->sCommonRegs.BMCR = bmcr & ~(HRTIM_BMCR_BME | HRTIM_BMCR_BMSTAT);
+		Burst.Active = 0;
+		Burst.Cnt = 0;
+		VErr1 = VErr2 = err;
+		u2 = u1;
+		return 0;
+	}
+
+	Burst.Periods++;
+	if(bmcr & HRTIM_BMCR_BMSTAT)
+		Burst.Idle++;
+	else if(err < -BURST_VBAND)
+	{
+		Burst_Idle(BURST_IDLE);
+		Burst.Bursts++;
+	}
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+/** ===================================================================
+**     Function Name : uint8_t Burst_Pfm(int32_t u)
+**     Description : Enter, run and leave pulse skipping. Called from the
+**       voltage loop each control period with its clamped output; the
+**       loop writes PFM_DUTY while it returns 1, and this period idles
+**       when the output summed since the last pulse does not cover one.
+**     Parameters  : u - loop output, Q8 duty
+**     Returns     : 1 while skipping pulses
+** ===================================================================*/
+CCMRAM uint8_t Burst_Pfm(int32_t u)
+{
+#if PFM_ENABLE
+	uint32_t bmcr = HRTIM1->sCommonRegs.BMCR;
+
+	if(!Burst.Pfm)
+	{
+		if(u >= (MIN_BUKC_DUTY << 8) || DF.PWMENFlag == 0)
+			return 0;
+		HRTIM1->sCommonRegs.BMCR = bmcr | HRTIM_BMCR_BME;
+		Burst.Pfm = 1;
+		Burst.PfmAcc = 0;
+		Burst.PfmEntries++;
+	}
+	else if(u > (PFM_DUTY << 8) || DF.PWMENFlag == 0)
+	{
+		HRTIM1->sCommonRegs.BMCR = bmcr & ~(HRTIM_BMCR_BME | HRTIM_BMCR_BMSTAT);
+		Burst.Pfm = 0;
+		return 0;
+	}
+
+	Burst.PfmAcc += u;
+	if(Burst.PfmAcc >= (PFM_DUTY << 8))
+		Burst.PfmAcc -= PFM_DUTY << 8;
+	else
+	{
+		Burst_Idle(1);
+		Burst.Skips++;
+	}
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+/** ===================================================================
+**     Function Name : uint8_t Burst_Format(uint8_t line, char *buf)
+**     Description : Telemetry line: burst mode state, entries, bursts
+**       and the share of periods in burst mode spent idle, per mille,
+**       then pulse skipping state, entries and periods skipped
+**     Parameters  : line - line number, from 0
+**                   buf - receives the line, at least 128 bytes
+**     Returns     : 1 if a line was written, 0 past the last line
+** ===================================================================*/
+uint8_t Burst_Format(uint8_t line, char *buf)
+{
+	struct _BURST b = Burst;//Counters move under the control ISR, print one copy
+
+	if(line != 0)
+		return 0;
+	sprintf(buf, "[BST] active=%u entries=%u bursts=%u idle=%u/1000 pfm=%u pfm_entries=%u skips=%u\r\n", b.Active,
+		(unsigned)b.Entries, (unsigned)b.Bursts, (unsigned)(b.Periods ? (uint64_t)b.Idle * 1000 / b.Periods : 0),
+		b.Pfm, (unsigned)b.PfmEntries, (unsigned)b.Skips);
+	return 1;
+}
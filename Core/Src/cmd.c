@@ -0,0 +1,114 @@
+/**
+  ******************************************************************************
+  * @file    cmd.c
+  * @brief   Line commands on USART2.
+  *
+  *          The USART2 receive interrupt puts each byte in a ring and
+  *          re-arms itself; Cmd_Task() assembles the bytes into lines and
+  *          runs them. Commands, one per line, case-insensitive:
+  *            F <hz>    PWM frequency
+  *            D <px10>  Dead time in 0.1% of the period
+  *            M         Switch open/closed-loop mode
+  *          Each line is answered with "OK" or "ERR". Replies share the DMA
+  *          transmitter with telemetry and are dropped when it is busy.
+  ******************************************************************************
+  */
+#include "cmd.h"
+#include "ring.h"
+#include "usart.h"
+#include "function.h"
+#include "stdlib.h"
+
+// Written only by the USART2 receive interrupt, read only by Cmd_Task()
+RING_DEFINE(CmdRx, uint8_t, CMD_RX_LEN);
+
+static uint8_t CmdRxByte;
+static char CmdLine[CMD_LINE_LEN];
+static uint8_t CmdLen = 0;
+static uint8_t CmdOverlong = 0;//Line ran past CMD_LINE_LEN, refuse it
+
+/** ===================================================================
+**     Function Name : void Cmd_Init(void)
+**     Description : Start receiving commands on USART2
+**     Parameters  :
+**     Returns     :
+** ===================================================================*/
+void Cmd_Init(void)
+{
+	CmdLen = 0;
+	CmdOverlong = 0;
+	HAL_UART_Receive_IT(&huart2, &CmdRxByte, 1);
+}
+
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
+{
+	if(huart->Instance != USART2)
+		return;
+	Ring_Put(&CmdRx, &CmdRxByte);//Dropped if Cmd_Task() is behind
+	HAL_UART_Receive_IT(&huart2, &CmdRxByte, 1);
+}
+
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+	// Overrun or framing error: the receive is aborted, start it again
+	if(huart->Instance == USART2 && huart->RxState == HAL_UART_STATE_READY)
+		HAL_UART_Receive_IT(&huart2, &CmdRxByte, 1);
+}
+
+// Run one command line, 1 if it was understood and done
+static uint8_t Cmd_Exec(char *line)
+{
+	char *end;
+	unsigned long val;
+	char op = line[0];
+
+	if(op >= 'a' && op <= 'z')
+		op -= 'a' - 'A';
+	if(op == 'M' && line[1] == '\0')
+	{
+		Mode_Switch();
+		return 1;
+	}
+	if(op != 'F' && op != 'D')
+		return 0;
+
+	val = strtoul(&line[1], &end, 10);
+	if(end == &line[1] || *end != '\0')
+		return 0;//No number or trailing text
+	if(op == 'F')
+		return RequestPWMFrequency((uint32_t)val) == HAL_OK;
+	return val <= 0xFF && RequestDeadTime((uint8_t)val);
+}
+
+/** ===================================================================
+**     Function Name : void Cmd_Task(void)
+**     Description : Command task, 10ms. Take the received bytes and run
+**       the first complete line. One line per run, so the reply to one
+**       has gone out before the next is answered.
+**     Parameters  :
+**     Returns     :
+** ===================================================================*/
+void Cmd_Task(void)
+{
+	uint8_t c;
+
+	while(Ring_Get(&CmdRx, &c))
+	{
+		if(c == '\r' || c == '\n')
+		{
+			if(CmdLen == 0 && !CmdOverlong)
+				continue;//Empty line, or the LF of a CR LF
+			CmdLine[CmdLen] = '\0';
+			USART2_SendAsync(!CmdOverlong && Cmd_Exec(CmdLine) ? "OK\r\n" : "ERR\r\n");
+			CmdLen = 0;
+			CmdOverlong = 0;
+			return;
+		}
+		else if(c == ' ' && CmdLen == 1)
+			continue;//Blank between the command letter and its value
+		else if(CmdLen < CMD_LINE_LEN - 1)
+			CmdLine[CmdLen++] = (char)c;
+		else
+			CmdOverlong = 1;
+	}
+}
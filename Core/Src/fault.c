@@ -0,0 +1,108 @@
+/**
+  ******************************************************************************
+  * @file    fault.c
+  * @brief   Fault events from the control ISR to thread code.
+  *
+  *          The control ISR is the only producer. It posts an event when a
+  *          single Vout or Iout sample goes over its protection threshold,
+  *          which the averaged checks in Protect_Task() may never see, and
+  *          when it refuses a queued setpoint. Fault_Poll() drains the events
+  *          in Protect_Task() and keeps per-type counts for telemetry. Events
+  *          are only recorded here. ShortOff() trips on the Iout samples in
+  *          the ISR, the averaged checks in Protect_Task() on the rest.
+  ******************************************************************************
+  */
+#include "fault.h"
+#include "ring.h"
+#include "function.h"
+#include "stdio.h"
+
+// Written only by the control ISR, read only by Fault_Poll()
+RING_DEFINE(FltQueue, struct _FLT_EVENT, FLT_QUEUE_LEN);
+
+static uint32_t FltCnt[FLT_EV_NUM];//Events taken, by type
+static struct _FLT_EVENT FltLast;//Newest event taken
+
+/** ===================================================================
+**     Function Name : void Fault_Post(uint8_t type, uint16_t value)
+**     Description : Queue a fault event. Control ISR only, never waits;
+**       an event that finds the queue full is counted as dropped.
+**     Parameters  : type - FLT_EV_xxx
+**                   value - sample or setpoint type
+**     Returns     :
+** ===================================================================*/
+CCMRAM void Fault_Post(uint8_t type, uint16_t value)
+{
+	struct _FLT_EVENT ev;
+
+	ev.Type = type;
+	ev.Value = value;
+	ev.Tick = HAL_GetTick();
+	Ring_Put(&FltQueue, &ev);
+}
+
+/** ===================================================================
+**     Function Name : void Fault_Sample(void)
+**     Description : Post a peak event on each sample that crosses a
+**       protection threshold. Called from the control ISR after
+**       ADCSample(). A threshold re-arms FLT_PEAK_HYST below itself.
+**     Parameters  :
+**     Returns     :
+** ===================================================================*/
+CCMRAM void Fault_Sample(void)
+{
+	static uint8_t VoutHigh = 0, IoutHigh = 0;
+
+	if(!VoutHigh && SADC.Vout > VOUT_OVP_VAL)
+	{
+		VoutHigh = 1;
+		Fault_Post(FLT_EV_VOUT_PEAK, (uint16_t)SADC.Vout);
+	}
+	else if(VoutHigh && SADC.Vout < VOUT_OVP_VAL - FLT_PEAK_HYST)
+		VoutHigh = 0;
+
+	if(!IoutHigh && SADC.Iout > IOUT_OCP_VAL)
+	{
+		IoutHigh = 1;
+		Fault_Post(FLT_EV_IOUT_PEAK, (uint16_t)SADC.Iout);
+	}
+	else if(IoutHigh && SADC.Iout < IOUT_OCP_VAL - FLT_PEAK_HYST)
+		IoutHigh = 0;
+}
+
+/** ===================================================================
+**     Function Name : void Fault_Poll(void)
+**     Description : Take the queued fault events, called from
+**       Protect_Task()
+**     Parameters  :
+**     Returns     :
+** ===================================================================*/
+void Fault_Poll(void)
+{
+	struct _FLT_EVENT ev;
+
+	while(Ring_Get(&FltQueue, &ev))
+	{
+		if(ev.Type < FLT_EV_NUM)
+			FltCnt[ev.Type]++;
+		FltLast = ev;
+	}
+}
+
+/** ===================================================================
+**     Function Name : uint8_t Fault_Format(uint8_t line, char *buf)
+**     Description : Telemetry line with the fault event counts and the
+**       newest event
+**     Parameters  : line - line number, from 0
+**                   buf - receives the line, at least 128 bytes
+**     Returns     : 1 if a line was written, 0 past the last line
+** ===================================================================*/
+uint8_t Fault_Format(uint8_t line, char *buf)
+{
+	if(line != 0)
+		return 0;
+	sprintf(buf, "[FLT] vout_pk=%u iout_pk=%u setp_rej=%u drop=%u last=%u/%u@%u\r\n",
+		(unsigned)FltCnt[FLT_EV_VOUT_PEAK], (unsigned)FltCnt[FLT_EV_IOUT_PEAK], (unsigned)FltCnt[FLT_EV_SETP_REJECT],
+		(unsigned)FltQueue.Drop, (unsigned)FltLast.Type, (unsigned)FltLast.Value, (unsigned)FltLast.Tick);
+	return 1;
+}
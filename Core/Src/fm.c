@@ -0,0 +1,154 @@
+/**
+  ******************************************************************************
+  * @file    fm.c
+  * @brief   Frequency-modulated voltage loop for resonant stages.
+  *
+  *          In closed-loop mode the Timer A/B period is the control
+  *          variable instead of a duty: each control period Fm_Step()
+  *          runs an incremental PI on the Vout error and writes the new
+  *          period and the 50% compares straight to the registers, as
+  *          Setp_Apply() does. Above resonance the tank gain falls with
+  *          frequency, so Vout below Voref lengthens the period.
+  *
+  *          The period moves at most FM_SLEW counts per control period
+  *          and stays within FM_FREQ_MIN~FM_FREQ_MAX. The compensator
+  *          state is held inside both limits, so it does not wind up on
+  *          either. With the output off it waits at FM_FREQ_MAX, the
+  *          lowest gain, and the soft-start ramp of Voref brings Vout up.
+  *
+  *          The whole range needs one prescaler: at MUL16 70kHz is past
+  *          CNTR_MAX, so Fm_Start() moves the timers to MUL8, 1.25ns per
+  *          count, and the loop never needs SetPWMFrequency().
+  ******************************************************************************
+  */
+#include "fm.h"
+#include "function.h"
+#include "hrtim.h"
+#include "psfb.h"
+
+struct _FM Fm;
+
+// Counter clock at MUL8, CKPSC 0 counts at 32 x fHRTIM
+#define FM_CLK		((SystemCoreClock << 5) >> HRTIM_PRESCALERRATIO_MUL8)
+#define FM_PER(hz)	(FM_CLK / (hz))
+
+// Period, the 50% compares and the ADC trigger SetPWMFrequency() sets up, without the timer reset
+static CCMRAM void Fm_Write(uint32_t per)
+{
+	HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A].PERxR = per;
+	HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_B].PERxR = per;
+	HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A].CMP2xR = per / 2 - 1;
+	HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_B].CMP2xR = per / 2 - 1;
+	HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A].CMP3xR = HRTIM_ADC_POINT(per);
+	pGlobalTimeBaseCfg.Period = per;
+	Fm.Per = per;
+}
+
+/** ===================================================================
+**     Function Name : HAL_StatusTypeDef Fm_Start(void)
+**     Description : Hand the frequency to the voltage loop. Timer A and
+**       B go to MUL8 at FM_FREQ_START, the loop starts from there.
+**       Thread code, from Mode_Switch().
+**     Parameters  :
+**     Returns     : HAL_OK, HAL_ERROR with the bridge running or on a
+**       HAL error
+** ===================================================================*/
+HAL_StatusTypeDef Fm_Start(void)
+{
+	HRTIM_CompareCfgTypeDef cmp = {0};
+	uint32_t per = FM_PER(FM_FREQ_START);
+
+	if(Psfb.Active)
+		return HAL_ERROR;//The bridge runs on the master period
+	Fm.Active = 0;
+	pGlobalTimeBaseCfg.Period = per;
+	pGlobalTimeBaseCfg.PrescalerRatio = HRTIM_PRESCALERRATIO_MUL8;
+	cmp.CompareValue = per / 2 - 1;
+	cmp.AutoDelayedMode = HRTIM_AUTODELAYEDMODE_REGULAR;
+	if(HAL_HRTIM_TimeBaseConfig(&hhrtim1, HRTIM_TIMERINDEX_TIMER_A, &pGlobalTimeBaseCfg) != HAL_OK ||
+		HAL_HRTIM_TimeBaseConfig(&hhrtim1, HRTIM_TIMERINDEX_TIMER_B, &pGlobalTimeBaseCfg) != HAL_OK ||
+		HAL_HRTIM_WaveformCompareConfig(&hhrtim1, HRTIM_TIMERINDEX_TIMER_A, HRTIM_COMPAREUNIT_2, &cmp) != HAL_OK ||
+		HAL_HRTIM_WaveformCompareConfig(&hhrtim1, HRTIM_TIMERINDEX_TIMER_B, HRTIM_COMPAREUNIT_2, &cmp) != HAL_OK ||
+		HAL_HRTIM_SoftwareReset(&hhrtim1, HRTIM_TIMERRESET_TIMER_A | HRTIM_TIMERRESET_TIMER_B) != HAL_OK)
+		return HAL_ERROR;
+	HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A].CMP3xR = HRTIM_ADC_POINT(per);
+
+	Fm.PerMin = FM_PER(FM_FREQ_MAX);
+	Fm.PerMax = FM_PER(FM_FREQ_MIN);
+	Fm.Per = per;
+	Fm.U = per << 8;
+	Fm.Err1 = 0;
+	Fm.SlewCnt = 0;
+	currentPWMFreq = FM_FREQ_START;
+	currentPWMFreqHz = FM_FREQ_START;
+	currentPLLFreq = FM_CLK;
+	Fm.Active = 1;
+	return HAL_OK;
+}
+
+/** ===================================================================
+**     Function Name : void Fm_Stop(void)
+**     Description : Take the frequency back from the loop. The period
+**       stays where the loop left it until SetPWMFrequency() is called.
+**     Parameters  :
+**     Returns     :
+** ===================================================================*/
+void Fm_Stop(void)
+{
+	Fm.Active = 0;
+}
+
+/** ===================================================================
+**     Function Name : void Fm_Step(void)
+**     Description : One step of the loop, from the control ISR after
+**       ADCSample(): the new period applies in the period just started
+**     Parameters  :
+**     Returns     :
+** ===================================================================*/
+CCMRAM void Fm_Step(void)
+{
+	int32_t vout, err, lo, hi;
+
+	if(!Fm.Active)
+		return;
+	// Same calibration as the duty loop
+	vout = ((uint32_t)ADC1_RESULT[2] * CAL_VOUT_K >> 12) + CAL_VOUT_B;
+	err = CtrValue.Voref - vout;
+	if(DF.PWMENFlag == 0)
+	{
+		// Output off: wait at the top frequency, restart from here without a kick
+		Fm.U = (int32_t)Fm.PerMin << 8;
+		Fm.Err1 = err;
+		Fm_Write(Fm.PerMin);
+		return;
+	}
+
+	Fm.U += FM_KP * (err - Fm.Err1) + FM_KI * err;
+	Fm.Err1 = err;
+	// Slew limit, then the range
+	lo = ((int32_t)Fm.Per - FM_SLEW) << 8;
+	hi = ((int32_t)Fm.Per + FM_SLEW) << 8;
+	if(Fm.U < lo || Fm.U > hi)
+	{
+		Fm.U = (Fm.U < lo) ? lo : hi;
+		Fm.SlewCnt++;
+	}
+	if(Fm.U < ((int32_t)Fm.PerMin << 8))
+		Fm.U = (int32_t)Fm.PerMin << 8;
+	if(Fm.U > ((int32_t)Fm.PerMax << 8))
+		Fm.U = (int32_t)Fm.PerMax << 8;
+	Fm_Write(Fm.U >> 8);
+}
+
+/** ===================================================================
+**     Function Name : uint32_t Fm_FreqHz(void)
+**     Description : Frequency the loop has set, for the display
+**     Parameters  :
+**     Returns     : Hz
+** ===================================================================*/
+uint32_t Fm_FreqHz(void)
+{
+	uint32_t per = Fm.Per;
+
+	return per ? FM_CLK / per : 0;
+}
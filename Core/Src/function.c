@@ -63,7 +63,14 @@ Button Function Description:
 
 #include "function.h"
 #include "CtlLoop.h"
-#include "stdio.h"
+#include "key.h"
+#include "prof.h"
+#include "snap.h"
+#include "setp.h"
+#include "fault.h"
+#include "blackbox.h"
+#include "fm.h"
+#include "psfb.h"
 #include "string.h"
 
 #include "stm32g4xx_hal_def.h"
@@ -72,7 +79,7 @@ Button Function Description:
 // Soft-start state flag
 SState_M STState = SSInit;
 
-// OLED refresh counter, increments every 5ms in the 5ms interrupt
+// OLED refresh counter
 uint16_t OLEDShowCnt = 0;
 
 
@@ -84,26 +91,19 @@ uint16_t OLEDShowCnt = 0;
 #define FREQ_MIN 70000.0f    // 70 kHz
 #define FREQ_MAX 130000.0f   // 130 kHz
 #define FREQ_STEP_PERCENT 0.1f  // Frequency adjustment step per button press: 0.1%
-
-// Dead time parameters (Unit: 0.1%, each step adjusts by 0.1%)
-#define DEADTIME_MIN_PX1000 0     // 0%
-#define DEADTIME_MAX_PX1000 50    // 5.0%
-#define DEADTIME_STEP_PX1000 1    // 0.1%
+#define FREQ_FAST_REP 20         // Auto-repeats before the step grows to 1%
 
 // Duty cycle parameters (Unit: 0.1%, each step adjusts by 0.1%)
 #define DUTY_MIN_PX10 50    // 5.0%
 #define DUTY_MAX_PX10 500   // 50.0%
 #define DUTY_STEP_PX10 1     // 0.1%
 
-// Assume CNTR_MIN and CNTR_MAX are defined as follows
-#define CNTR_MIN 1000
-#define CNTR_MAX 16000
-
 // Global variables
 extern HRTIM_HandleTypeDef hhrtim1;
 extern HRTIM_TimeBaseCfgTypeDef pGlobalTimeBaseCfg;
 
 volatile float currentPWMFreq = 100000.0f;        // Initial frequency 100 kHz
+volatile uint32_t currentPWMFreqHz = 100000;      // Last frequency set by SetPWMFrequency(), used by the display
 volatile uint8_t gCurrentDeadTimePercent = 2;     // Initial dead time 2%
 
 // Initialize duty cycles
@@ -119,49 +119,36 @@ volatile uint32_t currentPLLFreq = 160000000;      // 160 MHz, set according to
 
 
 
-/** ===================================================================
-**     Funtion Name :void Key_Scan(void)
-**     Description : The state of two buttons
-**       Default state of KEYFlag is 0. When pressed, Flag becomes 1, and when pressed again, Flag becomes 0, cycling in this way.
-**       When the machine is running normally or during startup, pressing the button will turn off the output and enter standby mode.
-**     Parameters  :
-**     Returns     :
-** ===================================================================*/
-uint8_t Key_Scan(GPIO_TypeDef* GPIOx,uint16_t GPIO_Pin)
-{			
-	/* Check if the button is pressed */
-	if(HAL_GPIO_ReadPin(GPIOx, GPIO_Pin) == KEY_OFF)  
-	{	 
-		/* Wait for the button to be released */
-		while(HAL_GPIO_ReadPin(GPIOx,GPIO_Pin) == KEY_OFF);   
-		return 	KEY_ON;	 
-	}
-	else
-		return KEY_OFF;
-
-}
-
-
 /** ===================================================================
 **     Funtion Name : Button_Task
-**     Description : 
+**     Description : Key task, 10ms. Handle one key event from the key
+**       queue. Presses and auto-repeats act alike; once a frequency
+**       key has repeated FREQ_FAST_REP times the step grows tenfold.
+**       Never waits for a key.
 **     Parameters  :
 **     Returns     :
 ** ===================================================================*/
 
 void Button_Task(void)
 {
+	struct _KEY_EVENT ev = {0, 0, 0};
+	float step;
+
+	if (!Key_GetEvent(&ev) || ev.Type == KEY_EV_LONG)
+		ev.Type = 0; // No key action this pass
+	step = FREQ_STEP_PERCENT * ((ev.Rep >= FREQ_FAST_REP) ? 10.0f : 1.0f);
+
 	// KEY1/PA6 : Simultaneously increase frequency of T1, TB1, TA2, TB2
-	if (Key_Scan(KEY1_INC_Freq_GPIO_Port, KEY1_INC_Freq_Pin) == KEY_ON)
+	if (ev.Type && ev.Key == KEY_INC_FREQ)
 	{
 		if (currentPWMFreq < FREQ_MAX)
 		{
-			currentPWMFreq *= (1.0f + (FREQ_STEP_PERCENT / 100.0f)); // Increase by 0.1%
+			currentPWMFreq *= (1.0f + (step / 100.0f)); // Increase by 0.1%, 1% when accelerated
 			if (currentPWMFreq > FREQ_MAX)
 				currentPWMFreq = FREQ_MAX;
 
-			// Update HRTIM frequency
-			if (SetPWMFrequency((uint32_t)currentPWMFreq) != HAL_OK) {
+			// Update HRTIM frequency, at the next period boundary if the prescaler can stay
+			if (RequestPWMFrequency((uint32_t)currentPWMFreq) == HAL_ERROR) {
 				// Handle error
 				Error_Handler();
 			}
@@ -170,16 +157,16 @@ void Button_Task(void)
 	}
 	
 	// KEY2/PA7 : Simultaneously decrease frequency of T1, TB1, TA2, TB2
-	if (Key_Scan(KEY2_DEC_Freq_GPIO_Port, KEY2_DEC_Freq_Pin) == KEY_ON)
+	if (ev.Type && ev.Key == KEY_DEC_FREQ)
 	{
 		if (currentPWMFreq > FREQ_MIN)
 		{
-			currentPWMFreq *= (1.0f - (FREQ_STEP_PERCENT / 100.0f)); // Decrease by 0.1%
+			currentPWMFreq *= (1.0f - (step / 100.0f)); // Decrease by 0.1%, 1% when accelerated
 			if (currentPWMFreq < FREQ_MIN)
 				currentPWMFreq = FREQ_MIN;
 
-			// Update HRTIM frequency
-			if (SetPWMFrequency((uint32_t)currentPWMFreq) != HAL_OK) {
+			// Update HRTIM frequency, at the next period boundary if the prescaler can stay
+			if (RequestPWMFrequency((uint32_t)currentPWMFreq) == HAL_ERROR) {
 				// Handle error
 				Error_Handler();
 			}
@@ -188,48 +175,29 @@ void Button_Task(void)
 	}
 
     // KEY3/PB4: Increase dead time of TA1/TB1
-    if (Key_Scan(KEY3_INC_DT_GPIO_Port, KEY3_INC_DT_Pin) == KEY_ON)
+    if (ev.Type && ev.Key == KEY_INC_DT)
     {
-		if (gCurrentDeadTimePercent < 50)
+		if (gCurrentDeadTimePercent < DEADTIME_MAX_PX1000)
 		{
-			gCurrentDeadTimePercent += 1; // Increase by 0.1%
-
-			if (gCurrentDeadTimePercent > 50)
-				gCurrentDeadTimePercent = 50;
-
-				// Manually adjust dead time
-				SetDeadTimeManual(gCurrentDeadTimePercent);
-
-				// Display dead time
-				DisplayDeadTime((float)gCurrentDeadTimePercent * 0.1f);
-
-				HAL_GPIO_TogglePin(TEST_LED_GPIO_Port, TEST_LED_Pin); 
+			// Increase by 0.1%, applied by the control ISR and shown on the display
+			if (RequestDeadTime(gCurrentDeadTimePercent + DEADTIME_STEP_PX1000))
+				HAL_GPIO_TogglePin(TEST_LED_GPIO_Port, TEST_LED_Pin);
 		}
     }
 
 	// KEY4/PB5: Decrease dead time of TA1/TB1
-    if (Key_Scan(KEY4_DEC_DT_GPIO_Port, KEY4_DEC_DT_Pin) == KEY_ON)
+    if (ev.Type && ev.Key == KEY_DEC_DT)
     {
-		if (gCurrentDeadTimePercent > 0)
+		if (gCurrentDeadTimePercent > DEADTIME_MIN_PX1000)
 		{
-			gCurrentDeadTimePercent -= 1; // Decrease by 0.1%
-
-			//if (gCurrentDeadTimePercent < 1)
-			//	gCurrentDeadTimePercent = 1;
-
-					// Manually adjust dead time
-					SetDeadTimeManual(gCurrentDeadTimePercent);
-
-					// Display dead time
-					DisplayDeadTime((float)gCurrentDeadTimePercent * 0.1f);
-
-
-					HAL_GPIO_TogglePin(TEST_LED_GPIO_Port, TEST_LED_Pin); 
-			}
+			// Decrease by 0.1%, applied by the control ISR and shown on the display
+			if (RequestDeadTime(gCurrentDeadTimePercent - DEADTIME_STEP_PX1000))
+				HAL_GPIO_TogglePin(TEST_LED_GPIO_Port, TEST_LED_Pin);
+		}
     }
 
 	// KEY5/PB6: Simultaneously increase duty cycle of TA2/TB2
-    if (Key_Scan(KEY5_INC_DUTY_GPIO_Port, KEY5_INC_DUTY_Pin) == KEY_ON)
+    if (ev.Type && ev.Key == KEY_INC_DUTY)
     {
 		if (gCurrentDutyPercent_TA2_TB2 < 50)
 		{
@@ -245,13 +213,13 @@ void Button_Task(void)
 				//}
 
 					// Display duty cycle
-					DisplayDutyCycle(gCurrentDutyPercent_TA2_TB2);
+					DisplayDutyCycle(gCurrentDutyPercent_TA2_TB2 * 10);
 
 					HAL_GPIO_TogglePin(TEST_LED_GPIO_Port, TEST_LED_Pin); 
 			}
     }
 	// KEY6/PB7: Simultaneously decrease duty cycle of TA2/TB2
-    if (Key_Scan(KEY6_DEC_DUTY_GPIO_Port, KEY6_DEC_DUTY_Pin) == KEY_ON)
+    if (ev.Type && ev.Key == KEY_DEC_DUTY)
     {
 			if (gCurrentDutyPercent_TA2_TB2 > 0)
 			{
@@ -266,20 +234,17 @@ void Button_Task(void)
 				//	Error_Handler();
 				//}
 					// Display duty cycle
-					DisplayDutyCycle(gCurrentDutyPercent_TA2_TB2);
+					DisplayDutyCycle(gCurrentDutyPercent_TA2_TB2 * 10);
 
 					HAL_GPIO_TogglePin(TEST_LED_GPIO_Port, TEST_LED_Pin); // Toggle LED
 			}
     }
 
     // KEY7/PB9: Switch operating mode
-    if (Key_Scan(KEY7_SWITCH_MODE_GPIO_Port, KEY7_SWITCH_MODE_Pin) == KEY_ON)
+    if (ev.Type == KEY_EV_PRESS && ev.Key == KEY_SWITCH_MODE)
     {
 		Mode_Switch(); // Switch mode
     }
-	// Update OLED display
-	UpdateDisplay();
-
 }
 
 
@@ -295,17 +260,22 @@ Mid-cycle point 50% = 8000
 3. Dead time upper limit is 2%
     
 **     Parameters  :req_tim_freq - Requested PWM frequency (Hz).
-**     Returns     :HAL_StatusTypeDef - Returns HAL_OK on success, HAL_ERROR on failure.
+**     Returns     :HAL_StatusTypeDef - Returns HAL_OK on success, HAL_ERROR on failure
+**       or while the full bridge runs.
 ** ===================================================================*/
 HAL_StatusTypeDef SetPWMFrequency(uint32_t req_tim_freq) {
     uint32_t prescaler_value;
     uint32_t fHRCK;
     uint32_t period;
+    PROF_START(PROF_SETFREQ);
 
     // Define frequency range
     if (req_tim_freq < FREQ_MIN || req_tim_freq > FREQ_MAX) {
         return HAL_ERROR; // Frequency out of range
     }
+    if (Psfb.Active) {
+        return HAL_ERROR; // The bridge runs on the master period, a reset here would break it
+    }
 
     if (req_tim_freq >= 100000) {
         // Use prescaler = MUL16
@@ -361,6 +331,9 @@ HAL_StatusTypeDef SetPWMFrequency(uint32_t req_tim_freq) {
         return HAL_ERROR;
     }
 
+    // Move the ADC trigger point with the period
+    HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A].CMP3xR = HRTIM_ADC_POINT(period);
+
     // Software reset HRTIM's Timer A and Timer B to apply new settings
     if (HAL_HRTIM_SoftwareReset(&hhrtim1, HRTIM_TIMERRESET_TIMER_A | HRTIM_TIMERRESET_TIMER_B) != HAL_OK) {
         return HAL_ERROR;
@@ -368,23 +341,53 @@ HAL_StatusTypeDef SetPWMFrequency(uint32_t req_tim_freq) {
 
     // Update global frequency variables
     currentPWMFreq = req_tim_freq;
+    currentPWMFreqHz = req_tim_freq;
     currentPLLFreq = fHRCK;
 
+    PROF_STOP(PROF_SETFREQ);
     return HAL_OK;
 }
 
+/** ===================================================================
+**     Function Name : RequestPWMFrequency
+**     Description : Change the PWM frequency from thread code. If the
+**       HRTIM prescaler in use covers the new period, the change is
+**       queued and the control ISR applies it at the next period
+**       boundary. Otherwise SetPWMFrequency() reconfigures the timers.
+**     Parameters  : req_tim_freq - Requested PWM frequency (Hz).
+**     Returns     : HAL_OK if applied or queued, HAL_BUSY if the setpoint
+**       queue is full, the voltage loop owns the frequency or the full
+**       bridge runs, HAL_ERROR if out of range or reconfiguration failed.
+** ===================================================================*/
+HAL_StatusTypeDef RequestPWMFrequency(uint32_t req_tim_freq)
+{
+    if (req_tim_freq < FREQ_MIN || req_tim_freq > FREQ_MAX) {
+        return HAL_ERROR; // Frequency out of range
+    }
+    if (Fm.Active || Psfb.Active) {
+        return HAL_BUSY; // The voltage loop sets the frequency in closed-loop mode, the bridge has its own
+    }
+    if (Setp_FreqPeriod(req_tim_freq) == 0) {
+        return SetPWMFrequency(req_tim_freq); // Needs another prescaler
+    }
+    return Setp_Post(SETP_FREQ, req_tim_freq) ? HAL_OK : HAL_BUSY;
+}
+
 
 /**
   * @brief  Manually set dead time.
   * @param  dead_time_percent - New dead time (unit: 0.1%).
-  * @retval None
+  * @retval None. Ignored while the full bridge runs.
   */
 void SetDeadTimeManual(uint8_t dead_time_percent)
 {
     // Ensure dead time is within allowed range
-    if (dead_time_percent > DEADTIME_MAX_PX1000) {
+    if (dead_time_percent < DEADTIME_MIN_PX1000 || dead_time_percent > DEADTIME_MAX_PX1000) {
         return;
     }
+    if (Psfb.Active) {
+        return; // The bridge dead time is in the dead-time generator
+    }
 
     uint32_t period = pGlobalTimeBaseCfg.Period;
     uint32_t dead_time_ticks = (period * dead_time_percent) / 1000; // 0.1% = 1/1000
@@ -420,17 +423,39 @@ void SetDeadTimeManual(uint8_t dead_time_percent)
     }
 }
 
+/** ===================================================================
+**     Function Name : RequestDeadTime
+**     Description : Change the dead time from thread code. The change
+**       is queued for the control ISR, which applies it at the next
+**       period boundary without resetting the timers, and is shown on
+**       the display.
+**     Parameters  : dead_time_px10 - New dead time (unit: 0.1%).
+**     Returns     : 1 if queued, 0 if out of range, the queue is full or
+**       the full bridge runs
+** ===================================================================*/
+uint8_t RequestDeadTime(uint8_t dead_time_px10)
+{
+    if (dead_time_px10 < DEADTIME_MIN_PX1000 || dead_time_px10 > DEADTIME_MAX_PX1000 || Psfb.Active ||
+        !Setp_Post(SETP_DEADTIME, dead_time_px10)) {
+        return 0;
+    }
+    gCurrentDeadTimePercent = dead_time_px10;
+    DisplayDeadTime(dead_time_px10);
+    return 1;
+}
+
 
 
 
 /**
   * @brief  Set PWM duty cycle for TA1/TB1.
   * @param  duty_percent - New duty cycle (percentage).
-  * @retval HAL_StatusTypeDef - Returns HAL_OK on success, HAL_ERROR on failure.
+  * @retval HAL_StatusTypeDef - Returns HAL_OK on success, HAL_ERROR on failure
+  *         or while the full bridge runs.
   */
 HAL_StatusTypeDef SetDutyCycle_TA1_TB1(uint8_t duty_percent)
 {
-    if (duty_percent < 5 || duty_percent > 95)
+    if (duty_percent < 5 || duty_percent > 95 || Psfb.Active)
     {
         return HAL_ERROR;
     }
@@ -459,11 +484,12 @@ HAL_StatusTypeDef SetDutyCycle_TA1_TB1(uint8_t duty_percent)
 /**
   * @brief  Set PWM duty cycle for TA2/TB2.
   * @param  duty_percent - New duty cycle (percentage).
-  * @retval HAL_StatusTypeDef - Returns HAL_OK on success, HAL_ERROR on failure.
+  * @retval HAL_StatusTypeDef - Returns HAL_OK on success, HAL_ERROR on failure
+  *         or while the full bridge runs.
   */
 HAL_StatusTypeDef SetDutyCycle_TA2_TB2(uint8_t duty_percent)
 {
-    if (duty_percent < 5 || duty_percent > 45)
+    if (duty_percent < 5 || duty_percent > 45 || Psfb.Active)
     {
         return HAL_ERROR;
     }
@@ -513,6 +539,7 @@ CCMRAM void ADCSample(void)
 {
 	// Declare variables for averaging Vin, Iin, Vout, and Iout
 	static uint32_t VinAvgSum=0, IinAvgSum=0, VoutAvgSum=0, IoutAvgSum=0;
+	PROF_START(PROF_ADCSAMPLE);
 	
 	// Convert ADC readings using calibration factors (Q15 format), including offset compensation
 	SADC.Vin  = ((uint32_t)ADC1_RESULT[0] * CAL_VIN_K >> 12) + CAL_VIN_B;
@@ -546,6 +573,218 @@ CCMRAM void ADCSample(void)
 	
 	IoutAvgSum = IoutAvgSum + SADC.Iout - (IoutAvgSum >> 2); // Add current Iout value and subtract the oldest value
 	SADC.IoutAvg = IoutAvgSum >> 2; // Update Iout average
+	PROF_STOP(PROF_ADCSAMPLE);
+}
+
+/** ===================================================================
+**     Function Name : void Control_Period(void)
+**     Description : Work of one PWM period, run by the Timer A
+**       repetition interrupt: apply queued setpoints, sample, run the
+**       frequency loop, or the voltage loop on the full bridge or a
+**       buck-boost layout, check the samples and trip on a short,
+**       publish the state and record it
+**     Parameters  :
+**     Returns     :
+** ===================================================================*/
+CCMRAM void Control_Period(void)
+{
+	PROF_START(PROF_ISR);
+	Setp_Apply();
+	ADCSample();
+	Fm_Step(); // Closed-loop mode: the voltage loop sets the period
+#if ADC_VOUT_SENSE
+	if(Psfb.Active || VLOOP_BUCKBOOST)
+		VLOOP_RUN(); // The voltage loop sets the bridge phase, or the buck-boost duties with burst mode and pulse skipping
+#endif
+	Fault_Sample();
+#if ADC_VOUT_SENSE
+	ShortOff(); // Cycle-level short-circuit trip on the Iout samples
+#endif
+	Snap_Publish();
+	BlackBox_Record();
+	PROF_STOP(PROF_ISR);
+}
+
+// Latch a fault and shut the PWM outputs down
+static void Prot_Trip(uint16_t flag)
+{
+	DF.ErrFlag |= flag;
+	DF.SMFlag = Err;
+	DF.PWMENFlag = 0;
+	HAL_HRTIM_WaveformOutputStop(&hhrtim1, HRTIM_OUTPUT_TA1 | HRTIM_OUTPUT_TA2 | HRTIM_OUTPUT_TB1 | HRTIM_OUTPUT_TB2);
+}
+
+// Control state seen by the protection checks, taken once per Protect_Task() run
+static struct _SNAP ProtSnap;
+
+/** ===================================================================
+**     Function Name : void VoutSwOVP(void)
+**     Description : Software output over-voltage protection. Vout average
+**       above VOUT_OVP_VAL for PROT_TRIP_CNT runs in a row latches
+**       F_SW_VOUT_OVP and shuts the outputs down. Needs ADC_VOUT_SENSE,
+**       see Protect_Task().
+**     Parameters  :
+**     Returns     :
+** ===================================================================*/
+void VoutSwOVP(void)
+{
+	static uint16_t OVPCnt = 0;
+
+	if(ProtSnap.Adc.VoutAvg > VOUT_OVP_VAL)
+	{
+		if(++OVPCnt >= PROT_TRIP_CNT)
+		{
+			OVPCnt = 0;
+			Prot_Trip(F_SW_VOUT_OVP);
+		}
+	}
+	else
+		OVPCnt = 0;
+}
+
+/** ===================================================================
+**     Function Name : void SwOCP(void)
+**     Description : Software output over-current protection. Iout average
+**       above IOUT_OCP_VAL for PROT_TRIP_CNT runs in a row latches
+**       F_SW_IOUT_OCP and shuts the outputs down. Needs ADC_VOUT_SENSE,
+**       see Protect_Task().
+**     Parameters  :
+**     Returns     :
+** ===================================================================*/
+void SwOCP(void)
+{
+	static uint16_t OCPCnt = 0;
+
+	if(ProtSnap.Adc.IoutAvg > IOUT_OCP_VAL)
+	{
+		if(++OCPCnt >= PROT_TRIP_CNT)
+		{
+			OCPCnt = 0;
+			Prot_Trip(F_SW_IOUT_OCP);
+		}
+	}
+	else
+		OCPCnt = 0;
+}
+
+/** ===================================================================
+**     Function Name : void ShortOff(void)
+**     Description : Short-circuit protection, from the control ISR after
+**       ADCSample(). Iout samples above IOUT_SHORT_VAL for SHORT_TRIP_CNT
+**       periods in a row latch F_SW_SHORT and shut the outputs down, long
+**       before the averaged SwOCP() would. The outputs are stopped through
+**       ODISR: the thread may hold the HRTIM handle lock. Needs
+**       ADC_VOUT_SENSE, see Protect_Task().
+**     Parameters  :
+**     Returns     :
+** ===================================================================*/
+CCMRAM void ShortOff(void)
+{
+	static uint8_t ShortCnt = 0;
+
+	if(SADC.Iout <= IOUT_SHORT_VAL)
+	{
+		ShortCnt = 0;
+		return;
+	}
+	if(++ShortCnt < SHORT_TRIP_CNT || (DF.ErrFlag & F_SW_SHORT))
+		return;
+	HRTIM1->sCommonRegs.ODISR = HRTIM_OUTPUT_TA1 | HRTIM_OUTPUT_TA2 | HRTIM_OUTPUT_TB1 | HRTIM_OUTPUT_TB2;
+	DF.ErrFlag |= F_SW_SHORT;
+	DF.SMFlag = Err;
+	DF.PWMENFlag = 0;
+}
+
+/** ===================================================================
+**     Function Name : void Protect_Task(void)
+**     Description : Protection task, 1ms. Vin is not checked: on this
+**       board ADC1_RESULT[0] carries the potentiometer, not Vin. Vout
+**       and Iout are checked only with ADC_VOUT_SENSE: without it
+**       ADC1_RESULT[2] and [3] are never converted, their averages sit
+**       at 0V and 0A and the checks could never trip.
+**     Parameters  :
+**     Returns     :
+** ===================================================================*/
+void Protect_Task(void)
+{
+	Snap_Read(&ProtSnap);
+	Fault_Poll();
+#if ADC_VOUT_SENSE
+	VoutSwOVP();
+	SwOCP();
+#endif
+}
+
+/** ===================================================================
+**     Function Name : void SoftStart_Task(void)
+**     Description : Soft-start task, 10ms. SSInit holds the reference at
+**       zero, SSWait waits SS_WAIT_CNT fault-free runs and enables the
+**       loop output, SSRun ramps Voref to VOUT_REF_SET by SS_STEP per
+**       run. A fault sends it back to SSInit. Only the voltage loops
+**       read Voref, so without ADC_VOUT_SENSE the ramp just steps the
+**       state flags.
+**     Parameters  :
+**     Returns     :
+** ===================================================================*/
+void SoftStart_Task(void)
+{
+	static uint16_t SSCnt = 0;
+
+	switch(STState)
+	{
+		case SSInit:
+			CtrValue.Voref = 0;
+			DF.PWMENFlag = 0;
+			SSCnt = 0;
+			STState = SSWait;
+			break;
+		case SSWait:
+			if(DF.ErrFlag != F_NOERR)
+			{
+				SSCnt = 0;
+				break;
+			}
+			if(++SSCnt >= SS_WAIT_CNT)
+			{
+				DF.PWMENFlag = 1;
+				DF.SMFlag = Rise;
+				STState = SSRun;
+			}
+			break;
+		case SSRun:
+			if(DF.ErrFlag != F_NOERR)
+			{
+				STState = SSInit;
+				break;
+			}
+			if(CtrValue.Voref < VOUT_REF_SET)
+			{
+				CtrValue.Voref += SS_STEP;
+				if(CtrValue.Voref >= VOUT_REF_SET)
+				{
+					CtrValue.Voref = VOUT_REF_SET;
+					DF.SMFlag = Run;
+				}
+			}
+			break;
+	}
+}
+
+/** ===================================================================
+**     Function Name : void Display_Task(void)
+**     Description : Display task, 50ms: update the OLED fields and send
+**       the changed parts of the frame buffer.
+**     Parameters  :
+**     Returns     :
+** ===================================================================*/
+void Display_Task(void)
+{
+	UpdateDisplay();
+	{
+		PROF_START(PROF_OLEDFLUSH);
+		OLED_Refresh(); // Send the frame buffer, skipped while the previous frame is in flight
+		PROF_STOP(PROF_OLEDFLUSH);
+	}
 }
 
 
@@ -556,21 +795,36 @@ CCMRAM void ADCSample(void)
 volatile uint8_t currentMode = MODE_OPEN_LOOP;
 
 /**
-  * @brief  Switch mode function
+  * @brief  Switch mode function. Refused while the phase-shifted bridge
+  *         runs: both modes reconfigure Timers A and B. On a buck-boost
+  *         layout (VLOOP_BUCKBOOST) closed-loop mode is refused: the duty
+  *         loop already regulates Vout and the frequency loop would fight it.
   * @retval None
   */
 void Mode_Switch(void)
 {
+    if (Psfb.Active)
+    {
+        return; // The bridge has its own period, neither mode applies
+    }
+#if VLOOP_BUCKBOOST
+    if (currentMode == MODE_OPEN_LOOP)
+    {
+        return; // The duty loop owns Vout, the stage stays in open-loop frequency mode
+    }
+#endif
+
     if (currentMode == MODE_OPEN_LOOP)
     {
         currentMode = MODE_CLOSED_LOOP;
 
-        // Initialize frequency to 100 kHz
-        currentPWMFreq = 100000.0f;
-        if (SetPWMFrequency((uint32_t)currentPWMFreq) != HAL_OK)
+#if ADC_VOUT_SENSE
+        // Hand the frequency to the voltage loop, from 100 kHz
+        if (Fm_Start() != HAL_OK)
         {
             Error_Handler();
         }
+#endif
 
         // Display mode change
         OLED_ShowStr(55, 0, "Close", 2);
@@ -578,6 +832,7 @@ void Mode_Switch(void)
     else
     {
         currentMode = MODE_OPEN_LOOP;
+        Fm_Stop(); // Take the frequency back from the voltage loop
 
         // Initialize frequency to 100 kHz
         currentPWMFreq = 100000.0f;
@@ -606,24 +861,22 @@ void Mode_Switch(void)
   */
 void UpdateDisplay(void)
 {
+    struct _SNAP snap;
+
+    PROF_START(PROF_DISPLAY);
+    Snap_Read(&snap); // One coherent copy of the control state for this refresh
+
     // Display different information based on mode
     if (currentMode == MODE_CLOSED_LOOP)
     {
-        // Closed-loop mode: Display frequency converted from ADC voltage value
-
-        // Ensure ADC has sampled
-		HAL_ADC_Start_DMA(&hadc1, (uint32_t*)ADC1_RESULT, 4); // Start ADC1 sampling, DMA transfer for sampling input/output voltage and current
-		HAL_ADC_Start(&hadc1); // Start ADC2 sampling, sampling the sliding potentiometer voltage
-
-        ADCSample();
-
-        // Convert ADC voltage to 0-3.3V
-        float adc_voltage = (SADC.VinAvg / 4095.0f) * 3.3f;
-
-        // Calculate corresponding frequency
-        // Mid value 1.65V corresponds to 100 kHz
-        // Set frequency range from 50 kHz to 150 kHz
-        float frequency = 100000.0f + ((adc_voltage - 1.65f) / 1.65f) * 50000.0f; // 50 kHz
+#if ADC_VOUT_SENSE
+        // Closed-loop mode: display the frequency the voltage loop has set in the control ISR
+		currentPWMFreqHz = Fm_FreqHz();
+#else
+        // Closed-loop mode without the Vout sense: the potentiometer sets the
+        // frequency. The HRTIM-triggered scan keeps VinAvg fresh every period.
+        // 0-3.3V maps to 50-150 kHz, mid scale 100 kHz, integer math only.
+        uint32_t frequency = 50000 + (uint32_t)snap.Adc.VinAvg * 100000 / 4095;
 
         // Limit frequency range
         if (frequency < FREQ_MIN)
@@ -631,44 +884,16 @@ void UpdateDisplay(void)
         if (frequency > FREQ_MAX)
             frequency = FREQ_MAX;
 
-		// Update global frequency variable
-		currentPWMFreq = frequency;
-		//currentPLLFreq = fHRCK; // Ensure fHRCK is correctly calculated and defined
-		
-		// Set PWM frequency
-		if (SetPWMFrequency((uint32_t)currentPWMFreq) != HAL_OK)
-		{
-			Error_Handler();
-		}
-		
-		// Display frequency, keeping two decimal places
-		unsigned char freqStr[10]; // Changed to unsigned char array
-		sprintf((char *)freqStr, "%.2f", currentPWMFreq / 1000.0f); // For example, "100.00KHz"
-		
-		// Clear previous display area (adjust number of spaces as needed)
-		//OLED_ShowStr(45, 2, "		 ", 2); // Clear previous display at (45,2)
-		// Display new frequency
-		OLED_ShowStr(45, 2, (unsigned char *)(freqStr), 2); // Display current frequency at (45,2)
-
-
-	 	// Display ADC voltage value
-		// Convert ADC voltage to 0-3.3V
-		float adc_voltage_display = (SADC.VinAvg / 4095.0f) * 3.3f;
-	
-		// Convert voltage value to display format (mV)
-		uint8_t Vtemp[4] = {0};
-		uint32_t Vdisplay = (uint32_t)(adc_voltage_display * 1000.0f); // Convert to mV
-	
-		Vtemp[0] = (uint8_t)(Vdisplay / 1000);
-		Vtemp[1] = (uint8_t)((Vdisplay % 1000) / 100);
-		Vtemp[2] = (uint8_t)((Vdisplay % 100) / 10);
-		Vtemp[3] = (uint8_t)(Vdisplay % 10);
-	
-		// Display ADC voltage
-		OLEDShowData(50, 6, Vtemp[0]);
-		OLEDShowData(65, 6, Vtemp[1]);
-		OLEDShowData(75, 6, Vtemp[2]);
-		OLEDShowData(85, 6, Vtemp[3]);
+		// Queued for the control ISR, no timer reset unless the prescaler changes.
+		// Setp_Apply() updates currentPWMFreqHz once it is applied.
+		RequestPWMFrequency(frequency);
+#endif
+
+		// Display frequency in kHz with two decimal places, e.g. "100.00"
+		OLED_ShowFix(45, 2, (int32_t)(currentPWMFreqHz / 10), 2, 6, 2); // Display current frequency at (45,2)
+
+	 	// Display ADC voltage value, 0-3.3V as mV with three decimal places
+		OLED_ShowFix(50, 6, snap.Adc.VinAvg * 3300 / 4095, 3, 5, 2);
 
     }
     else
@@ -688,11 +913,8 @@ void UpdateDisplay(void)
 		//OLED_ShowStr(60, 6, ".", 2);
 		//OLED_ShowStr(95, 6, "V", 2);
 
-		// Display frequency, keeping two decimal places
-		 unsigned char freqStr[10]; // Use unsigned char
-        sprintf((char *)freqStr, "%.2f", currentPWMFreq / 1000.0f); // "100.00KHz"
-		//OLED_ShowStr(45, 2, "		 ", 2); // Clear previous display
-		OLED_ShowStr(45, 2, freqStr, 2); // Display current frequency
+		// Display frequency in kHz with two decimal places, e.g. "100.00"
+		OLED_ShowFix(45, 2, (int32_t)(currentPWMFreqHz / 10), 2, 6, 2); // Display current frequency
 	
 
 
@@ -700,6 +922,8 @@ void UpdateDisplay(void)
 
 
     // Optional: Display other data, such as Iout, etc.
+
+    PROF_STOP(PROF_DISPLAY);
 }
 
 
@@ -733,24 +957,20 @@ void Open_Mode_Init(void)
 
 	// Display dead time
 	gCurrentDeadTimePercent = 2;
-	DisplayDeadTime((float)gCurrentDeadTimePercent);
+	DisplayDeadTime(gCurrentDeadTimePercent);
 
 	// Display duty cycle
 	gCurrentDutyPercent_TA2_TB2 = 48;
-	DisplayDutyCycle(gCurrentDutyPercent_TA2_TB2);
+	DisplayDutyCycle(gCurrentDutyPercent_TA2_TB2 * 10);
 
 	OLED_ShowStr(0, 6, "ADC:", 2);
-	OLED_ShowStr(60, 6, ".", 2);
 	OLED_ShowStr(95, 6, "V", 2);
 
 	// Display ADC voltage
-	uint8_t Vtemp[4] = {0};
-	OLEDShowData(50, 6, Vtemp[0]);
-	OLEDShowData(65, 6, Vtemp[1]);
-	OLEDShowData(75, 6, Vtemp[2]);
-	OLEDShowData(85, 6, Vtemp[3]);
+	OLED_ShowFix(50, 6, 0, 3, 5, 2);
 
 	OLED_ON(); // Turn on the OLED display
+	OLED_Refresh(); // Starts the panel bring-up, returns at once
 }
 
 
@@ -785,16 +1005,17 @@ void MX_OLED_Init(void)
 	OLED_ShowStr(95, 6, "KHz", 2);
 
 	OLED_ON(); // Turn on the OLED display
+	OLED_Refresh(); // Starts the panel bring-up, returns at once
 }
 
 
 
 /**
   * @brief  Display Duty Cycle on OLED
-  * @param  duty_percent - Current duty cycle percentage (e.g., 36.0 represents 36.0%)
+  * @param  duty_px10 - Current duty cycle in 0.1% steps (e.g., 360 represents 36.0%)
   * @retval None
   */
-void DisplayDutyCycle(float duty_percent)
+void DisplayDutyCycle(uint16_t duty_px10)
 {
     // Limit duty cycle within allowed range
     //if (duty_percent < (float)DUTY_MIN_PX10 / 10.0f)
@@ -802,21 +1023,17 @@ void DisplayDutyCycle(float duty_percent)
     //if (duty_percent > (float)DUTY_MAX_PX10 / 10.0f)
     //    duty_percent = (float)DUTY_MAX_PX10 / 10.0f;
 
-    // Format duty cycle string, keeping one decimal place
-    unsigned char dutyStr[10];
-    sprintf((char *)dutyStr, "%.1f", duty_percent);
-
-    // Display duty cycle, adjust coordinates according to OLED initialization
+    // Display duty cycle with one decimal place, adjust coordinates according to OLED initialization
     // Assume "Duty:" label is at (0,4), value is displayed at (50,4)
-    OLED_ShowStr(50, 4, dutyStr, 2); // Adjust x, y coordinates to fit your display layout
+    OLED_ShowFix(50, 4, duty_px10, 1, 4, 2); // Adjust x, y coordinates to fit your display layout
 }
 
 /**
   * @brief  Display Dead Time on OLED
-  * @param  dead_time_percent - Current dead time percentage (e.g., 2.0 represents 2.0%)
+  * @param  dead_time_px10 - Current dead time in 0.1% steps (e.g., 20 represents 2.0%)
   * @retval None
   */
-void DisplayDeadTime(float dead_time_percent)
+void DisplayDeadTime(uint16_t dead_time_px10)
 {
     // Limit dead time within allowed range
     //if (dead_time_percent < (float)DEADTIME_MIN_PX1000 / 10.0f)
@@ -824,13 +1041,9 @@ void DisplayDeadTime(float dead_time_percent)
     //if (dead_time_percent > (float)DEADTIME_MAX_PX1000 / 10.0f)
     //    dead_time_percent = (float)DEADTIME_MAX_PX1000 / 10.0f;
 
-    // Format dead time string, keeping one decimal place
-    unsigned char deadTimeStr[10];
-    sprintf((char *)deadTimeStr, "%.1f", dead_time_percent);
-
-    // Display dead time, adjust coordinates according to OLED initialization
+    // Display dead time with one decimal place, adjust coordinates according to OLED initialization
     // Assume "Du/DT:" label is at (0,4), value is displayed at (95,4)
-    OLED_ShowStr(95, 4, deadTimeStr, 2); // Adjust x, y coordinates to fit your display layout
+    OLED_ShowFix(95, 4, dead_time_px10, 1, 3, 2); // Adjust x, y coordinates to fit your display layout
 }
 
 
@@ -844,9 +1057,26 @@ void DisplayDeadTime(float dead_time_percent)
   * @param  duty_cycle: Duty cycle
   * @param  dead_time: Dead time
   * @retval HAL_StatusTypeDef: Returns HAL_OK on success, HAL_ERROR on failure
+  *
+  *         half_period and duty_cycle are in 1/16000 of the period, dead_time
+  *         in counts. TA1 is on for half - dead from the period start and TB1,
+  *         half a period later, for as long; TA2 and TB2 are on for duty.
+  *         Settings where TA and TB would be on together are refused and the
+  *         timers are left as they are, as is any setting while the full
+  *         bridge runs.
   */
-void UpdateHRTIM(int period, int half_period, int duty_cycle, int dead_time)
+HAL_StatusTypeDef UpdateHRTIM(int period, int half_period, int duty_cycle, int dead_time)
 {
+    int half = half_period * period / 16000;
+    int duty = duty_cycle * period / 16000;
+
+    if (period < CNTR_MIN || period > CNTR_MAX || half_period < 0 || duty_cycle < 0 || dead_time < 0 || Psfb.Active) {
+        return HAL_ERROR;
+    }
+    // TB1 must be off before TA1 comes on again, TB2 must not start before TA2 ends
+    if (dead_time > half || 2 * half - dead_time > period || duty > half || half + duty > period) {
+        return HAL_ERROR;
+    }
     /* USER CODE END HRTIM1_Init 0 */
 
     HRTIM_TimeBaseCfgTypeDef timeBaseConfig = {0};
@@ -1036,6 +1266,8 @@ void UpdateHRTIM(int period, int half_period, int duty_cycle, int dead_time)
 	// Store global time base configuration
 	pGlobalTimeBaseCfg = timeBaseConfig;
 
+    HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A].CMP3xR = HRTIM_ADC_POINT(period); // ADC trigger point
+
     // Start four PWM outputs (TA1, TA2, TB1, TB2)
     HAL_HRTIM_WaveformOutputStart(&hhrtim1, HRTIM_OUTPUT_TA1 | HRTIM_OUTPUT_TA2 | HRTIM_OUTPUT_TB1 | HRTIM_OUTPUT_TB2); // Enable all PWM outputs
     // Start Timer A and Timer B
@@ -1044,6 +1276,7 @@ void UpdateHRTIM(int period, int half_period, int duty_cycle, int dead_time)
 	/* USER CODE END HRTIM1_Init 2 */
     HAL_HRTIM_MspPostInit(&hhrtim1);
 
+    return HAL_OK;
 }
 
 
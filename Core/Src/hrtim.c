@@ -21,6 +21,8 @@
 #include "hrtim.h"
 
 /* USER CODE BEGIN 0 */
+#include "burst.h"
+#include "psfb.h"
 extern HRTIM_TimeBaseCfgTypeDef pGlobalTimeBaseCfg;
 
 /* USER CODE END 0 */
@@ -128,7 +130,7 @@ void MX_HRTIM1_Init(void)
   pOutputCfg.Polarity = HRTIM_OUTPUTPOLARITY_LOW;
   pOutputCfg.SetSource = HRTIM_OUTPUTSET_TIMCMP2;
   pOutputCfg.ResetSource = HRTIM_OUTPUTRESET_TIMPER;
-  pOutputCfg.IdleMode = HRTIM_OUTPUTIDLEMODE_NONE;
+  pOutputCfg.IdleMode = HRTIM_OUTPUTIDLEMODE_IDLE;
   pOutputCfg.IdleLevel = HRTIM_OUTPUTIDLELEVEL_INACTIVE;
   pOutputCfg.FaultLevel = HRTIM_OUTPUTFAULTLEVEL_NONE;
   pOutputCfg.ChopperModeEnable = HRTIM_OUTPUTCHOPPERMODE_DISABLED;
@@ -181,6 +183,21 @@ void MX_HRTIM1_Init(void)
   /* USER CODE BEGIN HRTIM1_Init 2 */
   // sxɰtm
 	  pGlobalTimeBaseCfg = pTimeBaseCfg;
+	  Burst_Init(); // Light-load burst mode controller, started by the voltage loop
+	  Psfb.Active = 0; // Buck-boost layout, Psfb_Init() turns it into the bridge
+
+	  // ADC trigger 1 starts the ADC1 scan at Timer A CMP3 each period
+	  {
+	    HRTIM_ADCTriggerCfgTypeDef adcTrigCfg = {0};
+
+	    adcTrigCfg.UpdateSource = HRTIM_ADCTRIGGERUPDATE_TIMER_A;
+	    adcTrigCfg.Trigger = HRTIM_ADCTRIGGEREVENT13_TIMERA_CMP3;
+	    if (HAL_HRTIM_ADCTriggerConfig(&hhrtim1, HRTIM_ADCTRIGGER_1, &adcTrigCfg) != HAL_OK)
+	    {
+	      Error_Handler();
+	    }
+	    HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A].CMP3xR = HRTIM_ADC_POINT(pTimeBaseCfg.Period);
+	  }
 
   /* USER CODE END HRTIM1_Init 2 */
   HAL_HRTIM_MspPostInit(&hhrtim1);
@@ -198,7 +215,9 @@ void HAL_HRTIM_MspInit(HRTIM_HandleTypeDef* hrtimHandle)
     /* HRTIM1 clock enable */
     __HAL_RCC_HRTIM1_CLK_ENABLE();
   /* USER CODE BEGIN HRTIM1_MspInit 1 */
-
+    /* HRTIM1 timer A interrupt Init, repetition event drives the control ISR */
+    HAL_NVIC_SetPriority(HRTIM1_TIMA_IRQn, IRQ_PRIO_CONTROL, 0);
+    HAL_NVIC_EnableIRQ(HRTIM1_TIMA_IRQn);
   /* USER CODE END HRTIM1_MspInit 1 */
   }
 }
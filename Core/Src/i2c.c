@@ -125,7 +125,11 @@ void HAL_I2C_MspInit(I2C_HandleTypeDef* i2cHandle)
     __HAL_LINKDMA(i2cHandle,hdmatx,hdma_i2c3_tx);
 
   /* USER CODE BEGIN I2C3_MspInit 1 */
-
+    /* I2C3 interrupt Init, the DMA transfer completes in the event interrupt */
+    HAL_NVIC_SetPriority(I2C3_EV_IRQn, IRQ_PRIO_COMM, 0);
+    HAL_NVIC_EnableIRQ(I2C3_EV_IRQn);
+    HAL_NVIC_SetPriority(I2C3_ER_IRQn, IRQ_PRIO_COMM, 0);
+    HAL_NVIC_EnableIRQ(I2C3_ER_IRQn);
   /* USER CODE END I2C3_MspInit 1 */
   }
 }
@@ -152,7 +156,8 @@ void HAL_I2C_MspDeInit(I2C_HandleTypeDef* i2cHandle)
     /* I2C3 DMA DeInit */
     HAL_DMA_DeInit(i2cHandle->hdmatx);
   /* USER CODE BEGIN I2C3_MspDeInit 1 */
-
+    HAL_NVIC_DisableIRQ(I2C3_EV_IRQn);
+    HAL_NVIC_DisableIRQ(I2C3_ER_IRQn);
   /* USER CODE END I2C3_MspDeInit 1 */
   }
 }
@@ -0,0 +1,85 @@
+/**
+  ******************************************************************************
+  * @file    jitter.c
+  * @brief   Control ISR entry jitter histogram.
+  *
+  *          With JITTER_PROBE set, the control ISR calls Jitter_Sample() as
+  *          its first statement. The DWT cycle count between two entries is
+  *          compared with the nominal interval derived from the timer A
+  *          period, prescaler and repetition registers (fHRTIM = SYSCLK), and
+  *          the difference goes into a histogram. Any latency added by other
+  *          interrupts or by masked sections shows up as spread around zero.
+  ******************************************************************************
+  */
+#include "jitter.h"
+#include "function.h"
+#include "dwt.h"
+#include "stdio.h"
+
+struct _JITTER Jitter;
+
+/** ===================================================================
+**     Function Name : void Jitter_Sample(void)
+**     Description : Record one control ISR entry. The first interval
+**       after a period or prescaler change is skipped.
+**     Parameters  :
+**     Returns     :
+** ===================================================================*/
+CCMRAM void Jitter_Sample(void)
+{
+	uint32_t now = DWT_CYCLES();
+	uint32_t per = HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A].PERxR;
+	uint32_t ckpsc = HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A].TIMxCR & HRTIM_TIMCR_CK_PSC;
+	uint32_t rep = HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A].REPxR;
+	uint32_t nom = ((per * (rep + 1)) << ckpsc) >> 5;//CKPSC 0 counts at 32 x fHRTIM
+	int32_t j, bin;
+
+	if(nom == Jitter.Nom)
+	{
+		j = (int32_t)(now - Jitter.Last - nom);
+		if(Jitter.Cnt == 0 || j < Jitter.Min)
+			Jitter.Min = j;
+		if(Jitter.Cnt == 0 || j > Jitter.Max)
+			Jitter.Max = j;
+		Jitter.Cnt++;
+
+		bin = j + JIT_BINS * JIT_BIN_CYC / 2;
+		if(bin < 0)
+			bin = 0;
+		bin /= JIT_BIN_CYC;
+		if(bin >= JIT_BINS)
+			bin = JIT_BINS - 1;
+		Jitter.Hist[bin]++;
+	}
+	Jitter.Nom = nom;
+	Jitter.Last = now;
+}
+
+/** ===================================================================
+**     Function Name : uint8_t Jitter_Format(uint8_t line, char *buf)
+**     Description : Telemetry lines: a summary, then the histogram in two
+**       lines of eight bins, lowest bin first
+**     Parameters  : line - line number, from 0
+**                   buf - receives the line, at least 128 bytes
+**     Returns     : 1 if a line was written, 0 past the last line
+** ===================================================================*/
+uint8_t Jitter_Format(uint8_t line, char *buf)
+{
+	const uint32_t *h;
+
+	if(line == 0)
+	{
+		sprintf(buf, "[JIT] n=%u nom=%u min=%d max=%d bin=%dcyc from %d\r\n",
+			(unsigned)Jitter.Cnt, (unsigned)Jitter.Nom, (int)Jitter.Min, (int)Jitter.Max,
+			JIT_BIN_CYC, -(JIT_BINS * JIT_BIN_CYC / 2));
+		return 1;
+	}
+	if(line > 2)
+		return 0;
+
+	h = &Jitter.Hist[(line - 1) * 8];
+	sprintf(buf, "[JIT] %u %u %u %u %u %u %u %u\r\n",
+		(unsigned)h[0], (unsigned)h[1], (unsigned)h[2], (unsigned)h[3],
+		(unsigned)h[4], (unsigned)h[5], (unsigned)h[6], (unsigned)h[7]);
+	return 1;
+}
@@ -0,0 +1,175 @@
+/**
+  ******************************************************************************
+  * @file    key.c
+  * @brief   Debounced keypad with press, long-press and auto-repeat events.
+  *
+  *          Key_Tick() runs from the TIM2 update interrupt. Every KEY_SCAN_MS
+  *          it reads each key port once and debounces all of its key pins
+  *          together with a 2-bit vertical counter, so a level must be stable
+  *          for four scans (20ms) to be taken. Per-key hold timers then
+  *          produce the events, which go through a single-producer /
+  *          single-consumer queue to Button_Task() in the main loop.
+  ******************************************************************************
+  */
+#include "key.h"
+#include "ring.h"
+
+// Debounce state of one GPIO port, one bit per pin
+struct _KEY_PORT
+{
+	GPIO_TypeDef	*Port;
+	uint16_t		Mask;//Key pins on this port
+	uint16_t		State;//Debounced level, 1 = pressed
+	uint16_t		Cnt0;//Vertical counter bit 0
+	uint16_t		Cnt1;//Vertical counter bit 1
+};
+
+static struct _KEY_PORT KeyPort[] =
+{
+	{GPIOA, KEY1_INC_Freq_Pin | KEY2_DEC_Freq_Pin, 0, 0xFFFF, 0xFFFF},
+	{GPIOB, KEY3_INC_DT_Pin | KEY4_DEC_DT_Pin | KEY5_INC_DUTY_Pin | KEY6_DEC_DUTY_Pin | KEY7_SWITCH_MODE_Pin, 0, 0xFFFF, 0xFFFF},
+};
+#define KEY_PORT_NUM	(sizeof(KeyPort) / sizeof(KeyPort[0]))
+
+// Key ID to port and pin, in KEY_xxx order
+static const struct
+{
+	uint8_t		Port;//Index into KeyPort[]
+	uint16_t	Pin;
+} KeyMap[KEY_NUM] =
+{
+	{0, KEY1_INC_Freq_Pin},
+	{0, KEY2_DEC_Freq_Pin},
+	{1, KEY3_INC_DT_Pin},
+	{1, KEY4_DEC_DT_Pin},
+	{1, KEY5_INC_DUTY_Pin},
+	{1, KEY6_DEC_DUTY_Pin},
+	{1, KEY7_SWITCH_MODE_Pin},
+};
+
+// Hold timers in scans
+static uint16_t KeyHold[KEY_NUM];//Scans since press
+static uint16_t KeyNext[KEY_NUM];//KeyHold value of the next long/repeat event
+static uint16_t KeyRepInt[KEY_NUM];//Current repeat interval
+static uint16_t KeyRep[KEY_NUM];//Repeats sent in this hold
+
+// Event queue, written only by Key_Tick(), read only by Key_GetEvent()
+RING_DEFINE(KeyQueue, struct _KEY_EVENT, KEY_QUEUE_LEN);
+static uint8_t KeyDiv = 0;
+
+static void Key_Post(uint8_t key, uint8_t type, uint16_t rep)
+{
+	struct _KEY_EVENT ev;
+
+	ev.Key = key;
+	ev.Type = type;
+	ev.Rep = rep;
+	Ring_Put(&KeyQueue, &ev);//Dropped if the consumer is behind
+}
+
+/** ===================================================================
+**     Function Name : void Key_Init(void)
+**     Description : Reset the debounce state and drop queued events.
+**       Call before TIM2 is started.
+**     Parameters  :
+**     Returns     :
+** ===================================================================*/
+void Key_Init(void)
+{
+	uint8_t i;
+
+	for(i=0;i<KEY_PORT_NUM;i++)
+	{
+		KeyPort[i].State = 0;
+		KeyPort[i].Cnt0 = 0xFFFF;
+		KeyPort[i].Cnt1 = 0xFFFF;
+	}
+	for(i=0;i<KEY_NUM;i++)
+		KeyHold[i] = 0;
+	Ring_Flush(&KeyQueue);
+	KeyDiv = 0;
+}
+
+/** ===================================================================
+**     Function Name : void Key_Tick(void)
+**     Description : Scan and debounce the keys, post their events.
+**       Called from the TIM2 update interrupt at KEY_TICK_HZ, does the
+**       work every KEY_SCAN_DIV calls.
+**     Parameters  :
+**     Returns     :
+** ===================================================================*/
+void Key_Tick(void)
+{
+	struct _KEY_PORT *p;
+	uint16_t chg, prs, bit;
+	uint8_t i;
+
+	if(++KeyDiv < KEY_SCAN_DIV)
+		return;
+	KeyDiv = 0;
+
+	for(i=0;i<KEY_PORT_NUM;i++)
+	{
+		p = &KeyPort[i];
+		// Keys pull the pin low when pressed
+		chg = p->State ^ (~p->Port->IDR & p->Mask);
+		// Count scans with a changed level, restart on any bounce
+		p->Cnt0 = ~(p->Cnt0 & chg);
+		p->Cnt1 = p->Cnt0 ^ (p->Cnt1 & chg);
+		chg &= p->Cnt0 & p->Cnt1;//Changed for four scans in a row
+		p->State ^= chg;
+	}
+
+	for(i=0;i<KEY_NUM;i++)
+	{
+		p = &KeyPort[KeyMap[i].Port];
+		bit = KeyMap[i].Pin;
+		prs = p->State & bit;
+
+		if(!prs)
+		{
+			KeyHold[i] = 0;
+			continue;
+		}
+		if(KeyHold[i] == 0)
+		{
+			KeyNext[i] = KEY_LONG_MS / KEY_SCAN_MS;
+			KeyRepInt[i] = KEY_REP_MS / KEY_SCAN_MS;
+			KeyRep[i] = 0;
+			Key_Post(i, KEY_EV_PRESS, 0);
+		}
+		if(KeyHold[i] < 0xFFFF)
+			KeyHold[i]++;
+		if(KeyHold[i] != KeyNext[i])
+			continue;
+
+		if(KeyHold[i] == KEY_LONG_MS / KEY_SCAN_MS)
+		{
+			Key_Post(i, KEY_EV_LONG, 0);
+		}
+		else
+		{
+			if(KeyRep[i] < 0xFFFF)
+				KeyRep[i]++;
+			Key_Post(i, KEY_EV_REPEAT, KeyRep[i]);
+			// Accelerate: each interval 1/4 shorter, down to KEY_REP_MIN_MS
+			KeyRepInt[i] -= KeyRepInt[i] / 4;
+			if(KeyRepInt[i] < KEY_REP_MIN_MS / KEY_SCAN_MS)
+				KeyRepInt[i] = KEY_REP_MIN_MS / KEY_SCAN_MS;
+		}
+		if(KeyHold[i] > 0xFFFF - KeyRepInt[i])
+			KeyHold[i] = KEY_LONG_MS / KEY_SCAN_MS;//Keep repeating on very long holds
+		KeyNext[i] = KeyHold[i] + KeyRepInt[i];
+	}
+}
+
+/** ===================================================================
+**     Function Name : uint8_t Key_GetEvent(struct _KEY_EVENT *ev)
+**     Description : Take the oldest key event, never waits
+**     Parameters  : ev - receives the event
+**     Returns     : 1 if an event was taken, 0 if the queue is empty
+** ===================================================================*/
+uint8_t Key_GetEvent(struct _KEY_EVENT *ev)
+{
+	return Ring_Get(&KeyQueue, ev);
+}
@@ -0,0 +1,114 @@
+/**
+  ******************************************************************************
+  * @file    load.c
+  * @brief   CPU load monitor with a WFI idle hook.
+  *
+  *          The main loop calls Load_Idle() when no task is released. It
+  *          sleeps in WFI with interrupts masked, so the waking interrupt runs
+  *          only after the sleep time is taken. Busy time is the DWT cycle
+  *          count of the window less the cycles counted across WFI, and the
+  *          window length comes from the scheduler tick. This holds whether
+  *          or not the DWT counter keeps running in sleep, which depends on
+  *          DBGMCU settings. The control ISR and the TIM2 tick are timed as
+  *          ISR time; the other, short interrupts count as thread time.
+  ******************************************************************************
+  */
+#include "load.h"
+#include "sched.h"
+#include "stdio.h"
+
+struct _LOAD Load;
+
+/** ===================================================================
+**     Function Name : void Load_Init(void)
+**     Description : Start the first measurement window
+**     Parameters  :
+**     Returns     :
+** ===================================================================*/
+void Load_Init(void)
+{
+	DWT_Init();
+	Load.IdleCyc = 0;
+	Load.IsrCyc = 0;
+	Load.WinCyc = DWT_CYCLES();
+	Load.WinTick = Sched_GetTicks();
+	Load.Load = Load.Peak = Load.Isr = Load.Thread = 0;
+}
+
+/** ===================================================================
+**     Function Name : void Load_Idle(void)
+**     Description : Idle hook, sleep until the next interrupt unless a
+**       task was released meanwhile. Called from the main loop.
+**     Parameters  :
+**     Returns     :
+** ===================================================================*/
+void Load_Idle(void)
+{
+	uint32_t t0;
+
+	__disable_irq();
+	if(!Sched_Pending())
+	{
+		t0 = DWT_CYCLES();
+		__DSB();
+		__WFI();//Wakes on a pending interrupt even with PRIMASK set
+		Load.IdleCyc += DWT_CYCLES() - t0;
+	}
+	__enable_irq();
+}
+
+/** ===================================================================
+**     Function Name : void Load_Task(void)
+**     Description : Load task, 1s: close the measurement window and
+**       compute load, peak load and the ISR and thread shares.
+**     Parameters  :
+**     Returns     :
+** ===================================================================*/
+void Load_Task(void)
+{
+	uint32_t now, tick, isr, total, busy;
+
+	__disable_irq();
+	now = DWT_CYCLES();
+	tick = Sched_GetTicks();
+	isr = Load.IsrCyc;
+	Load.IsrCyc = 0;
+	__enable_irq();
+
+	total = (tick - Load.WinTick) * (SystemCoreClock / SCHED_TICK_HZ);
+	busy = now - Load.WinCyc - Load.IdleCyc;
+	if(total == 0)
+		return;
+	if(busy > total)
+		busy = total;
+	if(isr > busy)
+		isr = busy;
+
+	Load.Load = (uint16_t)((uint64_t)busy * 1000 / total);
+	Load.Isr = (uint16_t)((uint64_t)isr * 1000 / total);
+	Load.Thread = Load.Load - Load.Isr;
+	if(Load.Load > Load.Peak)
+		Load.Peak = Load.Load;
+
+	Load.IdleCyc = 0;
+	Load.WinCyc = now;
+	Load.WinTick = tick;
+}
+
+/** ===================================================================
+**     Function Name : uint8_t Load_Format(uint8_t line, char *buf)
+**     Description : Telemetry line with the load figures of the last
+**       window
+**     Parameters  : line - line number, from 0
+**                   buf - receives the line, at least 128 bytes
+**     Returns     : 1 if a line was written, 0 past the last line
+** ===================================================================*/
+uint8_t Load_Format(uint8_t line, char *buf)
+{
+	if(line != 0)
+		return 0;
+	sprintf(buf, "[CPU] load=%u.%u%% peak=%u.%u%% isr=%u.%u%% thread=%u.%u%%\r\n",
+		(unsigned)(Load.Load / 10), (unsigned)(Load.Load % 10), (unsigned)(Load.Peak / 10), (unsigned)(Load.Peak % 10),
+		(unsigned)(Load.Isr / 10), (unsigned)(Load.Isr % 10), (unsigned)(Load.Thread / 10), (unsigned)(Load.Thread % 10));
+	return 1;
+}
@@ -29,7 +29,15 @@
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
 #include "oled.h"
+#include "key.h"
+#include "sched.h"
+#include "load.h"
+#include "memmon.h"
+#include "cmd.h"
 #include "function.h"
+#include "blackbox.h"
+#include "bench.h"
+#include "psfb.h"
 
 #include "stdio.h"
 #include "string.h"
@@ -85,7 +93,8 @@ int main(void)
   HAL_Init();
 
   /* USER CODE BEGIN Init */
-
+	Mem_Init(); // Paint the stack for the high-watermark monitor
+	BlackBox_Init(); // Validate the post-mortem record kept over reset
   /* USER CODE END Init */
 
   /* Configure the system clock */
@@ -104,13 +113,44 @@ int main(void)
   MX_TIM2_Init();
   MX_ADC1_Init();
   /* USER CODE BEGIN 2 */
-	Open_Mode_Init(); // Initialize OLED display
-	
-
-	HAL_TIM_Base_Start_IT(&htim2); // Start timer 3 at 200Hz
-
-	HAL_ADC_Start_DMA(&hadc1, (uint32_t*)ADC1_RESULT, 4); // Start ADC1 sampling, DMA transfer for sampling input/output voltage and current
-	HAL_ADC_Start(&hadc1); // Start ADC2 sampling, sampling the sliding potentiometer voltage
+	BlackBox_Report(); // Print the record of the last fault, if any, on USART2
+#if OLED_FMT_BENCH
+	OLED_FmtBench(); // Print display number rendering cost on USART2
+#endif
+#if BENCH_ENABLE
+	{
+		char line[128];
+		uint8_t i;
+
+		Bench_Run(); // Time the control hot path, print it on USART2 for bench_gate.py
+		for(i=0;Bench_Format(i, line);i++)
+			USART2_SendString(line);
+	}
+#endif
+
+	// Tasks in priority order, highest first
+	Sched_Init();
+	Sched_Add("prot", Protect_Task, 1);
+	Sched_Add("ss", SoftStart_Task, 10);
+	Sched_Add("key", Button_Task, 10);
+	Sched_Add("cmd", Cmd_Task, 10);
+	Sched_Add("disp", Display_Task, 50);
+	Sched_Add("tlm", Telemetry_Task, 100);
+	Sched_Add("load", Load_Task, 1000);
+	Sched_Add("mem", Mem_Task, 1000);
+	Load_Init();
+
+	Key_Init();
+	Cmd_Init(); // Receive line commands on USART2
+	HAL_TIM_Base_Start_IT(&htim2); // Start timer 2 at 2kHz (100MHz / 100 / 500), key scan and scheduler tick
+
+	if(ADC1_StartScan(ADC1_RESULT) != HAL_OK) // Arm the ADC1 scan: HRTIM Timer A CMP3 triggers it every period, circular DMA lands it in ADC1_RESULT without interrupts
+		Error_Handler();
+
+#if PSFB_ENABLE
+	if(Psfb_Init(PSFB_PERIOD, PSFB_DEAD) != HAL_OK) // Phase-shifted full bridge instead of the buck-boost
+		Error_Handler();
+#endif
 
 	// Ұʥ| PWM X]TA1BTA2BTB1BTB2^
 	HAL_HRTIM_WaveformOutputStart(&hhrtim1, HRTIM_OUTPUT_TA1 | HRTIM_OUTPUT_TA2 | HRTIM_OUTPUT_TB1 | HRTIM_OUTPUT_TB2); // Enable all PWM outputs
@@ -121,6 +161,8 @@ int main(void)
 	// ҥέpɾ A _
 	__HAL_HRTIM_TIMER_ENABLE_IT(&hhrtim1, HRTIM_TIMERINDEX_TIMER_A, HRTIM_TIM_IT_REP); // Enable interrupt for timer A
 
+	Open_Mode_Init(); // Initialize OLED display, the panel comes up in the background from Display_Task()
+
   /* USER CODE END 2 */
 
   /* Infinite loop */
@@ -130,7 +172,8 @@ int main(void)
     /* USER CODE END WHILE */
 
     /* USER CODE BEGIN 3 */
-    Button_Task();
+    if (!Sched_Run())
+      Load_Idle(); // Nothing released: sleep until the next interrupt
   }
   /* USER CODE END 3 */
 }
@@ -192,6 +235,7 @@ void Error_Handler(void)
 {
   /* USER CODE BEGIN Error_Handler_Debug */
   /* User can add his own implementation to report the HAL error return state */
+  BlackBox_Error(BB_RETURN_ADDR());
   __disable_irq();
   while (1)
   {
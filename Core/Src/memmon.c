@@ -0,0 +1,101 @@
+/**
+  ******************************************************************************
+  * @file    memmon.c
+  * @brief   MSP stack high-watermark monitor.
+  *
+  *          Mem_Init() paints the free part of the stack with MEM_PAINT right
+  *          after reset, before anything has gone deep. Mem_Task() then counts
+  *          the painted words still left at the bottom of the stack; the first
+  *          overwritten word marks the deepest point any thread or interrupt
+  *          has reached. Stack and heap bounds come from the linker, so the
+  *          figures follow Stack_Size/Heap_Size in the startup file. The
+  *          static budget of the whole image is reported from the map file by
+  *          MDK-ARM/mem_budget.py after each build.
+  ******************************************************************************
+  */
+#include "memmon.h"
+#include "stdio.h"
+
+#if defined(__CC_ARM)
+// Section and region symbols made by armlink, the address is the value
+extern uint32_t STACK$$Base, STACK$$Limit;
+extern uint32_t HEAP$$Base, HEAP$$Limit;
+extern uint32_t Image$$RW_IRAM1$$Base, Image$$RW_IRAM1$$ZI$$Limit;
+#define MEM_STACK_BASE	((uint32_t)&STACK$$Base)
+#define MEM_STACK_LIMIT	((uint32_t)&STACK$$Limit)
+#define MEM_HEAP_SIZE	((uint32_t)&HEAP$$Limit - (uint32_t)&HEAP$$Base)
+#define MEM_RAM_USED	((uint32_t)&Image$$RW_IRAM1$$ZI$$Limit - (uint32_t)&Image$$RW_IRAM1$$Base)
+#else
+// STM32CubeIDE linker script symbols
+extern uint32_t _estack, _Min_Stack_Size, _Min_Heap_Size, _sdata, _ebss;
+#define MEM_STACK_BASE	((uint32_t)&_estack - (uint32_t)&_Min_Stack_Size)
+#define MEM_STACK_LIMIT	((uint32_t)&_estack)
+#define MEM_HEAP_SIZE	((uint32_t)&_Min_Heap_Size)
+#define MEM_RAM_USED	((uint32_t)&_ebss - (uint32_t)&_sdata + MEM_HEAP_SIZE + (uint32_t)&_Min_Stack_Size)
+#endif
+
+struct _MEM Mem;
+
+/** ===================================================================
+**     Function Name : void Mem_Init(void)
+**     Description : Paint the stack below the current SP. Call first
+**       thing in main(), with the stack still shallow.
+**     Parameters  :
+**     Returns     :
+** ===================================================================*/
+void Mem_Init(void)
+{
+	uint32_t *p, *end;
+
+	Mem.StackBase = MEM_STACK_BASE;
+	Mem.StackSize = MEM_STACK_LIMIT - MEM_STACK_BASE;
+	Mem.HeapSize = MEM_HEAP_SIZE;
+	Mem.RamUsed = MEM_RAM_USED;
+
+	// Stop short of the SP, this function's own frame lives just below it
+	end = (uint32_t *)((__get_MSP() - MEM_PAINT_GAP) & ~3u);
+	for(p = (uint32_t *)Mem.StackBase; p < end; p++)
+		*p = MEM_PAINT;
+	Mem.StackPeak = MEM_STACK_LIMIT - (uint32_t)end;
+}
+
+/** ===================================================================
+**     Function Name : void Mem_Task(void)
+**     Description : Memory task, 1s: find the stack high-watermark.
+**       The scan reads only the words up to the first overwritten one,
+**       so it shortens as the stack gets deeper.
+**     Parameters  :
+**     Returns     :
+** ===================================================================*/
+void Mem_Task(void)
+{
+	const uint32_t *p = (const uint32_t *)Mem.StackBase;
+	const uint32_t *top = (const uint32_t *)(Mem.StackBase + Mem.StackSize);
+	uint32_t used;
+
+	while(p < top && *p == MEM_PAINT)
+		p++;
+	used = MEM_STACK_LIMIT - (uint32_t)p;
+	if(used > Mem.StackPeak)
+		Mem.StackPeak = used;
+}
+
+/** ===================================================================
+**     Function Name : uint8_t Mem_Format(uint8_t line, char *buf)
+**     Description : Telemetry line with the stack high-watermark and the
+**       static RAM use
+**     Parameters  : line - line number, from 0
+**                   buf - receives the line, at least 128 bytes
+**     Returns     : 1 if a line was written, 0 past the last line
+** ===================================================================*/
+uint8_t Mem_Format(uint8_t line, char *buf)
+{
+	if(line != 0)
+		return 0;
+	// A peak equal to the size means the bottom word was hit: overflow likely
+	sprintf(buf, "[MEM] msp peak=%u/%u (%u%%)%s heap=%u ram=%u\r\n",
+		(unsigned)Mem.StackPeak, (unsigned)Mem.StackSize, (unsigned)(Mem.StackPeak * 100 / Mem.StackSize),
+		Mem.StackPeak >= Mem.StackSize ? " OVERFLOW" : "",
+		(unsigned)Mem.HeapSize, (unsigned)Mem.RamUsed);
+	return 1;
+}
@@ -27,93 +27,377 @@
 #include "i2c.h"
 #include "oledfont.h"
 #include "stm32g4xx_it.h"
+#include "string.h"
+#if OLED_FMT_BENCH
+#include "dwt.h"
+#include "usart.h"
+#include "stdio.h"
+#endif
 
-void WriteCmd(unsigned char I2C_Command)//д
+// Frame buffer in SSD1306 horizontal addressing order: 8 pages of 128 columns.
+// All drawing functions render here, OLED_Refresh() sends only the changed parts.
+uint8_t OLED_GRAM[OLED_PAGES][OLED_WIDTH];
+static uint8_t OLEDCurX = 0, OLEDCurY = 0;//Frame buffer write cursor
+
+// Changed column range per page since the last flush, clean when X0 > X1
+static uint8_t OLEDDirtyX0[OLED_PAGES] = {0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF};
+static uint8_t OLEDDirtyX1[OLED_PAGES] = {0};
+
+// Flush in progress: list of page regions, walked by the DMA completion callback
+#define OLED_TX_IDLE	0
+#define OLED_TX_CMD		1//Column/page window command being sent
+#define OLED_TX_DATA	2//Region data being sent
+#define OLED_TX_SETUP	3//Init or on/off command stream being sent
+struct _OLED_REGION
+{
+	uint8_t Page;
+	uint8_t X0;
+	uint8_t X1;
+};
+static struct _OLED_REGION OLEDTxList[OLED_PAGES];
+static uint8_t OLEDTxCnt = 0, OLEDTxIdx = 0;
+static uint8_t OLEDTxWin[6];
+static volatile uint8_t OLEDTxState = OLED_TX_IDLE;
+static volatile uint8_t OLEDTxLost = 0;//A transfer failed, resend the whole frame
+
+// Panel bring-up, stepped by OLED_Refresh() and the DMA completion callback
+#define OLED_ST_OFF		0//OLED_Init() not called yet
+#define OLED_ST_POWERUP	1//Waiting OLED_POWERUP_MS for the panel supply
+#define OLED_ST_INIT	2//Init sequence to be sent or in flight
+#define OLED_ST_SETTLE	3//Waiting OLED_SETTLE_MS after display on
+#define OLED_ST_READY	4//Frame buffer flushes allowed
+#define OLED_POWERUP_MS	200
+#define OLED_SETTLE_MS	100
+static volatile uint8_t OLEDState = OLED_ST_OFF;
+static volatile uint32_t OLEDStateTick = 0;
+
+// Display on/off requested by OLED_ON()/OLED_OFF(), sent before the next flush
+#define OLED_PWR_NONE	0
+#define OLED_PWR_ON		1
+#define OLED_PWR_OFF	2
+static uint8_t OLEDPwrReq = OLED_PWR_NONE;
+
+void WriteDat(unsigned char I2C_Data)//Write one column byte into the frame buffer at the cursor
 {
-	HAL_I2C_Mem_Write(&hi2c3,OLED0561_ADD,COM,I2C_MEMADD_SIZE_8BIT,&I2C_Command,1,100);	
+	if(OLEDCurX >= OLED_WIDTH)//Wraps like the panel in horizontal addressing mode
+	{
+		OLEDCurX = 0;
+		OLEDCurY++;
+	}
+	if(OLEDCurY < OLED_PAGES && OLED_GRAM[OLEDCurY][OLEDCurX] != I2C_Data)
+	{
+		OLED_GRAM[OLEDCurY][OLEDCurX] = I2C_Data;
+		OLED_MarkDirty(OLEDCurY, OLEDCurX, OLEDCurX);
+	}
+	OLEDCurX++;
 }
 
-void WriteDat(unsigned char I2C_Data)//д 
+/** ===================================================================
+**     Function Name : void OLED_MarkDirty(u8 page,u8 x0,u8 x1)
+**     Description : Add columns x0..x1 of a page to the region sent by the
+**       next OLED_Refresh(). Called by everything that writes OLED_GRAM.
+**     Parameters  : page - 0~7; x0,x1 - first and last column, 0~127
+**     Returns     :
+** ===================================================================*/
+void OLED_MarkDirty(u8 page,u8 x0,u8 x1)
 {
-	HAL_I2C_Mem_Write(&hi2c3,OLED0561_ADD,DAT,I2C_MEMADD_SIZE_8BIT,&I2C_Data,1,100);	
+	if(x0 < OLEDDirtyX0[page])
+		OLEDDirtyX0[page] = x0;
+	if(x1 > OLEDDirtyX1[page])
+		OLEDDirtyX1[page] = x1;
 }
 
+// Init sequence, sent as one command stream by a single DMA transfer
+static const uint8_t OLEDInitCmd[] =
+{
+	0xAE, //display off
+	0x20, 0x00, //Set Memory Addressing Mode: 00,Horizontal Addressing Mode;01,Vertical Addressing Mode;10,Page Addressing Mode (RESET);11,Invalid
+	0xb0, //Set Page Start Address for Page Addressing Mode,0-7
+	0xc8, //Set COM Output Scan Direction
+	0x00, //---set low column address
+	0x10, //---set high column address
+	0x40, //--set start line address
+	0x81, 0xff, //--set contrast control register 0x00~0xff
+	0xa1, //--set segment re-map 0 to 127
+	0xa6, //--set normal display
+	0xa8, 0x3F, //--set multiplex ratio(1 to 64)
+	0xa4, //0xa4,Output follows RAM content;0xa5,Output ignores RAM content
+	0xd3, 0x00, //-set display offset, not offset
+	0xd5, 0xf0, //--set display clock divide ratio/oscillator frequency
+	0xd9, 0x22, //--set pre-charge period
+	0xda, 0x12, //--set com pins hardware configuration
+	0xdb, 0x20, //--set vcomh 0x20,0.77xVcc
+	0x8d, 0x14, //--set DC-DC enable
+	0xaf, //--turn on oled panel
+};
+static const uint8_t OLEDOnCmd[]  = {0x8D, 0x14, 0xAF};//Charge pump on, display on
+static const uint8_t OLEDOffCmd[] = {0x8D, 0x10, 0xAE};//Charge pump off, display off
+
+/** ===================================================================
+**     Function Name : void OLED_Init(void)
+**     Description : Start the panel bring-up and return at once. The
+**       power-up wait, the init sequence and the settle time after
+**       display on are stepped by OLED_Refresh() and the DMA completion
+**       callback. Drawing into the frame buffer is allowed right away,
+**       it is sent once the panel is ready.
+**     Parameters  :
+**     Returns     :
+** ===================================================================*/
 void OLED_Init(void)
 {
-	HAL_Delay(200); //ʱҪ
-
-	WriteCmd(0xAE); //display off
-	WriteCmd(0x20);	//Set Memory Addressing Mode	
-	WriteCmd(0x10);	//00,Horizontal Addressing Mode;01,Vertical Addressing Mode;10,Page Addressing Mode (RESET);11,Invalid
-	WriteCmd(0xb0);	//Set Page Start Address for Page Addressing Mode,0-7
-	WriteCmd(0xc8);	//Set COM Output Scan Direction
-	WriteCmd(0x00); //---set low column address
-	WriteCmd(0x10); //---set high column address
-	WriteCmd(0x40); //--set start line address
-	WriteCmd(0x81); //--set contrast control register
-	WriteCmd(0xff); //ȵ 0x00~0xff
-	WriteCmd(0xa1); //--set segment re-map 0 to 127
-	WriteCmd(0xa6); //--set normal display
-	WriteCmd(0xa8); //--set multiplex ratio(1 to 64)
-	WriteCmd(0x3F); //
-	WriteCmd(0xa4); //0xa4,Output follows RAM content;0xa5,Output ignores RAM content
-	WriteCmd(0xd3); //-set display offset
-	WriteCmd(0x00); //-not offset
-	WriteCmd(0xd5); //--set display clock divide ratio/oscillator frequency
-	WriteCmd(0xf0); //--set divide ratio
-	WriteCmd(0xd9); //--set pre-charge period
-	WriteCmd(0x22); //
-	WriteCmd(0xda); //--set com pins hardware configuration
-	WriteCmd(0x12);
-	WriteCmd(0xdb); //--set vcomh
-	WriteCmd(0x20); //0x20,0.77xVcc
-	WriteCmd(0x8d); //--set DC-DC enable
-	WriteCmd(0x14); //
-	WriteCmd(0xaf); //--turn on oled panel
-	
-	HAL_Delay(100);
+	unsigned char m;
+
+	if(OLEDState == OLED_ST_OFF)
+		OLEDState = OLED_ST_POWERUP;//First call after reset: wait for the panel supply
+	else if(OLEDState == OLED_ST_READY)
+		OLEDState = OLED_ST_INIT;//Re-init, the panel is already powered
+	OLEDStateTick = HAL_GetTick();
+	OLEDPwrReq = OLED_PWR_NONE;
+
+	for(m=0;m<OLED_PAGES;m++)//Panel RAM content is unknown until rewritten
+		OLED_MarkDirty(m, 0, OLED_WIDTH-1);
 }
 
 void OLED_SetPos(unsigned char x, unsigned char y) //ʼ
 { 
-	WriteCmd(0xb0+y);
-	WriteCmd(((x&0xf0)>>4)|0x10);
-	WriteCmd((x&0x0f)|0x01);
+	OLEDCurX = x;
+	OLEDCurY = y;
 }
 
 void OLED_Fill(unsigned char fill_Data)//ȫ
 {
-	unsigned char m,n;
-	for(m=0;m<8;m++)
+	unsigned char m;
+	memset(OLED_GRAM, fill_Data, sizeof(OLED_GRAM));
+	for(m=0;m<OLED_PAGES;m++)//Panel contents are unknown, always send the whole frame
+		OLED_MarkDirty(m, 0, OLED_WIDTH-1);
+}
+
+void OLED_CLS(void)//
+{
+	OLED_Fill(0x00);
+}
+
+void OLED_ON(void)//Sent by the next OLED_Refresh()
+{
+	OLEDPwrReq = OLED_PWR_ON;
+}
+
+void OLED_OFF(void)//Sent by the next OLED_Refresh()
+{
+	OLEDPwrReq = OLED_PWR_OFF;
+}
+
+// Send a command stream from flash, completion moves the bring-up state on
+static uint8_t OLED_TxSetup(const uint8_t *cmd, uint16_t len)
+{
+	OLEDTxState = OLED_TX_SETUP;
+	if(HAL_I2C_Mem_Write_DMA(&hi2c3,OLED0561_ADD,COM,I2C_MEMADD_SIZE_8BIT,(uint8_t *)cmd,len) != HAL_OK)
+	{
+		OLEDTxState = OLED_TX_IDLE;
+		return 0;
+	}
+	return 1;
+}
+
+// Start the window command of region OLEDTxIdx
+static void OLED_TxWindow(void)
+{
+	struct _OLED_REGION *r = &OLEDTxList[OLEDTxIdx];
+
+	OLEDTxWin[0] = 0x21;//Column address window
+	OLEDTxWin[1] = r->X0;
+	OLEDTxWin[2] = r->X1;
+	OLEDTxWin[3] = 0x22;//Page address window
+	OLEDTxWin[4] = r->Page;
+	OLEDTxWin[5] = r->Page;
+	OLEDTxState = OLED_TX_CMD;
+	if(HAL_I2C_Mem_Write_DMA(&hi2c3,OLED0561_ADD,COM,I2C_MEMADD_SIZE_8BIT,OLEDTxWin,sizeof(OLEDTxWin)) != HAL_OK)
+	{
+		OLEDTxLost = 1;
+		OLEDTxState = OLED_TX_IDLE;
+	}
+}
+
+/** ===================================================================
+**     Function Name : void OLED_Refresh(void)
+**     Description : Send the changed parts of the frame buffer. Every page
+**       with a dirty column range becomes one region: a window command
+**       and the region data, each a DMA transfer on hdma_i2c3_tx chained
+**       from the completion callback. Pages are claimed here, in thread
+**       context, so drawing during the flush only marks the next one.
+**       Also steps the bring-up started by OLED_Init() and sends pending
+**       OLED_ON()/OLED_OFF() requests. Never waits: returns at once if a
+**       transfer is still running or the panel is not ready yet.
+**       Called from the main loop.
+**     Parameters  :
+**     Returns     :
+** ===================================================================*/
+void OLED_Refresh(void)
+{
+	unsigned char m;
+
+	if(OLEDTxState != OLED_TX_IDLE)
+		return;
+
+	switch(OLEDState)
+	{
+	case OLED_ST_POWERUP:
+		if(HAL_GetTick() - OLEDStateTick < OLED_POWERUP_MS)
+			return;
+		OLEDState = OLED_ST_INIT;
+		/* fall through */
+	case OLED_ST_INIT:
+		OLED_TxSetup(OLEDInitCmd, sizeof(OLEDInitCmd));//Retried on the next call if the bus is busy
+		return;
+	case OLED_ST_SETTLE:
+		if(HAL_GetTick() - OLEDStateTick < OLED_SETTLE_MS)
+			return;
+		OLEDState = OLED_ST_READY;
+		break;
+	case OLED_ST_READY:
+		break;
+	default://OLED_ST_OFF
+		return;
+	}
+
+	if(OLEDPwrReq != OLED_PWR_NONE)
+	{
+		if(OLED_TxSetup(OLEDPwrReq == OLED_PWR_ON ? OLEDOnCmd : OLEDOffCmd, sizeof(OLEDOnCmd)))
+			OLEDPwrReq = OLED_PWR_NONE;
+		return;
+	}
+
+	if(OLEDTxLost)
+	{
+		OLEDTxLost = 0;
+		for(m=0;m<OLED_PAGES;m++)
+			OLED_MarkDirty(m, 0, OLED_WIDTH-1);
+	}
+
+	OLEDTxCnt = 0;
+	for(m=0;m<OLED_PAGES;m++)
+	{
+		if(OLEDDirtyX0[m] > OLEDDirtyX1[m])
+			continue;
+		OLEDTxList[OLEDTxCnt].Page = m;
+		OLEDTxList[OLEDTxCnt].X0 = OLEDDirtyX0[m];
+		OLEDTxList[OLEDTxCnt].X1 = OLEDDirtyX1[m];
+		OLEDTxCnt++;
+		OLEDDirtyX0[m] = 0xFF;
+		OLEDDirtyX1[m] = 0;
+	}
+
+	if(OLEDTxCnt == 0)
+		return;
+
+	OLEDTxIdx = 0;
+	OLED_TxWindow();
+}
+
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+	struct _OLED_REGION *r;
+
+	if(hi2c != &hi2c3)
+		return;
+
+	if(OLEDTxState == OLED_TX_CMD)
 	{
-		WriteCmd(0xb0+m);		//page0-page1
-		WriteCmd(0x00);		//low column start address
-		WriteCmd(0x10);		//high column start address
-		for(n=0;n<128;n++)
+		r = &OLEDTxList[OLEDTxIdx];
+		OLEDTxState = OLED_TX_DATA;
+		if(HAL_I2C_Mem_Write_DMA(&hi2c3,OLED0561_ADD,DAT,I2C_MEMADD_SIZE_8BIT,&OLED_GRAM[r->Page][r->X0],r->X1 - r->X0 + 1) != HAL_OK)
 		{
-			WriteDat(fill_Data);
+			OLEDTxLost = 1;
+			OLEDTxState = OLED_TX_IDLE;
 		}
 	}
+	else if(OLEDTxState == OLED_TX_DATA)
+	{
+		if(++OLEDTxIdx < OLEDTxCnt)
+			OLED_TxWindow();
+		else
+			OLEDTxState = OLED_TX_IDLE;
+	}
+	else if(OLEDTxState == OLED_TX_SETUP)
+	{
+		if(OLEDState == OLED_ST_INIT)
+		{
+			OLEDState = OLED_ST_SETTLE;
+			OLEDStateTick = HAL_GetTick();
+		}
+		OLEDTxState = OLED_TX_IDLE;
+	}
 }
 
-void OLED_CLS(void)//
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
 {
-	OLED_Fill(0x00);
-	HAL_Delay(100);
+	if(hi2c != &hi2c3)
+		return;
+
+	if(OLEDState == OLED_ST_INIT)
+	{
+		// Panel did not take the init sequence, try again after a power-up wait
+		OLEDState = OLED_ST_POWERUP;
+		OLEDStateTick = HAL_GetTick();
+	}
+	OLEDTxLost = 1;
+	OLEDTxState = OLED_TX_IDLE;
 }
 
-void OLED_ON(void)
+// Copy w glyph columns into one page of the frame buffer, marking only the changed span
+static void OLED_Blit(u8 x,u8 page,const u8 *src,u8 w)
 {
-	WriteCmd(0X8D);  //õɱ
-	WriteCmd(0X14);  //ɱ
-	WriteCmd(0XAF);  //OLED
+	u8 *dst;
+	u8 i, x0 = 0xFF, x1 = 0;
+
+	if(page >= OLED_PAGES || x >= OLED_WIDTH)
+		return;
+	if(w > OLED_WIDTH - x)
+		w = OLED_WIDTH - x;
+
+	dst = &OLED_GRAM[page][x];
+	for(i=0;i<w;i++)
+	{
+		if(dst[i] != src[i])
+		{
+			dst[i] = src[i];
+			if(x0 == 0xFF)
+				x0 = i;
+			x1 = i;
+		}
+	}
+	if(x0 != 0xFF)
+		OLED_MarkDirty(page, x + x0, x + x1);
 }
 
-void OLED_OFF(void)
+/** ===================================================================
+**     Function Name : void OLED_PutChar(u8 x,u8 y,u8 chr,u8 size)
+**     Description : Blit one ASCII glyph into the frame buffer. The fonts
+**       are stored column-major, one byte per 8-row page, so a glyph is
+**       one (6*8) or two (8*16) straight column copies. Characters
+**       outside the font show as a blank.
+**     Parameters  : x,y - start column 0~127 and page 0~7
+**                   chr - ASCII character
+**                   size - 1:6*8, 2:8*16
+**     Returns     :
+** ===================================================================*/
+void OLED_PutChar(u8 x,u8 y,u8 chr,u8 size)
 {
-	WriteCmd(0X8D);  //õɱ
-	WriteCmd(0X10);  //رյɱ
-	WriteCmd(0XAE);  //OLED
+	unsigned int c = (unsigned int)(chr - ' ');
+
+	if(size == 1)
+	{
+		if(c >= sizeof(F6x8) / sizeof(F6x8[0]))
+			c = 0;
+		OLED_Blit(x, y, F6x8[c], 6);
+	}
+	else
+	{
+		if(c >= sizeof(F8X16) / 16)
+			c = 0;
+		OLED_Blit(x, y, &F8X16[c*16], 8);
+		OLED_Blit(x, y + 1, &F8X16[c*16+8], 8);
+	}
 }
 
 
@@ -121,46 +405,21 @@ void OLED_OFF(void)
 // Description    : ʾcodetab.hеASCIIַ,6*88*16ѡ
 void OLED_ShowStr(unsigned char x, unsigned char y, unsigned char ch[], unsigned char TextSize)
 {
-	unsigned char c = 0,i = 0,j = 0;
-	switch(TextSize)
+	unsigned char j = 0;
+	unsigned char w = (TextSize == 1) ? 6 : 8;
+
+	if(TextSize != 1 && TextSize != 2)
+		return;
+	while(ch[j] != '\0')
 	{
-		case 1:
+		if(x > OLED_WIDTH - w)
 		{
-			while(ch[j] != '\0')
-			{
-				c = ch[j] - 32;
-				if(x > 126)
-				{
-					x = 0;
-					y++;
-				}
-				OLED_SetPos(x,y);
-				for(i=0;i<6;i++)
-				WriteDat(F6x8[c][i]);
-				x += 6;
-				j++;
-			}
-		}break;
-		case 2:
-		{
-			while(ch[j] != '\0')
-			{
-				c = ch[j] - 32;
-				if(x > 120)
-				{
-					x = 0;
-					y++;
-				}
-				OLED_SetPos(x,y);
-				for(i=0;i<8;i++)
-				WriteDat(F8X16[c*16+i]);
-				OLED_SetPos(x,y+1);
-				for(i=0;i<8;i++)
-				WriteDat(F8X16[c*16+i+8]);
-				x += 8;
-				j++;
-			}
-		}break;
+			x = 0;
+			y++;
+		}
+		OLED_PutChar(x,y,ch[j],TextSize);
+		x += w;
+		j++;
 	}
 }
 
@@ -209,90 +468,131 @@ void OLED_DrawBMP(unsigned char x0,unsigned char y0,unsigned char x1,unsigned ch
 }
 
 void OLED_ShowChar(u8 x,u8 y,u8 chr,u8 Char_Size)
-{      	
-	unsigned char c=0,i=0;	
-	c=chr-' ';//õƫƺֵ			
+{
 	if(x>128-1){x=0;y=y+2;}
-	if(Char_Size ==16)
-	{
-		OLED_SetPos(x,y);	
-		for(i=0;i<8;i++)
-		WriteDat(F8X16[c*16+i]);
-		OLED_SetPos(x,y+1);
-		for(i=0;i<8;i++)
-		WriteDat(F8X16[c*16+i+8]);
-	}
-	else 
-	{	
-		OLED_SetPos(x,y);
-		for(i=0;i<6;i++)
-		WriteDat(F6x8[c][i]);
-	}
+	OLED_PutChar(x,y,chr,Char_Size == 16 ? 2 : 1);
 }
 
-u32 oled_pow(u8 m,u8 n)
-{
-	u32 result=1;	 
-	while(n--)result*=m;    
-	return result;
-}	
-
-
 //ʾ2
 //x,y :	 
 //len :ֵλ
 //size:С
-//mode:ģʽ	0,ģʽ;1,ģʽ
 //num:ֵ(0~4294967295);	 		  
 void OLED_ShowNum(u8 x,u8 y,u32 num,u8 len,u8 size2)
-{         	
-	u8 t,temp;
-	u8 enshow=0;						   
-	for(t=0;t<len;t++)
+{
+	u8 size = (size2 == 16) ? 2 : 1;
+	u8 t = len;
+
+	// Lowest digit first, leading zeros blank except the last digit
+	while(t--)
 	{
-		temp=(num/oled_pow(10,len-t-1))%10;
-		if(enshow==0&&t<(len-1))
-		{
-			if(temp==0)
-			{
-				OLED_ShowChar(x+(size2/2)*t,y,' ',size2);
-				continue;
-			}
-			else 
-				enshow=1; 
-		}
-		OLED_ShowChar(x+(size2/2)*t,y,temp+'0',size2); 
+		OLED_PutChar(x+(size2/2)*t,y,(num || t == len-1) ? num%10+'0' : ' ',size);
+		num /= 10;
 	}
-} 
+}
 
 //ַʽʾ
 //x,y :	
 //temp:
 void OLEDShowData(u8 x,u8 y,u8 temp)
 {
-	switch(temp)
+	if(temp < 10)
+		OLED_PutChar(x,y,temp+'0',2);
+}
+
+/** ===================================================================
+**     Function Name : void OLED_ShowFix(u8 x,u8 y,int32_t val,u8 frac,u8 width,u8 size)
+**     Description : Show a fixed-point number right aligned in a field of
+**       width characters, e.g. val=10012, frac=2 shows "100.12". Digits
+**       are produced by integer division and blitted into the frame
+**       buffer, no float math and no printf. Unused leading positions
+**       are blanked so a shorter value clears the previous one; a value
+**       that does not fit shows a field of '*'.
+**     Parameters  : x,y - start column 0~127 and page 0~7
+**                   val - value scaled by 10^frac
+**                   frac - digits after the decimal point, 0 for none
+**                   width - field width in characters, 1~OLED_FIX_MAXCH
+**                   size - 1:6*8, 2:8*16
+**     Returns     :
+** ===================================================================*/
+void OLED_ShowFix(u8 x,u8 y,int32_t val,u8 frac,u8 width,u8 size)
+{
+	char buf[OLED_FIX_MAXCH];
+	char *p;
+	uint32_t u = (val < 0) ? 0u - (uint32_t)val : (uint32_t)val;
+	u8 d = 0, w = (size == 1) ? 6 : 8;
+	u8 i;
+
+	if(width > OLED_FIX_MAXCH)
+		width = OLED_FIX_MAXCH;
+	p = buf + width;
+
+	// Digits right to left, at least one before the decimal point
+	while(p > buf)
 	{
-		case  0: OLED_ShowStr(x,y,"0",2);
-		break;
-		case  1: OLED_ShowStr(x,y,"1",2);
-		break;
-		case  2: OLED_ShowStr(x,y,"2",2);
-		break;
-		case  3: OLED_ShowStr(x,y,"3",2);
-		break;
-		case  4: OLED_ShowStr(x,y,"4",2);
-		break;
-		case  5: OLED_ShowStr(x,y,"5",2);
-		break;
-		case  6: OLED_ShowStr(x,y,"6",2);
-		break;
-		case  7: OLED_ShowStr(x,y,"7",2);
-		break;
-		case  8: OLED_ShowStr(x,y,"8",2);
-		break;
-		case  9: OLED_ShowStr(x,y,"9",2);
-		break;		
+		if(frac && d == frac)
+		{
+			*--p = '.';
+			if(p == buf)
+				break;
+		}
+		*--p = u % 10 + '0';
+		u /= 10;
+		d++;
+		if(u == 0 && d > frac)
+			break;
 	}
+	if(val < 0 && p > buf)
+		*--p = '-';
+	else if(val < 0)
+		u = 1;
+	if(u || d <= frac)
+		memset(buf, '*', width);//Overflow
+	else
+		while(p > buf)
+			*--p = ' ';
+
+	for(i=0;i<width;i++)
+		OLED_PutChar(x+i*w,y,buf[i],size);
 }
 
 
+#if OLED_FMT_BENCH
+/** ===================================================================
+**     Function Name : void OLED_FmtBench(void)
+**     Description : Render the frequency field with the old sprintf path
+**       and with OLED_ShowFix() and print the DWT cycles per value on
+**       USART2. Called once at boot, before the panel is brought up.
+**     Parameters  :
+**     Returns     :
+** ===================================================================*/
+void OLED_FmtBench(void)
+{
+	char line[80];
+	unsigned char str[10];
+	uint32_t t0, tPrintf, tFix;
+	uint32_t f;
+	uint16_t n = 0;
+
+	DWT_Init();
+
+	t0 = DWT_CYCLES();
+	for(f=70000;f<130000;f+=600)
+	{
+		sprintf((char *)str, "%.2f", (float)f / 1000.0f);
+		OLED_ShowStr(45, 2, str, 2);
+		n++;
+	}
+	tPrintf = DWT_CYCLES() - t0;
+
+	t0 = DWT_CYCLES();
+	for(f=70000;f<130000;f+=600)
+		OLED_ShowFix(45, 2, (int32_t)(f / 10), 2, 6, 2);
+	tFix = DWT_CYCLES() - t0;
+
+	sprintf(line, "[FMT] sprintf+ShowStr %u cyc/value, ShowFix %u cyc/value\r\n",
+		(unsigned)(tPrintf / n), (unsigned)(tFix / n));
+	USART2_SendString(line);
+	OLED_Fill(0x00);
+}
+#endif
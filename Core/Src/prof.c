@@ -0,0 +1,77 @@
+/**
+  ******************************************************************************
+  * @file    prof.c
+  * @brief   DWT cycle profiler for the hot paths.
+  *
+  *          PROF_START()/PROF_STOP() pairs read DWT->CYCCNT around a code
+  *          section and Prof_Add() keeps min, max, mean and a log2 histogram
+  *          per probe. Each probe must only be used from one context, ISR
+  *          or thread. Times include any interrupt that preempts the section.
+  ******************************************************************************
+  */
+#include "prof.h"
+#include "function.h"
+#include "stdio.h"
+
+struct _PROF Prof[PROF_NUM];
+
+static const char *const ProfName[PROF_NUM] = {"adc", "isr", "setfreq", "disp", "flush", "vloop"};
+
+/** ===================================================================
+**     Function Name : void Prof_Add(uint8_t id, uint32_t cycles)
+**     Description : Add one measurement to a probe
+**     Parameters  : id - PROF_xxx
+**                   cycles - DWT cycles of the section
+**     Returns     :
+** ===================================================================*/
+CCMRAM void Prof_Add(uint8_t id, uint32_t cycles)
+{
+	struct _PROF *p = &Prof[id];
+	uint32_t bin = cycles ? 31 - __CLZ(cycles) : 0;
+
+	if(p->Cnt == 0 || cycles < p->Min)
+		p->Min = cycles;
+	if(cycles > p->Max)
+		p->Max = cycles;
+	p->Sum += cycles;
+	p->Cnt++;
+	p->Hist[bin < PROF_BINS ? bin : PROF_BINS - 1]++;
+}
+
+/** ===================================================================
+**     Function Name : uint8_t Prof_Format(uint8_t line, char *buf)
+**     Description : Telemetry lines, two per probe: count, min, max and
+**       mean in cycles, then the non-empty histogram bins as
+**       log2(cycles):count
+**     Parameters  : line - line number, from 0
+**                   buf - receives the line, at least 128 bytes
+**     Returns     : 1 if a line was written, 0 past the last line
+** ===================================================================*/
+uint8_t Prof_Format(uint8_t line, char *buf)
+{
+	struct _PROF *p;
+	uint8_t id = line >> 1;
+	uint8_t i;
+	int n;
+
+	if(id >= PROF_NUM)
+		return 0;
+	p = &Prof[id];
+
+	if((line & 1) == 0)
+	{
+		sprintf(buf, "[PRF] %s n=%u min=%u max=%u mean=%u cyc\r\n", ProfName[id],
+			(unsigned)p->Cnt, (unsigned)p->Min, (unsigned)p->Max,
+			(unsigned)(p->Cnt ? p->Sum / p->Cnt : 0));
+		return 1;
+	}
+
+	n = sprintf(buf, "[PRF] %s", ProfName[id]);
+	for(i=0;i<PROF_BINS && n < 128 - 16;i++)
+	{
+		if(p->Hist[i])
+			n += sprintf(buf + n, " %u:%u", i, (unsigned)p->Hist[i]);
+	}
+	sprintf(buf + n, "\r\n");
+	return 1;
+}
@@ -0,0 +1,177 @@
+/**
+  ******************************************************************************
+  * @file    psfb.c
+  * @brief   Phase-shift modulation of the full bridge.
+  *
+  *          Timer A drives leg A and Timer B leg B, each at 50% with its
+  *          second output the complement of the first through the
+  *          dead-time generator. Timer A restarts on the master period,
+  *          Timer B on Master CMP1: the phase of leg B behind leg A is
+  *          Master CMP1, in master counts, so it moves in steps of one
+  *          HRTIM count (1/fHRTIM/16 at MUL16, well under 1ns). The
+  *          bridge voltage is on for about phase out of each half period.
+  *
+  *          Master CMP1 is preloaded and taken at each master period start,
+  *          so a phase written at any point of the period applies whole
+  *          from the next one. Timer B never rolls over by itself, its
+  *          period is longer than any gap between two phase resets, so a
+  *          phase step only stretches or shortens one half period of leg B
+  *          and the dead-time generator keeps the gaps on both legs.
+  *
+  *          With the bridge set up the voltage loop writes its duty here
+  *          instead of to the buck and boost compare registers.
+  ******************************************************************************
+  */
+#include "psfb.h"
+#include "function.h"
+#include "hrtim.h"
+
+struct _PSFB Psfb;
+
+/** ===================================================================
+**     Function Name : HAL_StatusTypeDef Psfb_Init(uint32_t period, uint32_t dead)
+**     Description : Set up the master, Timer A and Timer B as the phase-
+**       shifted bridge at MUL16 and start them at the smallest phase.
+**       Timer A keeps its repetition interrupt, the control ISR.
+**     Parameters  : period - master counts, CNTR_MIN~CNTR_MAX
+**                   dead - dead time per leg, master counts, 0~PSFB_DEAD_MAX
+**     Returns     : HAL_OK, HAL_ERROR on a setting out of range, with
+**       the timers left as they were, or on a HAL error
+** ===================================================================*/
+HAL_StatusTypeDef Psfb_Init(uint32_t period, uint32_t dead)
+{
+	HRTIM_TimeBaseCfgTypeDef base = {0};
+	HRTIM_TimerCfgTypeDef tim = {0};
+	HRTIM_CompareCfgTypeDef cmp = {0};
+	HRTIM_OutputCfgTypeDef out = {0};
+	HRTIM_DeadTimeCfgTypeDef dt = {0};
+
+	if(period < CNTR_MIN || period > CNTR_MAX || dead > PSFB_DEAD_MAX || dead >= period / 2)
+		return HAL_ERROR;
+
+	// Master: the period, and the phase in CMP1 taken on each repetition event
+	base.Period = period;
+	base.RepetitionCounter = 0;
+	base.PrescalerRatio = HRTIM_PRESCALERRATIO_MUL16;
+	base.Mode = HRTIM_MODE_CONTINUOUS;
+	tim.InterruptRequests = HRTIM_MASTER_IT_NONE;
+	tim.DMARequests = HRTIM_MASTER_DMA_NONE;
+	tim.DMASize = 0x1;
+	tim.HalfModeEnable = HRTIM_HALFMODE_DISABLED;
+	tim.InterleavedMode = HRTIM_INTERLEAVED_MODE_DISABLED;
+	tim.StartOnSync = HRTIM_SYNCSTART_DISABLED;
+	tim.ResetOnSync = HRTIM_SYNCRESET_DISABLED;
+	tim.DACSynchro = HRTIM_DACSYNC_NONE;
+	tim.PreloadEnable = HRTIM_PRELOAD_ENABLED;
+	tim.UpdateGating = HRTIM_UPDATEGATING_INDEPENDENT;
+	tim.BurstMode = HRTIM_TIMERBURSTMODE_MAINTAINCLOCK;
+	tim.RepetitionUpdate = HRTIM_UPDATEONREPETITION_ENABLED;
+	tim.ReSyncUpdate = HRTIM_TIMERESYNC_UPDATE_UNCONDITIONAL;
+	cmp.CompareValue = PSFB_PHASE_MIN;
+	if(HAL_HRTIM_TimeBaseConfig(&hhrtim1, HRTIM_TIMERINDEX_MASTER, &base) != HAL_OK ||
+		HAL_HRTIM_WaveformTimerConfig(&hhrtim1, HRTIM_TIMERINDEX_MASTER, &tim) != HAL_OK ||
+		HAL_HRTIM_WaveformCompareConfig(&hhrtim1, HRTIM_TIMERINDEX_MASTER, HRTIM_COMPAREUNIT_1, &cmp) != HAL_OK)
+		return HAL_ERROR;
+
+	// Legs: output 1 on for the first half of its timer, output 2 its complement
+	tim.InterruptRequests = HRTIM_TIM_IT_REP;
+	tim.DMARequests = HRTIM_TIM_DMA_NONE;
+	tim.PreloadEnable = HRTIM_PRELOAD_DISABLED;
+	tim.RepetitionUpdate = HRTIM_UPDATEONREPETITION_DISABLED;
+	tim.PushPull = HRTIM_TIMPUSHPULLMODE_DISABLED;
+	tim.FaultEnable = HRTIM_TIMFAULTENABLE_NONE;
+	tim.FaultLock = HRTIM_TIMFAULTLOCK_READWRITE;
+	tim.DeadTimeInsertion = HRTIM_TIMDEADTIMEINSERTION_ENABLED;
+	tim.DelayedProtectionMode = HRTIM_TIMER_A_B_C_DELAYEDPROTECTION_DISABLED;
+	tim.UpdateTrigger = HRTIM_TIMUPDATETRIGGER_NONE;
+	tim.ResetTrigger = HRTIM_TIMRESETTRIGGER_MASTER_PER;
+	tim.ResetUpdate = HRTIM_TIMUPDATEONRESET_DISABLED;
+	cmp.CompareValue = period / 2;
+	dt.Prescaler = HRTIM_TIMDEADTIME_PRESCALERRATIO_MUL8;//2 master counts per step
+	dt.RisingValue = dead >> 1;
+	dt.RisingSign = HRTIM_TIMDEADTIME_RISINGSIGN_POSITIVE;
+	dt.RisingLock = HRTIM_TIMDEADTIME_RISINGLOCK_WRITE;
+	dt.RisingSignLock = HRTIM_TIMDEADTIME_RISINGSIGNLOCK_WRITE;
+	dt.FallingValue = dead >> 1;
+	dt.FallingSign = HRTIM_TIMDEADTIME_FALLINGSIGN_POSITIVE;
+	dt.FallingLock = HRTIM_TIMDEADTIME_FALLINGLOCK_WRITE;
+	dt.FallingSignLock = HRTIM_TIMDEADTIME_FALLINGSIGNLOCK_WRITE;
+	out.Polarity = HRTIM_OUTPUTPOLARITY_HIGH;
+	out.SetSource = HRTIM_OUTPUTSET_TIMPER;
+	out.ResetSource = HRTIM_OUTPUTRESET_TIMCMP1;
+	out.IdleMode = HRTIM_OUTPUTIDLEMODE_NONE;
+	out.IdleLevel = HRTIM_OUTPUTIDLELEVEL_INACTIVE;
+	out.FaultLevel = HRTIM_OUTPUTFAULTLEVEL_NONE;
+	out.ChopperModeEnable = HRTIM_OUTPUTCHOPPERMODE_DISABLED;
+	out.BurstModeEntryDelayed = HRTIM_OUTPUTBURSTMODEENTRY_REGULAR;
+	if(HAL_HRTIM_TimeBaseConfig(&hhrtim1, HRTIM_TIMERINDEX_TIMER_A, &base) != HAL_OK ||
+		HAL_HRTIM_WaveformTimerConfig(&hhrtim1, HRTIM_TIMERINDEX_TIMER_A, &tim) != HAL_OK ||
+		HAL_HRTIM_WaveformCompareConfig(&hhrtim1, HRTIM_TIMERINDEX_TIMER_A, HRTIM_COMPAREUNIT_1, &cmp) != HAL_OK ||
+		HAL_HRTIM_DeadTimeConfig(&hhrtim1, HRTIM_TIMERINDEX_TIMER_A, &dt) != HAL_OK ||
+		HAL_HRTIM_WaveformOutputConfig(&hhrtim1, HRTIM_TIMERINDEX_TIMER_A, HRTIM_OUTPUT_TA1, &out) != HAL_OK)
+		return HAL_ERROR;
+
+	// Leg B: restarted and switched on by Master CMP1, the phase
+	base.Period = PSFB_TIMB_PER;
+	tim.InterruptRequests = HRTIM_TIM_IT_NONE;
+	tim.ResetTrigger = HRTIM_TIMRESETTRIGGER_MASTER_CMP1;
+	out.SetSource = HRTIM_OUTPUTSET_MASTERCMP1;
+	if(HAL_HRTIM_TimeBaseConfig(&hhrtim1, HRTIM_TIMERINDEX_TIMER_B, &base) != HAL_OK ||
+		HAL_HRTIM_WaveformTimerConfig(&hhrtim1, HRTIM_TIMERINDEX_TIMER_B, &tim) != HAL_OK ||
+		HAL_HRTIM_WaveformCompareConfig(&hhrtim1, HRTIM_TIMERINDEX_TIMER_B, HRTIM_COMPAREUNIT_1, &cmp) != HAL_OK ||
+		HAL_HRTIM_DeadTimeConfig(&hhrtim1, HRTIM_TIMERINDEX_TIMER_B, &dt) != HAL_OK ||
+		HAL_HRTIM_WaveformOutputConfig(&hhrtim1, HRTIM_TIMERINDEX_TIMER_B, HRTIM_OUTPUT_TB1, &out) != HAL_OK)
+		return HAL_ERROR;
+
+	// Outputs 2 follow the dead-time generator, their own crossbar is unused
+	out.SetSource = HRTIM_OUTPUTSET_NONE;
+	out.ResetSource = HRTIM_OUTPUTRESET_NONE;
+	if(HAL_HRTIM_WaveformOutputConfig(&hhrtim1, HRTIM_TIMERINDEX_TIMER_A, HRTIM_OUTPUT_TA2, &out) != HAL_OK ||
+		HAL_HRTIM_WaveformOutputConfig(&hhrtim1, HRTIM_TIMERINDEX_TIMER_B, HRTIM_OUTPUT_TB2, &out) != HAL_OK)
+		return HAL_ERROR;
+
+	// No light-load bursts on the bridge
+	HRTIM1->sCommonRegs.BMCR &= ~(HRTIM_BMCR_BME | HRTIM_BMCR_BMSTAT);
+	// ADC scan in the middle of the leg A pulse
+	HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A].CMP3xR = HRTIM_ADC_POINT(period);
+
+	Psfb.Per = period;
+	Psfb.Phase = PSFB_PHASE_MIN;
+	Psfb.Active = 1;
+	// Load the preloaded master registers, then run all three from zero
+	if(HAL_HRTIM_SoftwareUpdate(&hhrtim1, HRTIM_TIMERUPDATE_MASTER) != HAL_OK ||
+		HAL_HRTIM_SoftwareReset(&hhrtim1, HRTIM_TIMERRESET_MASTER | HRTIM_TIMERRESET_TIMER_A | HRTIM_TIMERRESET_TIMER_B) != HAL_OK ||
+		HAL_HRTIM_WaveformCounterStart(&hhrtim1, HRTIM_TIMERID_MASTER | HRTIM_TIMERID_TIMER_A | HRTIM_TIMERID_TIMER_B) != HAL_OK)
+		return HAL_ERROR;
+	return HAL_OK;
+}
+
+/** ===================================================================
+**     Function Name : void Psfb_SetPhase(uint32_t phase)
+**     Description : Phase of leg B behind leg A, applied from the next
+**       master period. Safe from the control ISR.
+**     Parameters  : phase - master counts, limited to
+**       PSFB_PHASE_MIN~half the period
+**     Returns     :
+** ===================================================================*/
+CCMRAM void Psfb_SetPhase(uint32_t phase)
+{
+	if(phase < PSFB_PHASE_MIN)
+		phase = PSFB_PHASE_MIN;
+	if(phase > (uint32_t)Psfb.Per >> 1)
+		phase = Psfb.Per >> 1;
+	Psfb.Phase = phase;
+	HRTIM1->sMasterRegs.MCMP1R = phase;
+}
+
+/** ===================================================================
+**     Function Name : void Psfb_SetDuty(int32_t duty)
+**     Description : Bridge duty from the voltage loop: the phase is
+**       that share of half the period
+**     Parameters  : duty - Q12, 0~4096
+**     Returns     :
+** ===================================================================*/
+CCMRAM void Psfb_SetDuty(int32_t duty)
+{
+	Psfb_SetPhase(duty < 0 ? 0 : (uint32_t)duty * Psfb.Per >> 13);
+}
@@ -0,0 +1,82 @@
+/**
+  ******************************************************************************
+  * @file    ring.c
+  * @brief   Lock-free single-producer / single-consumer ring.
+  *
+  *          One context puts and one context gets; either may be an
+  *          interrupt. Head and Tail are free-running 16-bit counts. Only
+  *          the producer writes Head and only the consumer writes Tail, so
+  *          neither side needs a lock or masks interrupts. The barriers
+  *          order an entry's contents against the index that hands it over:
+  *          the producer fills the entry before it bumps Head, and the
+  *          consumer reads the entry before it bumps Tail and frees the slot.
+  ******************************************************************************
+  */
+#include "ring.h"
+#include "function.h"
+#include "string.h"
+
+/** ===================================================================
+**     Function Name : uint8_t Ring_Put(struct _RING *r, const void *e)
+**     Description : Append an entry, producer side, never waits
+**     Parameters  : r - ring
+**                   e - entry, r->Size bytes
+**     Returns     : 1 if the entry was queued, 0 if the ring was full
+** ===================================================================*/
+CCMRAM uint8_t Ring_Put(struct _RING *r, const void *e)
+{
+	uint16_t head = r->Head;
+
+	if((uint16_t)(head - r->Tail) > r->Mask)
+	{
+		r->Drop++;//Full, the consumer is behind: drop
+		return 0;
+	}
+	memcpy(&r->Buf[(head & r->Mask) * r->Size], e, r->Size);
+	__DMB();//Entry visible before the index
+	r->Head = head + 1;
+	return 1;
+}
+
+/** ===================================================================
+**     Function Name : uint8_t Ring_Get(struct _RING *r, void *e)
+**     Description : Take the oldest entry, consumer side, never waits
+**     Parameters  : r - ring
+**                   e - receives the entry, r->Size bytes
+**     Returns     : 1 if an entry was taken, 0 if the ring is empty
+** ===================================================================*/
+CCMRAM uint8_t Ring_Get(struct _RING *r, void *e)
+{
+	uint16_t tail = r->Tail;
+
+	if(tail == r->Head)
+		return 0;
+	__DMB();//Index read before the entry
+	memcpy(e, &r->Buf[(tail & r->Mask) * r->Size], r->Size);
+	__DMB();//Entry read before the slot is handed back
+	r->Tail = tail + 1;
+	return 1;
+}
+
+/** ===================================================================
+**     Function Name : uint16_t Ring_Count(const struct _RING *r)
+**     Description : Entries queued. Exact on the consumer side; from any
+**       other context it may be one put or get out of date.
+**     Parameters  : r - ring
+**     Returns     : number of entries
+** ===================================================================*/
+uint16_t Ring_Count(const struct _RING *r)
+{
+	return (uint16_t)(r->Head - r->Tail);
+}
+
+/** ===================================================================
+**     Function Name : void Ring_Flush(struct _RING *r)
+**     Description : Drop all queued entries, consumer side
+**     Parameters  : r - ring
+**     Returns     :
+** ===================================================================*/
+void Ring_Flush(struct _RING *r)
+{
+	r->Tail = r->Head;
+}
@@ -0,0 +1,244 @@
+/**
+  ******************************************************************************
+  * @file    sched.c
+  * @brief   Fixed-priority, run-to-completion task scheduler on TIM2.
+  *
+  *          Sched_Tick() runs in the TIM2 update interrupt and releases each
+  *          task when its period has elapsed. Sched_Run() is called from the
+  *          main loop and runs the highest priority released task, priority
+  *          being the order of Sched_Add(). Each run is timed with the DWT
+  *          cycle counter. A task misses its deadline when it is released
+  *          again before it started (Lost) or completes more than one period
+  *          after its release (Late).
+  ******************************************************************************
+  */
+#include "sched.h"
+#include "dwt.h"
+#include "usart.h"
+#include "jitter.h"
+#include "prof.h"
+#include "load.h"
+#include "memmon.h"
+#include "snap.h"
+#include "fault.h"
+#include "burst.h"
+#include "stdio.h"
+#include "string.h"
+
+struct _SCHED_TASK SchedTask[SCHED_MAX_TASKS];
+uint8_t SchedTaskNum = 0;
+static volatile uint32_t SchedTicks = 0;
+
+/** ===================================================================
+**     Function Name : void Sched_Init(void)
+**     Description : Clear the task table. Call before TIM2 is started.
+**     Parameters  :
+**     Returns     :
+** ===================================================================*/
+void Sched_Init(void)
+{
+	uint8_t i;
+
+	for(i=0;i<SCHED_MAX_TASKS;i++)
+		SchedTask[i].Func = 0;
+	SchedTaskNum = 0;
+	DWT_Init();
+}
+
+/** ===================================================================
+**     Function Name : uint8_t Sched_Add(const char *name, void (*func)(void), uint16_t period_ms)
+**     Description : Register a task. Tasks added first have the higher
+**       priority. Call before TIM2 is started.
+**     Parameters  : name - short name for the telemetry
+**                   func - task body, must return
+**                   period_ms - release period, at least one tick
+**     Returns     : task index, or SCHED_MAX_TASKS if the table is full
+** ===================================================================*/
+uint8_t Sched_Add(const char *name, void (*func)(void), uint16_t period_ms)
+{
+	struct _SCHED_TASK *t;
+
+	if(SchedTaskNum >= SCHED_MAX_TASKS)
+		return SCHED_MAX_TASKS;
+
+	t = &SchedTask[SchedTaskNum];
+	t->Name = name;
+	t->Func = func;
+	t->Period = SCHED_MS(period_ms) ? SCHED_MS(period_ms) : 1;
+	t->Count = t->Period;
+	t->Ready = 0;
+	t->Last = t->Max = t->Avg = 0;
+	t->Runs = t->Lost = t->Late = 0;
+	return SchedTaskNum++;
+}
+
+/** ===================================================================
+**     Function Name : void Sched_Tick(void)
+**     Description : Release the tasks whose period has elapsed. Called
+**       from the TIM2 update interrupt at SCHED_TICK_HZ.
+**     Parameters  :
+**     Returns     :
+** ===================================================================*/
+void Sched_Tick(void)
+{
+	struct _SCHED_TASK *t;
+	uint8_t i;
+
+	SchedTicks++;
+	for(i=0;i<SchedTaskNum;i++)
+	{
+		t = &SchedTask[i];
+		if(--t->Count)
+			continue;
+		t->Count = t->Period;
+		if(t->Ready)
+			t->Lost++;
+		t->Release = SchedTicks;
+		t->Ready = 1;
+	}
+}
+
+/** ===================================================================
+**     Function Name : uint8_t Sched_Run(void)
+**     Description : Run the highest priority released task to completion
+**       and update its statistics. Called from the main loop.
+**     Parameters  :
+**     Returns     : 1 if a task was run, 0 if none was released
+** ===================================================================*/
+uint8_t Sched_Run(void)
+{
+	struct _SCHED_TASK *t;
+	uint32_t release, t0, dt;
+	uint8_t i;
+
+	for(i=0;i<SchedTaskNum;i++)
+	{
+		t = &SchedTask[i];
+		if(!t->Ready)
+			continue;
+
+		__disable_irq();
+		release = t->Release;
+		t->Ready = 0;
+		__enable_irq();
+
+		t0 = DWT_CYCLES();
+		t->Func();
+		dt = DWT_CYCLES() - t0;
+
+		t->Last = dt;
+		if(dt > t->Max)
+			t->Max = dt;
+		t->Avg += dt - (t->Avg >> 4);
+		t->Runs++;
+		if(SchedTicks - release > t->Period)
+			t->Late++;
+		return 1;
+	}
+	return 0;
+}
+
+/** ===================================================================
+**     Function Name : uint8_t Sched_Pending(void)
+**     Description : Check for released tasks not run yet
+**     Parameters  :
+**     Returns     : 1 if a task is released, 0 if none
+** ===================================================================*/
+uint8_t Sched_Pending(void)
+{
+	uint8_t i;
+
+	for(i=0;i<SchedTaskNum;i++)
+	{
+		if(SchedTask[i].Ready)
+			return 1;
+	}
+	return 0;
+}
+
+/** ===================================================================
+**     Function Name : uint32_t Sched_GetTicks(void)
+**     Description : Scheduler ticks since TIM2 was started
+**     Parameters  :
+**     Returns     : ticks at SCHED_TICK_HZ
+** ===================================================================*/
+uint32_t Sched_GetTicks(void)
+{
+	return SchedTicks;
+}
+
+/** ===================================================================
+**     Function Name : uint8_t Sched_Format(uint8_t line, char *buf)
+**     Description : Telemetry lines: a header, then one line per task
+**       with the period in ms, the runs, last/max/average execution
+**       time in us and the deadline misses
+**     Parameters  : line - line number, from 0
+**                   buf - receives the line, at least 128 bytes
+**     Returns     : 1 if a line was written, 0 past the last line
+** ===================================================================*/
+uint8_t Sched_Format(uint8_t line, char *buf)
+{
+	struct _SCHED_TASK *t;
+	uint32_t mhz = SystemCoreClock / 1000000;
+
+	if(line == 0)
+	{
+		strcpy(buf, "[SCH] task per_ms runs last_us max_us avg_us lost late\r\n");
+		return 1;
+	}
+	if(line > SchedTaskNum)
+		return 0;
+
+	t = &SchedTask[line - 1];
+	sprintf(buf, "[SCH] %s %u %u %u %u %u %u %u\r\n", t->Name,
+		(unsigned)(t->Period * 1000 / SCHED_TICK_HZ), (unsigned)t->Runs,
+		(unsigned)(t->Last / mhz), (unsigned)(t->Max / mhz), (unsigned)((t->Avg >> 4) / mhz),
+		(unsigned)t->Lost, (unsigned)t->Late);
+	return 1;
+}
+
+// Telemetry sections, printed in this order, each one line per Telemetry_Task() run
+static uint8_t (*const TlmSection[])(uint8_t line, char *buf) =
+{
+	Sched_Format,
+	Load_Format,
+	Mem_Format,
+	Snap_Format,
+	Fault_Format,
+	Burst_Format,
+#if JITTER_PROBE
+	Jitter_Format,
+#endif
+#if PROF_ENABLE
+	Prof_Format,
+#endif
+};
+#define TLM_SECTIONS	(sizeof(TlmSection) / sizeof(TlmSection[0]))
+
+/** ===================================================================
+**     Function Name : void Telemetry_Task(void)
+**     Description : Print the telemetry sections on USART2, one line per
+**       run so no run blocks. Lines are sent by DMA, a line is retried on
+**       the next run while the previous one is still going out.
+**     Parameters  :
+**     Returns     :
+** ===================================================================*/
+void Telemetry_Task(void)
+{
+	static uint8_t sec = 0, line = 0;
+	char buf[128];
+	uint8_t n;
+
+	for(n=0;n<=TLM_SECTIONS;n++)
+	{
+		if(TlmSection[sec](line, buf))
+			break;
+		line = 0;
+		sec = (sec + 1) % TLM_SECTIONS;
+	}
+	if(n > TLM_SECTIONS)
+		return;
+
+	if(USART2_SendAsync(buf))
+		line++;
+}
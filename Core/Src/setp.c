@@ -0,0 +1,119 @@
+/**
+  ******************************************************************************
+  * @file    setp.c
+  * @brief   Setpoint changes applied by the control ISR.
+  *
+  *          Thread code posts frequency and dead-time changes to a ring;
+  *          Setp_Apply() drains it at the start of the control ISR, right
+  *          after the Timer A period rolled over, and writes the HRTIM
+  *          registers directly. The change then lands at a period boundary
+  *          and never races the loop. Changes that need a new HRTIM
+  *          prescaler are left to SetPWMFrequency() in thread code.
+  ******************************************************************************
+  */
+#include "setp.h"
+#include "ring.h"
+#include "fault.h"
+#include "function.h"
+#include "psfb.h"
+#include "fm.h"
+
+// Written only by thread code, read only by the control ISR
+RING_DEFINE(SetpQueue, struct _SETP, SETP_QUEUE_LEN);
+
+/** ===================================================================
+**     Function Name : uint32_t Setp_FreqPeriod(uint32_t hz)
+**     Description : Timer A/B period for a frequency at the HRTIM
+**       prescaler in use
+**     Parameters  : hz - PWM frequency
+**     Returns     : period in HRTIM counts, 0 if it is out of
+**       CNTR_MIN..CNTR_MAX and the prescaler has to change
+** ===================================================================*/
+CCMRAM uint32_t Setp_FreqPeriod(uint32_t hz)
+{
+	uint32_t ckpsc = HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A].TIMxCR & HRTIM_TIMCR_CK_PSC;
+	uint32_t per;
+
+	if(hz == 0)
+		return 0;
+	per = ((SystemCoreClock << 5) >> ckpsc) / hz;//CKPSC 0 counts at 32 x fHRTIM
+	if(per < CNTR_MIN || per > CNTR_MAX)
+		return 0;
+	return per;
+}
+
+/** ===================================================================
+**     Function Name : uint8_t Setp_Post(uint8_t type, uint32_t value)
+**     Description : Queue a setpoint change for the control ISR. Thread
+**       code only, never waits.
+**     Parameters  : type - SETP_xxx
+**                   value - new setpoint
+**     Returns     : 1 if queued, 0 if the queue is full
+** ===================================================================*/
+uint8_t Setp_Post(uint8_t type, uint32_t value)
+{
+	struct _SETP sp;
+
+	sp.Type = type;
+	sp.Value = value;
+	return Ring_Put(&SetpQueue, &sp);
+}
+
+/** ===================================================================
+**     Function Name : void Setp_Apply(void)
+**     Description : Apply the queued setpoint changes. Called first in
+**       the control ISR. Preload is off, so the new period and compare
+**       values take effect in the period that has just started.
+**     Parameters  :
+**     Returns     :
+** ===================================================================*/
+CCMRAM void Setp_Apply(void)
+{
+	struct _SETP sp;
+	uint32_t per, ticks;
+
+	while(Ring_Get(&SetpQueue, &sp))
+	{
+		// The bridge has its own period and dead time
+		if(Psfb.Active)
+		{
+			Fault_Post(FLT_EV_SETP_REJECT, sp.Type);
+			continue;
+		}
+		switch(sp.Type)
+		{
+			case SETP_FREQ:
+				// In closed-loop mode the voltage loop owns the period
+				per = Fm.Active ? 0 : Setp_FreqPeriod(sp.Value);
+				if(per == 0)
+				{
+					Fault_Post(FLT_EV_SETP_REJECT, SETP_FREQ);
+					break;
+				}
+				// Same registers SetPWMFrequency() sets up, without the timer reset
+				HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A].PERxR = per;
+				HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_B].PERxR = per;
+				HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A].CMP2xR = per / 2 - 1;
+				HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_B].CMP2xR = per / 2 - 1;
+				HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A].CMP3xR = HRTIM_ADC_POINT(per);
+				pGlobalTimeBaseCfg.Period = per;
+				currentPWMFreqHz = sp.Value;
+				break;
+			case SETP_DEADTIME:
+				if(sp.Value < DEADTIME_MIN_PX1000 || sp.Value > DEADTIME_MAX_PX1000)
+				{
+					Fault_Post(FLT_EV_SETP_REJECT, SETP_DEADTIME);
+					break;
+				}
+				// Same compare values as SetDeadTimeManual()
+				per = HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A].PERxR;
+				ticks = per * sp.Value / 1000;
+				HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A].CMP2xR = ticks;
+				HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_B].CMP2xR = per - ticks;
+				break;
+			default:
+				Fault_Post(FLT_EV_SETP_REJECT, sp.Type);
+				break;
+		}
+	}
+}
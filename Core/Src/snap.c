@@ -0,0 +1,86 @@
+/**
+  ******************************************************************************
+  * @file    snap.c
+  * @brief   Coherent snapshots of SADC, CtrValue and DF for thread code.
+  *
+  *          The control ISR copies the three structs into one of two buffers
+  *          at the end of every period and then bumps a sequence count; the
+  *          count selects the buffer, so the ISR never writes the one that
+  *          was published last. A reader copies the published buffer and
+  *          checks the count again. The control ISR has the highest priority
+  *          and always runs to completion, so a reader only sees a torn copy
+  *          if two or more periods (20us) elapse during the copy, and then it
+  *          simply copies again. The ISR side never waits and never sees the
+  *          readers; interrupts stay enabled throughout.
+  ******************************************************************************
+  */
+#include "snap.h"
+#include "stdio.h"
+
+static struct _SNAP SnapBuf[2];
+static volatile uint32_t SnapSeq = 0;
+uint32_t SnapRetry = 0;//Reads copied again after a torn copy
+
+/** ===================================================================
+**     Function Name : void Snap_Publish(void)
+**     Description : Publish the control state. Called from the control
+**       ISR after the sample and the loop update.
+**     Parameters  :
+**     Returns     :
+** ===================================================================*/
+CCMRAM void Snap_Publish(void)
+{
+	uint32_t seq = SnapSeq + 1;
+	struct _SNAP *s = &SnapBuf[seq & 1];
+
+	s->Seq = seq;
+	s->Adc = SADC;
+	s->Ctr = CtrValue;
+	s->Flag = DF;
+	__DMB();//Record complete before the count
+	SnapSeq = seq;
+}
+
+/** ===================================================================
+**     Function Name : uint32_t Snap_Read(struct _SNAP *s)
+**     Description : Take a consistent copy of the last published state.
+**       Call only from code that runs below the control ISR priority.
+**     Parameters  : s - receives the copy
+**     Returns     : publish count of the copy, 0 before the first one
+** ===================================================================*/
+uint32_t Snap_Read(struct _SNAP *s)
+{
+	uint32_t seq;
+
+	for(;;)
+	{
+		seq = SnapSeq;
+		__DMB();//Count read before the record
+		*s = SnapBuf[seq & 1];
+		__DMB();//Record read before the count check
+		// One publish meanwhile wrote the other buffer; two reached this one
+		if(SnapSeq - seq <= 1)
+			return seq;
+		SnapRetry++;
+	}
+}
+
+/** ===================================================================
+**     Function Name : uint8_t Snap_Format(uint8_t line, char *buf)
+**     Description : Telemetry line with the published control state
+**     Parameters  : line - line number, from 0
+**                   buf - receives the line, at least 128 bytes
+**     Returns     : 1 if a line was written, 0 past the last line
+** ===================================================================*/
+uint8_t Snap_Format(uint8_t line, char *buf)
+{
+	struct _SNAP s;
+
+	if(line != 0)
+		return 0;
+	Snap_Read(&s);
+	sprintf(buf, "[CTL] seq=%u vout=%d iout=%d vref=%d duty=%d sm=%u err=0x%04X retry=%u\r\n",
+		(unsigned)s.Seq, (int)s.Adc.VoutAvg, (int)s.Adc.IoutAvg, (int)s.Ctr.Voref, (int)s.Ctr.BuckDuty,
+		(unsigned)s.Flag.SMFlag, (unsigned)s.Flag.ErrFlag, (unsigned)SnapRetry);
+	return 1;
+}
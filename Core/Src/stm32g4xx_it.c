@@ -28,6 +28,11 @@
 /* USER CODE BEGIN TD */
 #include "function.h"
 #include "CtlLoop.h"
+#include "blackbox.h"
+#include "key.h"
+#include "sched.h"
+#include "jitter.h"
+#include "load.h"
 
 /* USER CODE END TD */
 
@@ -38,7 +43,8 @@
 
 /* Private macro -------------------------------------------------------------*/
 /* USER CODE BEGIN PM */
-
+#define BB_STR(x)   #x
+#define BB_XSTR(x)  BB_STR(x)
 /* USER CODE END PM */
 
 /* Private variables ---------------------------------------------------------*/
@@ -64,7 +70,7 @@ extern TIM_HandleTypeDef htim2;
 extern DMA_HandleTypeDef hdma_usart2_tx;
 extern UART_HandleTypeDef huart2;
 /* USER CODE BEGIN EV */
-
+extern I2C_HandleTypeDef hi2c3;
 /* USER CODE END EV */
 
 /******************************************************************************/
@@ -267,26 +273,13 @@ void ADC1_2_IRQHandler(void)
 void TIM2_IRQHandler(void)
 {
   /* USER CODE BEGIN TIM2_IRQn 0 */
-	//HAL_GPIO_TogglePin(TEST_LED_GPIO_Port, TEST_LED_Pin);
-
-  //key scan
-  //KEYFlag();
-
-	//HAL_ADC_Start_DMA(&hadc1, (uint32_t*)ADC1_RESULT, 4); // Start ADC1 sampling, DMA transfer for sampling input/output voltage and current
-	//HAL_ADC_Start(&hadc1); // Start ADC2 sampling, sampling the sliding potentiometer voltage
-
-  //ADCSample();
-  //Button_Task();
-
-  //OLEDShow();
-
-  //HAL_GPIO_TogglePin(TEST_LED_GPIO_Port, TEST_LED_Pin); // {{ LED
-
-
+  // TIM2 update at 2kHz: key scan and scheduler tick in HAL_TIM_PeriodElapsedCallback()
+  LOAD_ISR_ENTER();
 
   /* USER CODE END TIM2_IRQn 0 */
   HAL_TIM_IRQHandler(&htim2);
   /* USER CODE BEGIN TIM2_IRQn 1 */
+  LOAD_ISR_EXIT();
 
   /* USER CODE END TIM2_IRQn 1 */
 }
@@ -307,4 +300,120 @@ void USART2_IRQHandler(void)
 
 /* USER CODE BEGIN 1 */
 
+/**
+  * @brief This function handles HRTIM timer A global interrupt.
+  *        Timer A repetition event, once per PWM period: control ISR.
+  */
+void HRTIM1_TIMA_IRQHandler(void)
+{
+  JITTER_SAMPLE();
+  LOAD_ISR_ENTER();
+  __HAL_HRTIM_TIMER_CLEAR_IT(&hhrtim1, HRTIM_TIMERINDEX_TIMER_A, HRTIM_TIM_IT_REP);
+
+  Control_Period();
+  LOAD_ISR_EXIT();
+}
+
+/**
+  * @brief This function handles I2C3 event interrupt.
+  */
+void I2C3_EV_IRQHandler(void)
+{
+  HAL_I2C_EV_IRQHandler(&hi2c3);
+}
+
+/**
+  * @brief This function handles I2C3 error interrupt.
+  */
+void I2C3_ER_IRQHandler(void)
+{
+  HAL_I2C_ER_IRQHandler(&hi2c3);
+}
+
+/**
+  * @brief TIM update callback, TIM2 at 2kHz: key scan and scheduler tick.
+  */
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
+{
+  if(htim->Instance == TIM2)
+  {
+    Key_Tick();
+    Sched_Tick();
+  }
+}
+
+/**
+  * @brief Black box entries for the NMI and fault vectors.
+  *        The startup file points those vectors here rather than at the
+  *        generated handlers above, so CubeMX regeneration keeps them.
+  *        Each entry loads its BB_SRC_xxx and joins BB_FaultEntry, which
+  *        hands the stacked frame to the black box. None of them return.
+  */
+#if defined(__CC_ARM)
+__asm void BB_FaultEntry(void)
+{
+  PRESERVE8
+  IMPORT  BlackBox_Fault
+  TST     LR, #4
+  ITE     EQ
+  MRSEQ   R0, MSP
+  MRSNE   R0, PSP
+  B       BlackBox_Fault
+}
+
+__asm void BB_NMI_Handler(void)
+{
+  MOVS    R1, #BB_SRC_NMI
+  B       __cpp(BB_FaultEntry)
+}
+
+__asm void BB_HardFault_Handler(void)
+{
+  MOVS    R1, #BB_SRC_HARDFAULT
+  B       __cpp(BB_FaultEntry)
+}
+
+__asm void BB_MemManage_Handler(void)
+{
+  MOVS    R1, #BB_SRC_MEMMANAGE
+  B       __cpp(BB_FaultEntry)
+}
+
+__asm void BB_BusFault_Handler(void)
+{
+  MOVS    R1, #BB_SRC_BUSFAULT
+  B       __cpp(BB_FaultEntry)
+}
+
+__asm void BB_UsageFault_Handler(void)
+{
+  MOVS    R1, #BB_SRC_USAGEFAULT
+  B       __cpp(BB_FaultEntry)
+}
+#else
+__attribute__((naked)) void BB_FaultEntry(void)
+{
+  __ASM volatile(
+    "tst   lr, #4                          \n"
+    "ite   eq                              \n"
+    "mrseq r0, msp                         \n"
+    "mrsne r0, psp                         \n"
+    "b     BlackBox_Fault                  \n");
+}
+
+#define BB_ENTRY(name, src) \
+__attribute__((naked)) void name(void) \
+{ \
+  __ASM volatile( \
+    "movs  r1, #" BB_XSTR(src) "\n" \
+    "b     BB_FaultEntry                   \n"); \
+}
+
+BB_ENTRY(BB_NMI_Handler, BB_SRC_NMI)
+BB_ENTRY(BB_HardFault_Handler, BB_SRC_HARDFAULT)
+BB_ENTRY(BB_MemManage_Handler, BB_SRC_MEMMANAGE)
+BB_ENTRY(BB_BusFault_Handler, BB_SRC_BUSFAULT)
+BB_ENTRY(BB_UsageFault_Handler, BB_SRC_USAGEFAULT)
+#endif
+
 /* USER CODE END 1 */
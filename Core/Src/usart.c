@@ -21,7 +21,7 @@
 #include "usart.h"
 
 /* USER CODE BEGIN 0 */
-
+#include "string.h"
 /* USER CODE END 0 */
 
 UART_HandleTypeDef huart2;
@@ -126,7 +126,7 @@ void HAL_UART_MspInit(UART_HandleTypeDef* uartHandle)
     __HAL_LINKDMA(uartHandle,hdmatx,hdma_usart2_tx);
 
     /* USART2 interrupt Init */
-    HAL_NVIC_SetPriority(USART2_IRQn, 0, 0);
+    HAL_NVIC_SetPriority(USART2_IRQn, 4, 0);
     HAL_NVIC_EnableIRQ(USART2_IRQn);
   /* USER CODE BEGIN USART2_MspInit 1 */
 
@@ -164,4 +164,34 @@ void HAL_UART_MspDeInit(UART_HandleTypeDef* uartHandle)
 
 /* USER CODE BEGIN 1 */
 
+/**
+  * @brief  Blocking transmit of a zero terminated string on USART2.
+  * @param  str: string to send
+  * @retval None
+  */
+void USART2_SendString(const char *str)
+{
+  HAL_UART_Transmit(&huart2, (uint8_t *)str, strlen(str), 100);
+}
+
+/**
+  * @brief  Non-blocking transmit of a zero terminated string on USART2.
+  *         The string is copied and sent by DMA, longer strings are cut
+  *         to the buffer size.
+  * @param  str: string to send
+  * @retval 1 if the transfer was started, 0 if the previous one is still running
+  */
+uint8_t USART2_SendAsync(const char *str)
+{
+  static uint8_t TxBuf[128];
+  size_t len = strlen(str);
+
+  if (huart2.gState != HAL_UART_STATE_READY)
+    return 0;
+  if (len > sizeof(TxBuf))
+    len = sizeof(TxBuf);
+  memcpy(TxBuf, str, len);
+  return HAL_UART_Transmit_DMA(&huart2, TxBuf, len) == HAL_OK;
+}
+
 /* USER CODE END 1 */
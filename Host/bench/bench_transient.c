@@ -0,0 +1,206 @@
+/**
+  ******************************************************************************
+  * @file    bench_transient.c
+  * @brief   Load-transient benchmark of the compensators on the simulated stage.
+  *
+  *          For each compensator in Comp[], sweeps the load step and its
+  *          slew, the input voltage and the PWM frequency over
+  *          FREQ_MIN~FREQ_MAX. Control_Period() runs the row's loop through
+  *          VLoopHook (VLOOP_HOOK, CtlLoop.h). The tree has one loop,
+  *          BUCKVLoopCtlPID() with the CtlCoef.h in the build; other
+  *          coefficients are compared by building against a candidate with
+  *          coefgen.py, which sets CTL_COEF_DIR.
+  *          Every point soft-starts the rig, settles at the operating
+  *          point, steps a constant-current load on and off again and
+  *          tabulates undershoot, overshoot and the settling time of both
+  *          edges. The cycles per control period come from a boot log of
+  *          the firmware benchmark (bench.h), the [BEN] isr and vloop lines.
+  *
+  *          bench_transient [--quick] [--switching] [--cycles boot.log] [--csv out.csv]
+  ******************************************************************************
+  */
+#include "host.h"
+#include "rig.h"
+#include "function.h"
+#include "CtlLoop.h"
+#include "string.h"
+#include "stdio.h"
+#include "math.h"
+
+#define SETTLE_BAND		0.01	// Settled within +-1% of the target
+#define EDGE_MS			20		// Time after each load edge
+
+// Compensators to compare: the loop Control_Period() runs for the row and
+// the bench.c item that times it. A variant is another row with its loop.
+static const struct
+{
+	const char	*Name;
+	void		(*Loop)(void);
+	const char	*Bench;
+} Comp[] = {
+	{"pid", BUCKVLoopCtlPID, "vloop"},
+};
+
+/***************************** Sweep *****************/
+static const double StepA[] = {0.5, 1.0, 2.0};//Load step on top of the 12R base load, A
+static const double SlewA[] = {0, 0.01, 0.001};//A/us, 0 = instant
+static const double VinV[] = {18.0, 24.0, 30.0};
+static const uint32_t FreqHz[] = {70000, 100000, 130000};//FREQ_MIN, nominal, FREQ_MAX in function.c
+
+// Constant-current load ramp, run after each control ISR
+static double LoadTarget;//A
+static double LoadSlew;//A/s, 0 = instant
+static double LoadTime;//Plant time of the last ramp step
+
+static void Load_Probe(void)
+{
+	double *i = &Rig.Plant.Cfg.Iload;
+	double d = LoadSlew * (Rig.Plant.Time - LoadTime);
+
+	LoadTime = Rig.Plant.Time;
+	if(LoadSlew == 0 || fabs(LoadTarget - *i) <= d)
+		*i = LoadTarget;
+	else
+		*i += *i < LoadTarget ? d : -d;
+}
+
+static void Load_Set(double a, double slew)
+{
+	LoadTarget = a;
+	LoadSlew = slew * 1e6;
+	LoadTime = Rig.Plant.Time;
+}
+
+struct _RESULT
+{
+	double		Under;//Undershoot on the step on, % of Vout
+	double		Over;//Overshoot on the step off, % of Vout
+	double		SettleOn;//ms
+	double		SettleOff;//ms
+	uint16_t	Err;//DF.ErrFlag at the end
+};
+
+// Cycles of one [BEN] item from a boot log, 0 if not there
+static uint32_t Cycles(const char *log, const char *item)
+{
+	FILE *f;
+	char line[160], key[32];
+	unsigned lo, hi, mean;
+	uint32_t cyc = 0;
+
+	if(!log || !(f = fopen(log, "r")))
+		return 0;
+	snprintf(key, sizeof(key), "[BEN] %s ", item);
+	while(fgets(line, sizeof(line), f))
+	{
+		char *p = strstr(line, key);
+
+		if(p && sscanf(p + strlen(key), "min=%u max=%u mean=%u", &lo, &hi, &mean) == 3)
+			cyc = hi;
+	}
+	fclose(f);
+	return cyc;
+}
+
+static void Point(uint8_t model, double step, double slew, double vin, uint32_t hz, struct _RESULT *r)
+{
+	double v;
+
+	Rig.Probe = 0;
+	Rig_Start(model);
+	Rig.Plant.Cfg.Vin = vin;
+	if(hz != 100000)
+		RequestPWMFrequency(hz);
+	Rig_Advance(30);
+	v = Rig_Target();
+
+	Load_Set(step, slew);
+	Rig.Probe = Load_Probe;
+	Plant_Watch(&Rig.Plant, v, v * SETTLE_BAND);
+	Rig_Advance(EDGE_MS);
+	r->Under = (v - Rig.Plant.Min) / v * 100;
+	r->SettleOn = Plant_Settle(&Rig.Plant) * 1e3;
+
+	Load_Set(0, slew);
+	Plant_Watch(&Rig.Plant, v, v * SETTLE_BAND);
+	Rig_Advance(EDGE_MS);
+	r->Over = (Rig.Plant.Max - v) / v * 100;
+	r->SettleOff = Plant_Settle(&Rig.Plant) * 1e3;
+	r->Err = DF.ErrFlag;
+	Rig.Probe = 0;
+}
+
+int main(int argc, char **argv)
+{
+	const char *log = 0, *csv = 0;
+	char slew[8];
+	uint8_t model = PLANT_AVERAGED, quick = 0, c;
+	uint32_t a, s, v, h, cyc, points = 0;
+	FILE *out = 0;
+	struct _RESULT r;
+	int i;
+
+	for(i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "--quick") == 0)
+			quick = 1;
+		else if(strcmp(argv[i], "--switching") == 0)
+			model = PLANT_SWITCHING;
+		else if(strcmp(argv[i], "--cycles") == 0 && i + 1 < argc)
+			log = argv[++i];
+		else if(strcmp(argv[i], "--csv") == 0 && i + 1 < argc)
+			csv = argv[++i];
+		else
+		{
+			printf("usage: bench_transient [--quick] [--switching] [--cycles boot.log] [--csv out.csv]\n");
+			return 2;
+		}
+	}
+	if(csv && !(out = fopen(csv, "w")))
+	{
+		printf("bench_transient: cannot write %s\n", csv);
+		return 1;
+	}
+	if(out)
+		fprintf(out, "comp,step_a,slew_a_us,vin_v,freq_hz,under_pct,over_pct,settle_on_ms,settle_off_ms,err,cycles\n");
+
+	for(c = 0; c < sizeof(Comp) / sizeof(Comp[0]); c++)
+	{
+		VLoopHook = Comp[c].Loop;
+		cyc = Cycles(log, "isr");
+		if(cyc && Cycles(log, Comp[c].Bench))
+			cyc += Cycles(log, Comp[c].Bench);
+		else
+			cyc = 0;
+		printf("Compensator %s, %s model, ", Comp[c].Name, model == PLANT_AVERAGED ? "averaged" : "switching");
+		if(cyc)
+			printf("%u cycles per control period (%s)\n", (unsigned)cyc, log);
+		else
+			printf("cycles per control period not measured, see --cycles\n");
+		printf("  %5s %7s %5s %7s %7s %7s %9s %9s %s\n", "Step", "Slew", "Vin", "Freq", "Under", "Over", "Settle+", "Settle-", "Err");
+		printf("  %5s %7s %5s %7s %7s %7s %9s %9s\n", "A", "A/us", "V", "kHz", "%", "%", "ms", "ms");
+
+		for(a = quick ? 1 : 0; a < (quick ? 2 : 3); a++)
+		for(s = 0; s < (quick ? 1u : 3u); s++)
+		for(v = quick ? 1 : 0; v < (quick ? 2 : 3); v++)
+		for(h = quick ? 1 : 0; h < (quick ? 2 : 3); h++)
+		{
+			Point(model, StepA[a], SlewA[s], VinV[v], FreqHz[h], &r);
+			if(SlewA[s] == 0)
+				strcpy(slew, "step");
+			else
+				snprintf(slew, sizeof(slew), "%.3f", SlewA[s]);
+			printf("  %5.2f %7s %5.1f %7.1f %7.2f %7.2f %9.2f %9.2f %s\n", StepA[a], slew, VinV[v], FreqHz[h] / 1000.0,
+				r.Under, r.Over, r.SettleOn, r.SettleOff, r.Err ? "trip" : "");
+			if(out)
+				fprintf(out, "%s,%.2f,%.3f,%.1f,%u,%.3f,%.3f,%.3f,%.3f,%u,%u\n", Comp[c].Name, StepA[a], SlewA[s],
+					VinV[v], (unsigned)FreqHz[h], r.Under, r.Over, r.SettleOn, r.SettleOff, r.Err, (unsigned)cyc);
+			points++;
+		}
+	}
+	VLoopHook = BUCKVLoopCtlPID;
+	if(out)
+		fclose(out);
+	printf("%u points\n", (unsigned)points);
+	return HostErrorCount != 0;
+}
@@ -0,0 +1,407 @@
+/**
+  ******************************************************************************
+  * @file    hrsim.c
+  * @brief   HRTIM1 Master, Timer A and Timer B emulator for waveform checks.
+  *
+  *          Steps the timers one HRTIM base tick (fHRTIM x 32) at a time
+  *          from the register values the firmware and the HAL driver left
+  *          in the host blocks:
+  *          - counters in continuous mode, prescaled by CK_PSC, period and
+  *            compare 1..4 events on the counter reaching the value
+  *          - CR2 software reset and software update requests
+  *          - preload: with PREEN the active period and compares change
+  *            only on an update (repetition, reset, master, Timer A or
+  *            software), without it on every write
+  *          - reset triggers: master period and compares, own compare 2
+  *            and 4, update
+  *          - output set/reset sources from the own timer and the master,
+  *            reset winning over a simultaneous set, then polarity and the
+  *            idle state of a disabled output
+  *          - dead-time insertion: output 1 follows the crossbar of output
+  *            1 with its rising edge delayed by DTR, output 2 the
+  *            complement with its rising edge delayed by DTF; a pulse
+  *            shorter than its delay is lost
+  *          The repetition counter is taken as 0, negative dead times,
+  *          push-pull and faults are not modelled; the firmware uses none
+  *          of them. Nor is the burst mode controller, which plant.c runs
+  *          per PWM period.
+  ******************************************************************************
+  */
+#include "hrsim.h"
+#include "host.h"
+#include "string.h"
+
+static const uint32_t TimCen[HRSIM_TIM_NUM] = {HRTIM_MCR_MCEN, HRTIM_MCR_TACEN, HRTIM_MCR_TBCEN};
+static const uint32_t TimRst[HRSIM_TIM_NUM] = {HRTIM_CR2_MRST, HRTIM_CR2_TARST, HRTIM_CR2_TBRST};
+static const uint32_t TimSwu[HRSIM_TIM_NUM] = {HRTIM_CR2_MSWU, HRTIM_CR2_TASWU, HRTIM_CR2_TBSWU};
+static const uint32_t CmpEv[4] = {HRTIM_SET1R_CMP1, HRTIM_SET1R_CMP2, HRTIM_SET1R_CMP3, HRTIM_SET1R_CMP4};
+static const uint32_t MstCmpEv[4] = {HRTIM_SET1R_MSTCMP1, HRTIM_SET1R_MSTCMP2, HRTIM_SET1R_MSTCMP3, HRTIM_SET1R_MSTCMP4};
+static const uint32_t RstMstCmp[4] = {HRTIM_RSTR_MSTCMP1, HRTIM_RSTR_MSTCMP2, HRTIM_RSTR_MSTCMP3, HRTIM_RSTR_MSTCMP4};
+
+// Output to timer, enable bit and register half
+static const struct
+{
+	uint8_t		Tim;//HRSIM_TIMx
+	uint32_t	Enable;//HRTIM_OUTPUT_xxx
+	uint8_t		Second;//Output 2 of its timer
+} OutMap[HRSIM_OUT_NUM] =
+{
+	{HRSIM_TIMA, HRTIM_OUTPUT_TA1, 0},
+	{HRSIM_TIMA, HRTIM_OUTPUT_TA2, 1},
+	{HRSIM_TIMB, HRTIM_OUTPUT_TB1, 0},
+	{HRSIM_TIMB, HRTIM_OUTPUT_TB2, 1},
+};
+
+#define TIMX(tim)	HRTIM1->sTimerxRegs[(tim) - HRSIM_TIMA]
+
+static uint32_t HrSim_Cr(uint8_t tim)
+{
+	return (tim == HRSIM_MASTER) ? HRTIM1->sMasterRegs.MCR : TIMX(tim).TIMxCR;
+}
+
+// Copy the period and compare registers to the active set
+static void HrSim_Load(struct _HRSIM_TIM *t, uint8_t tim)
+{
+	if(tim == HRSIM_MASTER)
+	{
+		t->Per = HRTIM1->sMasterRegs.MPER;
+		t->Cmp[0] = HRTIM1->sMasterRegs.MCMP1R;
+		t->Cmp[1] = HRTIM1->sMasterRegs.MCMP2R;
+		t->Cmp[2] = HRTIM1->sMasterRegs.MCMP3R;
+		t->Cmp[3] = HRTIM1->sMasterRegs.MCMP4R;
+	}
+	else
+	{
+		t->Per = TIMX(tim).PERxR;
+		t->Cmp[0] = TIMX(tim).CMP1xR;
+		t->Cmp[1] = TIMX(tim).CMP2xR;
+		t->Cmp[2] = TIMX(tim).CMP3xR;
+		t->Cmp[3] = TIMX(tim).CMP4xR;
+	}
+}
+
+// Reset sources of a timer that fired in this tick
+static uint8_t HrSim_ResetHit(const struct _HRSIM *s, uint8_t tim)
+{
+	const struct _HRSIM_TIM *m = &s->Tim[HRSIM_MASTER];
+	const struct _HRSIM_TIM *t = &s->Tim[tim];
+	uint32_t rst = TIMX(tim).RSTxR;
+	uint8_t k;
+
+	if((rst & HRTIM_RSTR_MSTPER) && (m->Ev & HRTIM_SET1R_PER))
+		return 1;
+	for(k = 0; k < 4; k++)
+		if((rst & RstMstCmp[k]) && (m->Ev & CmpEv[k]))
+			return 1;
+	if((rst & HRTIM_RSTR_CMP2) && (t->Ev & HRTIM_SET1R_CMP2))
+		return 1;
+	if((rst & HRTIM_RSTR_CMP4) && (t->Ev & HRTIM_SET1R_CMP4))
+		return 1;
+	return 0;
+}
+
+static void HrSim_Timer(struct _HRSIM *s, uint8_t tim, uint32_t cr2)
+{
+	struct _HRSIM_TIM *t = &s->Tim[tim];
+	uint32_t cr = HrSim_Cr(tim);
+	uint32_t preen = (tim == HRSIM_MASTER) ? HRTIM_MCR_PREEN : HRTIM_TIMCR_PREEN;
+	uint32_t repu = (tim == HRSIM_MASTER) ? HRTIM_MCR_MREPU : HRTIM_TIMCR_TREPU;
+	uint32_t rstu = (tim == HRSIM_MASTER) ? 0 : HRTIM_TIMCR_TRSTU;
+	uint8_t reset = 0;
+	uint8_t k;
+
+	t->Ev = 0;
+	t->Upd = 0;
+	if(!(cr & preen))
+		HrSim_Load(t, tim);
+
+	if(cr2 & TimRst[tim])
+		reset = 1;
+	else if((HRTIM1->sMasterRegs.MCR & TimCen[tim]) && t->Per &&
+		(s->Time & ((1UL << (cr & HRTIM_TIMCR_CK_PSC)) - 1)) == 0)
+	{
+		t->Cnt++;
+		if(t->Cnt >= t->Per)
+		{
+			t->Cnt = 0;
+			t->Ev |= HRTIM_SET1R_PER;
+			if(cr & (repu | rstu))
+				t->Upd = 1;
+		}
+		for(k = 0; k < 4; k++)
+			if(t->Cmp[k] == t->Cnt && t->Cmp[k] < t->Per)
+				t->Ev |= CmpEv[k];
+	}
+	if(tim != HRSIM_MASTER && (HRTIM1->sMasterRegs.MCR & TimCen[tim]) && HrSim_ResetHit(s, tim))
+		reset = 1;
+
+	// Update requests from software, the master and Timer A
+	if(cr2 & TimSwu[tim])
+		t->Upd = 1;
+	if(tim != HRSIM_MASTER && (cr & HRTIM_TIMCR_MSTU) && s->Tim[HRSIM_MASTER].Upd)
+		t->Upd = 1;
+	if(tim == HRSIM_TIMB && (cr & HRTIM_TIMCR_TAU) && s->Tim[HRSIM_TIMA].Upd)
+		t->Upd = 1;
+	if(tim != HRSIM_MASTER && t->Upd && (TIMX(tim).RSTxR & HRTIM_RSTR_UPDATE))
+		reset = 1;
+
+	if(reset)
+	{
+		t->Cnt = 0;
+		t->Ev |= HRTIM_SET1R_RESYNC;
+		if(cr & rstu)
+			t->Upd = 1;
+	}
+	if(t->Upd && (cr & preen))
+		HrSim_Load(t, tim);
+}
+
+// Pin level of an output for its crossbar state
+static uint8_t HrSim_Pin(const struct _HRSIM_OUT *o, uint8_t out, uint32_t oenr)
+{
+	uint32_t outr = TIMX(OutMap[out].Tim).OUTxR;
+	uint8_t pol = (outr & (OutMap[out].Second ? HRTIM_OUTR_POL2 : HRTIM_OUTR_POL1)) ? 1 : 0;
+	uint8_t idle = (outr & (OutMap[out].Second ? HRTIM_OUTR_IDLES2 : HRTIM_OUTR_IDLES1)) ? 1 : 0;
+
+	if(oenr & OutMap[out].Enable)
+		return o->Active ^ pol;
+	return idle ^ pol;
+}
+
+// Base ticks of a dead-time generator step, fHRTIM x 8 at DTPRSC 0
+static uint32_t HrSim_DtStep(uint8_t tim)
+{
+	return 4UL << ((TIMX(tim).DTxR & HRTIM_DTR_DTPRSC) >> HRTIM_DTR_DTPRSC_Pos);
+}
+
+static void HrSim_Output(struct _HRSIM *s, uint8_t out, uint32_t oenr)
+{
+	struct _HRSIM_OUT *o = &s->Out[out];
+	struct _HRSIM_TIM *t = &s->Tim[OutMap[out].Tim];
+	const struct _HRSIM_TIM *m = &s->Tim[HRSIM_MASTER];
+	HRTIM_Timerx_TypeDef *r = &TIMX(OutMap[out].Tim);
+	uint32_t set = OutMap[out].Second ? r->SETx2R : r->SETx1R;
+	uint32_t rst = OutMap[out].Second ? r->RSTx2R : r->RSTx1R;
+	uint32_t ev = t->Ev;
+	uint32_t dtr = r->DTxR & HRTIM_DTR_DTR;
+	uint32_t dtf = (r->DTxR & HRTIM_DTR_DTF) >> HRTIM_DTR_DTF_Pos;
+	uint8_t k, level;
+
+	if(m->Ev & HRTIM_SET1R_PER)
+		ev |= HRTIM_SET1R_MSTPER;
+	for(k = 0; k < 4; k++)
+		if(m->Ev & CmpEv[k])
+			ev |= MstCmpEv[k];
+
+	if(!(r->OUTxR & HRTIM_OUTR_DTEN))
+	{
+		if(rst & ev)
+			o->Active = 0;
+		else if(set & ev)
+			o->Active = 1;
+	}
+	else if(!OutMap[out].Second)
+	{
+		// Output 1 runs first and moves the generator input, both follow it
+		if((rst & ev) && t->Dt)
+		{
+			t->Dt = 0;
+			t->DtTime = s->Time;
+		}
+		else if(!(rst & ev) && (set & ev) && !t->Dt)
+		{
+			t->Dt = 1;
+			t->DtTime = s->Time;
+		}
+		o->Active = t->Dt && s->Time - t->DtTime >= dtr * HrSim_DtStep(OutMap[out].Tim);
+	}
+	else
+		o->Active = !t->Dt && s->Time - t->DtTime >= dtf * HrSim_DtStep(OutMap[out].Tim);
+
+	level = HrSim_Pin(o, out, oenr);
+	if(level == o->Level)
+		return;
+	o->Level = level;
+	if(o->Num < HRSIM_EDGES)
+	{
+		o->Edge[o->Num].Time = s->Time;
+		o->Edge[o->Num].Level = level;
+		o->Num++;
+	}
+	else
+		o->Lost++;
+}
+
+/** ===================================================================
+**     Function Name : void HrSim_Start(struct _HRSIM *s)
+**     Description : Start emulating from the registers as they are:
+**       counters from CNTR, active values from the period and compare
+**       registers, all outputs inactive, no edges recorded
+**     Parameters  : s - emulator
+**     Returns     :
+** ===================================================================*/
+void HrSim_Start(struct _HRSIM *s)
+{
+	uint32_t oenr = Host_HrtimOutputs();
+	uint8_t i;
+
+	memset(s, 0, sizeof(*s));
+	for(i = 0; i < HRSIM_TIM_NUM; i++)
+	{
+		HrSim_Load(&s->Tim[i], i);
+		s->Tim[i].Cnt = (i == HRSIM_MASTER) ? HRTIM1->sMasterRegs.MCNTR : TIMX(i).CNTxR;
+	}
+	for(i = 0; i < HRSIM_OUT_NUM; i++)
+	{
+		s->Out[i].Level = HrSim_Pin(&s->Out[i], i, oenr);
+		s->Out[i].Init = s->Out[i].Level;
+	}
+}
+
+/** ===================================================================
+**     Function Name : void HrSim_Run(struct _HRSIM *s, uint32_t ticks)
+**     Description : Run the timers and outputs for a number of base
+**       ticks. Register writes between calls take effect on the next
+**       tick, as a CPU write would. Ticks on which no counter moves are
+**       skipped.
+**     Parameters  : s - emulator
+**                   ticks - base ticks, fHRTIM x 32
+**     Returns     :
+** ===================================================================*/
+void HrSim_Run(struct _HRSIM *s, uint32_t ticks)
+{
+	uint32_t cr2, oenr, psc, idle = HRTIM_TIMCR_CK_PSC;
+	uint8_t i;
+
+	for(i = 0; i < HRSIM_TIM_NUM; i++)
+	{
+		psc = HrSim_Cr(i) & HRTIM_TIMCR_CK_PSC;
+		if(psc < idle)
+			idle = psc;
+		// Dead-time edges fall on generator steps, which may be finer
+		if(i != HRSIM_MASTER && (TIMX(i).OUTxR & HRTIM_OUTR_DTEN))
+		{
+			psc = 2 + ((TIMX(i).DTxR & HRTIM_DTR_DTPRSC) >> HRTIM_DTR_DTPRSC_Pos);
+			if(psc < idle)
+				idle = psc;
+		}
+	}
+	idle = (1UL << idle) - 1;//Base ticks between counts of the fastest timer or dead-time steps
+	while(ticks--)
+	{
+		s->Time++;
+		cr2 = HRTIM1->sCommonRegs.CR2;
+		if(cr2 == 0 && (s->Time & idle) != 0)
+			continue;
+		HRTIM1->sCommonRegs.CR2 = 0;//Request bits clear themselves
+		oenr = Host_HrtimOutputs();
+		for(i = 0; i < HRSIM_TIM_NUM; i++)
+			HrSim_Timer(s, i, cr2);
+		for(i = 0; i < HRSIM_OUT_NUM; i++)
+			HrSim_Output(s, i, oenr);
+	}
+}
+
+/** ===================================================================
+**     Function Name : uint32_t HrSim_Period(uint8_t tim)
+**     Description : Period programmed in a timer, in base ticks
+**     Parameters  : tim - HRSIM_xxx timer
+**     Returns     : PER scaled by the prescaler
+** ===================================================================*/
+uint32_t HrSim_Period(uint8_t tim)
+{
+	uint32_t per = (tim == HRSIM_MASTER) ? HRTIM1->sMasterRegs.MPER : TIMX(tim).PERxR;
+
+	return per << (HrSim_Cr(tim) & HRTIM_TIMCR_CK_PSC);
+}
+
+/** ===================================================================
+**     Function Name : uint8_t HrSim_Level(const struct _HRSIM *s, uint8_t out, uint32_t t)
+**     Description : Recorded pin level at a time
+**     Parameters  : s - emulator
+**                   out - HRSIM_Txx output
+**                   t - base tick
+**     Returns     : 0 or 1
+** ===================================================================*/
+uint8_t HrSim_Level(const struct _HRSIM *s, uint8_t out, uint32_t t)
+{
+	const struct _HRSIM_OUT *o = &s->Out[out];
+	uint8_t level = o->Init;
+	uint16_t i;
+
+	for(i = 0; i < o->Num && o->Edge[i].Time <= t; i++)
+		level = o->Edge[i].Level;
+	return level;
+}
+
+/** ===================================================================
+**     Function Name : uint32_t HrSim_Edge(...)
+**     Description : First edge to a level at or after a time
+**     Parameters  : s - emulator
+**                   out - HRSIM_Txx output
+**                   level - 1 rising, 0 falling
+**                   t - base tick to search from
+**     Returns     : base tick of the edge, HRSIM_NONE if there is none
+** ===================================================================*/
+uint32_t HrSim_Edge(const struct _HRSIM *s, uint8_t out, uint8_t level, uint32_t t)
+{
+	const struct _HRSIM_OUT *o = &s->Out[out];
+	uint16_t i;
+
+	for(i = 0; i < o->Num; i++)
+		if(o->Edge[i].Time >= t && o->Edge[i].Level == level)
+			return o->Edge[i].Time;
+	return HRSIM_NONE;
+}
+
+// Next edge of an output after t, HRSIM_NONE if there is none
+static uint32_t HrSim_Next(const struct _HRSIM *s, uint8_t out, uint32_t t)
+{
+	const struct _HRSIM_OUT *o = &s->Out[out];
+	uint16_t i;
+
+	for(i = 0; i < o->Num; i++)
+		if(o->Edge[i].Time > t)
+			return o->Edge[i].Time;
+	return HRSIM_NONE;
+}
+
+/** ===================================================================
+**     Function Name : uint32_t HrSim_Overlap(...)
+**     Description : Time two outputs are both high within [t0, t1)
+**     Parameters  : s - emulator
+**                   a, b - HRSIM_Txx outputs, the same for high time
+**                   t0, t1 - window, base ticks
+**     Returns     : base ticks
+** ===================================================================*/
+uint32_t HrSim_Overlap(const struct _HRSIM *s, uint8_t a, uint8_t b, uint32_t t0, uint32_t t1)
+{
+	uint32_t t = t0, n, nb, sum = 0;
+
+	while(t < t1)
+	{
+		n = HrSim_Next(s, a, t);
+		nb = HrSim_Next(s, b, t);
+		if(nb < n)
+			n = nb;
+		if(n > t1)
+			n = t1;
+		if(HrSim_Level(s, a, t) && HrSim_Level(s, b, t))
+			sum += n - t;
+		t = n;
+	}
+	return sum;
+}
+
+/** ===================================================================
+**     Function Name : uint32_t HrSim_High(...)
+**     Description : Time an output is high within [t0, t1)
+**     Parameters  : s - emulator
+**                   out - HRSIM_Txx output
+**                   t0, t1 - window, base ticks
+**     Returns     : base ticks
+** ===================================================================*/
+uint32_t HrSim_High(const struct _HRSIM *s, uint8_t out, uint32_t t0, uint32_t t1)
+{
+	return HrSim_Overlap(s, out, out, t0, t1);
+}
@@ -0,0 +1,76 @@
+/**
+  ******************************************************************************
+  * @file    hrsim.h
+  * @brief   HRTIM1 Master, Timer A and Timer B emulator for waveform checks.
+  *
+  *          Runs the counters, compare units, reset triggers, preload, the
+  *          output set/reset crossbar and dead-time insertion from the host
+  *          register blocks and records the TA1/TA2/TB1/TB2 pin edges.
+  ******************************************************************************
+  */
+#ifndef __HRSIM_H
+#define __HRSIM_H
+
+#include "main.h"
+
+/***************************** Timers *****************/
+#define HRSIM_MASTER	0
+#define HRSIM_TIMA		1
+#define HRSIM_TIMB		2
+#define HRSIM_TIM_NUM	3
+
+/***************************** Outputs *****************/
+#define HRSIM_TA1		0
+#define HRSIM_TA2		1
+#define HRSIM_TB1		2
+#define HRSIM_TB2		3
+#define HRSIM_OUT_NUM	4
+
+#define HRSIM_EDGES		64			// Edges kept per output
+#define HRSIM_NONE		0xFFFFFFFF	// No such edge
+
+// Time is in HRTIM base ticks, fHRTIM x 32: one count at MUL32, two at MUL16
+
+struct _HRSIM_EDGE
+{
+	uint32_t	Time;//Base tick of the change
+	uint8_t		Level;//Pin level from then on
+};
+
+struct _HRSIM_OUT
+{
+	uint8_t		Active;//Crossbar state, 1 = active
+	uint8_t		Level;//Pin level, after polarity and idle state
+	uint8_t		Init;//Pin level at HrSim_Start()
+	uint16_t	Num;//Edges recorded
+	uint16_t	Lost;//Edges past HRSIM_EDGES
+	struct _HRSIM_EDGE	Edge[HRSIM_EDGES];
+};
+
+struct _HRSIM_TIM
+{
+	uint32_t	Cnt;//Counter
+	uint32_t	Per;//Active period
+	uint32_t	Cmp[4];//Active compare 1..4
+	uint32_t	Ev;//Events of this tick, HRTIM_SET1R_xxx layout
+	uint8_t		Upd;//Update event this tick
+	uint8_t		Dt;//Dead-time generator input, the crossbar state of output 1
+	uint32_t	DtTime;//Base tick it last changed
+};
+
+struct _HRSIM
+{
+	uint32_t	Time;//Base ticks since HrSim_Start()
+	struct _HRSIM_TIM	Tim[HRSIM_TIM_NUM];
+	struct _HRSIM_OUT	Out[HRSIM_OUT_NUM];
+};
+
+void HrSim_Start(struct _HRSIM *s);
+void HrSim_Run(struct _HRSIM *s, uint32_t ticks);
+uint32_t HrSim_Period(uint8_t tim);
+uint8_t HrSim_Level(const struct _HRSIM *s, uint8_t out, uint32_t t);
+uint32_t HrSim_Edge(const struct _HRSIM *s, uint8_t out, uint8_t level, uint32_t t);
+uint32_t HrSim_High(const struct _HRSIM *s, uint8_t out, uint32_t t0, uint32_t t1);
+uint32_t HrSim_Overlap(const struct _HRSIM *s, uint8_t a, uint8_t b, uint32_t t0, uint32_t t1);
+
+#endif
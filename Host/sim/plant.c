@@ -0,0 +1,263 @@
+/**
+  ******************************************************************************
+  * @file    plant.c
+  * @brief   Four-switch buck-boost power stage for closed-loop host tests.
+  *
+  *          Timer A drives the buck leg and Timer B the boost leg, read the
+  *          way BUCKVLoopCtlPID() writes them: each high-side switch is on
+  *          from the period start to CMP1xR. The averaged model applies
+  *          the legs as their duty, the switching model turns them on and
+  *          off within the period and shows the ripple. The period is the
+  *          PERxR and prescaler in the registers, integrated in PLANT_STEPS
+  *          steps, or PLANT_AVG_STEPS for the averaged model. With TA1/TB1 disabled or Timer A stopped all
+  *          switches are off and the inductor discharges through the body
+  *          diodes into the output. The same holds in a period the
+  *          HRTIM burst mode controller idles TA1, as the firmware sets it
+  *          up: single shot or continuous, clocked by Timer A.
+  *
+  *          The sense inputs show the state at CMP3 of Timer A, where
+  *          HRTIM ADC trigger 1 fires when the firmware routes it there;
+  *          the ADC stub converts on that event if adc.c selects it.
+  ******************************************************************************
+  */
+#include "plant.h"
+#include "host.h"
+#include "string.h"
+
+/** ===================================================================
+**     Function Name : void Plant_Init(struct _PLANT *p, uint8_t model)
+**     Description : Board defaults, output discharged. Vin 24V, 22uH,
+**       470uF, 12R load; 2048 codes = 12V on Vout, 310 codes per amp
+**       so IOUT_OCP_VAL is 5A.
+**     Parameters  : p - plant
+**                   model - PLANT_xxx
+**     Returns     :
+** ===================================================================*/
+void Plant_Init(struct _PLANT *p, uint8_t model)
+{
+	memset(p, 0, sizeof(*p));
+	p->Cfg.Model = model;
+	p->Cfg.L = 22e-6;
+	p->Cfg.RL = 0.03;
+	p->Cfg.C = 470e-6;
+	p->Cfg.Esr = 0.01;
+	p->Cfg.Vin = 24.0;
+	p->Cfg.Rload = 12.0;
+	p->Cfg.Iload = 0.0;
+	p->Cfg.VinGain = 4096.0 / 60.0;
+	p->Cfg.VoutGain = 2048.0 / 12.0;
+	p->Cfg.IGain = 310.0;
+}
+
+// Output voltage for a capacitor voltage and the current the boost leg delivers
+static double Plant_Vout(const struct _PLANT *p, double vc, double idel)
+{
+	double g = (p->Cfg.Rload > 0) ? 1.0 / p->Cfg.Rload : 0.0;
+
+	return (vc + p->Cfg.Esr * (idel - p->Cfg.Iload)) / (1.0 + p->Cfg.Esr * g);
+}
+
+static uint16_t Plant_Code(double v)
+{
+	if(v < 0)
+		return 0;
+	if(v > 4095)
+		return 4095;
+	return (uint16_t)(v + 0.5);
+}
+
+/** ===================================================================
+**     Function Name : uint16_t Plant_VoutCode(const struct _PLANT *p, double v)
+**     Description : ADC code of an output voltage
+**     Parameters  : p - plant
+**                   v - volts
+**     Returns     : 12-bit code
+** ===================================================================*/
+uint16_t Plant_VoutCode(const struct _PLANT *p, double v)
+{
+	return Plant_Code(v * p->Cfg.VoutGain);
+}
+
+// Present state on the sense inputs, and ADC trigger 1 if Timer A CMP3 drives it
+static void Plant_Sample(const struct _PLANT *p)
+{
+	Host_AdcSet(Plant_Code(p->Cfg.Vin * p->Cfg.VinGain),
+		Plant_Code(2048 + p->Iin * p->Cfg.IGain),
+		Plant_Code(p->Vout * p->Cfg.VoutGain),
+		Plant_Code(2048 + p->Iout * p->Cfg.IGain));
+	if(HRTIM1->sCommonRegs.ADC1R & HRTIM_ADC1R_AD1TAC3)
+		Host_AdcTrigger(ADC_EXTERNALTRIG_HRTIM_TRG1);
+}
+
+// Track the response started by Plant_Watch()
+static void Plant_Track(struct _PLANT *p)
+{
+	if(p->Vout > p->Max)
+		p->Max = p->Vout;
+	if(p->Vout < p->Min)
+		p->Min = p->Vout;
+	if(p->Vout > p->Target + p->Band || p->Vout < p->Target - p->Band)
+		p->Outside = p->Time;
+}
+
+// Burst mode controller clocked by the Timer A roll-over: outputs idle
+// from the trigger to BMCMPR, burst over at BMPER. Returns 1 while idle.
+static uint8_t Plant_Burst(struct _PLANT *p)
+{
+	HRTIM_Common_TypeDef *c = &HRTIM1->sCommonRegs;
+	uint8_t idle;
+
+	if(!(c->BMCR & HRTIM_BMCR_BME))
+	{
+		c->BMCR &= ~HRTIM_BMCR_BMSTAT;
+		c->BMTRGR &= ~HRTIM_BMTRGR_SW;
+		return 0;
+	}
+	if((c->BMTRGR & HRTIM_BMTRGR_SW) || (c->BMCR & HRTIM_BMCR_BMOM))
+	{
+		c->BMTRGR &= ~HRTIM_BMTRGR_SW;//Self-clearing
+		if(!(c->BMCR & HRTIM_BMCR_BMSTAT))
+		{
+			c->BMCR |= HRTIM_BMCR_BMSTAT;
+			p->BurstCnt = 0;
+		}
+	}
+	if(!(c->BMCR & HRTIM_BMCR_BMSTAT))
+		return 0;
+	idle = p->BurstCnt <= c->BMCMPR;
+	if(p->BurstCnt++ >= c->BMPER)
+	{
+		p->BurstCnt = 0;
+		if(!(c->BMCR & HRTIM_BMCR_BMOM))
+			c->BMCR &= ~HRTIM_BMCR_BMSTAT;
+	}
+	return idle;
+}
+
+/** ===================================================================
+**     Function Name : void Plant_Period(struct _PLANT *p)
+**     Description : Run one PWM period on the duty in the HRTIM
+**       registers and sample the ADC at the Timer A CMP3 point
+**     Parameters  : p - plant
+**     Returns     :
+** ===================================================================*/
+void Plant_Period(struct _PLANT *p)
+{
+	HRTIM_Timerx_TypeDef *ta = &HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A];
+	HRTIM_Timerx_TypeDef *tb = &HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_B];
+	uint32_t per = ta->PERxR ? ta->PERxR : 1;
+	uint32_t out = Host_HrtimOutputs();
+	uint32_t steps = (p->Cfg.Model == PLANT_SWITCHING) ? PLANT_STEPS : PLANT_AVG_STEPS;
+	double fhrck = (double)((uint64_t)SystemCoreClock << 5 >> (ta->TIMxCR & HRTIM_TIMCR_CK_PSC));
+	double dt = per / fhrck / steps;
+	double da, db, f, qa, qb, va, vb, il;
+	uint32_t k, sample;
+	uint8_t on;
+
+	on = (HRTIM1->sMasterRegs.MCR & HRTIM_MCR_TACEN) &&
+		(out & (HRTIM_OUTPUT_TA1 | HRTIM_OUTPUT_TB1)) == (HRTIM_OUTPUT_TA1 | HRTIM_OUTPUT_TB1);
+	if(Plant_Burst(p) && (ta->OUTxR & HRTIM_OUTR_IDLM1))
+		on = 0;
+	if(on)
+		p->Switching++;
+	da = (double)ta->CMP1xR / per;
+	db = (double)tb->CMP1xR / (tb->PERxR ? tb->PERxR : 1);
+	if(da > 1)
+		da = 1;
+	if(db > 1)
+		db = 1;
+	p->DutyA = on ? da : 0;
+	p->DutyB = on ? db : 0;
+	sample = (uint32_t)((uint64_t)ta->CMP3xR * steps / per);
+	if(sample >= steps)
+		sample = steps - 1;
+
+	for(k = 0; k < steps; k++)
+	{
+		if(!on)
+		{
+			// Body diodes: low side of the buck leg, high side of the boost leg
+			qa = 0;
+			qb = (p->IL > 0) ? 1 : 0;
+		}
+		else if(p->Cfg.Model == PLANT_SWITCHING)
+		{
+			f = (k + 0.5) / steps;
+			qa = (f < da) ? 1 : 0;
+			qb = (f < db) ? 1 : 0;
+		}
+		else
+		{
+			qa = da;
+			qb = db;
+		}
+
+		va = qa * p->Cfg.Vin;
+		vb = qb * p->Vout;
+		il = p->IL + (va - vb - p->IL * p->Cfg.RL) * dt / p->Cfg.L;
+		if(!on && ((p->IL > 0 && il < 0) || (p->IL <= 0 && il > 0)))
+			il = 0;//Diodes block the reverse current
+		p->IL = il;
+		p->Vout = Plant_Vout(p, p->Vc, qb * p->IL);
+		p->Iout = (p->Cfg.Rload > 0 ? p->Vout / p->Cfg.Rload : 0) + p->Cfg.Iload;
+		p->Vc += (qb * p->IL - p->Iout) * dt / p->Cfg.C;
+		p->Iin = qa * p->IL;
+		p->Time += dt;
+		Plant_Track(p);
+		if(k == sample)
+			Plant_Sample(p);
+	}
+	p->Periods++;
+}
+
+/** ===================================================================
+**     Function Name : void Plant_Run(struct _PLANT *p, double t, void (*isr)(void))
+**     Description : Run whole PWM periods for t seconds, calling the
+**       control ISR at the end of each, as the Timer A repetition
+**       interrupt does
+**     Parameters  : p - plant
+**                   t - seconds
+**                   isr - control ISR body, may be 0
+**     Returns     :
+** ===================================================================*/
+void Plant_Run(struct _PLANT *p, double t, void (*isr)(void))
+{
+	double end = p->Time + t;
+
+	while(p->Time < end)
+	{
+		Plant_Period(p);
+		if(isr)
+			isr();
+	}
+}
+
+/** ===================================================================
+**     Function Name : void Plant_Watch(struct _PLANT *p, double target, double band)
+**     Description : Start measuring a step response from now
+**     Parameters  : p - plant
+**                   target - expected final Vout, V
+**                   band - settling band around target, V
+**     Returns     :
+** ===================================================================*/
+void Plant_Watch(struct _PLANT *p, double target, double band)
+{
+	p->Target = target;
+	p->Band = band;
+	p->Start = p->Time;
+	p->Outside = p->Time;
+	p->Max = p->Vout;
+	p->Min = p->Vout;
+}
+
+/** ===================================================================
+**     Function Name : double Plant_Settle(const struct _PLANT *p)
+**     Description : Settling time of the watched response: time from
+**       Plant_Watch() to the last sample outside the band
+**     Parameters  : p - plant
+**     Returns     : seconds
+** ===================================================================*/
+double Plant_Settle(const struct _PLANT *p)
+{
+	return p->Outside - p->Start;
+}
@@ -0,0 +1,69 @@
+/**
+  ******************************************************************************
+  * @file    plant.h
+  * @brief   Four-switch buck-boost power stage for closed-loop host tests.
+  *
+  *          The plant reads the gate drive from the HRTIM registers the
+  *          firmware writes and answers with ADC codes in the ADC1 DMA
+  *          buffer, so the control code runs against it unchanged.
+  ******************************************************************************
+  */
+#ifndef __PLANT_H
+#define __PLANT_H
+
+#include "main.h"
+
+/***************************** Models *****************/
+#define PLANT_AVERAGED	0	// Switch legs as their duty over the period
+#define PLANT_SWITCHING	1	// Switch legs on/off within the period
+
+#define PLANT_STEPS		64	// Integration steps per PWM period, switching model
+#define PLANT_AVG_STEPS	4	// Integration steps per PWM period, averaged model
+
+// Power stage and sensing. Buck leg on Timer A, boost leg on Timer B.
+struct _PLANT_CFG
+{
+	uint8_t		Model;//PLANT_xxx
+	double		L;//Inductance, H
+	double		RL;//Inductor and switch resistance, ohm
+	double		C;//Output capacitance, F
+	double		Esr;//Output capacitor ESR, ohm
+	double		Vin;//Input source, V
+	double		Rload;//Resistive load, ohm, 0 = none
+	double		Iload;//Constant-current load, A
+	double		VinGain;//ADC codes per volt, channel 0
+	double		VoutGain;//ADC codes per volt, channel 2
+	double		IGain;//ADC codes per amp, channels 1 and 3, 2048 = 0A
+};
+
+struct _PLANT
+{
+	struct _PLANT_CFG	Cfg;
+	double		IL;//Inductor current, A
+	double		Vc;//Capacitor voltage, V
+	double		Vout;//Output voltage, V
+	double		Iout;//Load current, A
+	double		Iin;//Input current, A
+	double		DutyA;//Buck high-side on fraction of the last period
+	double		DutyB;//Boost high-side on fraction of the last period
+	double		Time;//Simulated time, s
+	uint32_t	Periods;//PWM periods run
+	uint32_t	Switching;//Of those, periods with the legs switching
+	uint32_t	BurstCnt;//HRTIM burst mode counter
+	// Response to the last Plant_Watch()
+	double		Target;//Expected Vout, V
+	double		Band;//Settled when within Target +- Band, V
+	double		Start;//Time of Plant_Watch(), s
+	double		Outside;//Last time outside the band, s
+	double		Max;//Highest Vout since Plant_Watch(), V
+	double		Min;//Lowest Vout since Plant_Watch(), V
+};
+
+void Plant_Init(struct _PLANT *p, uint8_t model);
+void Plant_Period(struct _PLANT *p);
+void Plant_Run(struct _PLANT *p, double t, void (*isr)(void));
+void Plant_Watch(struct _PLANT *p, double target, double band);
+double Plant_Settle(const struct _PLANT *p);
+uint16_t Plant_VoutCode(const struct _PLANT *p, double v);
+
+#endif
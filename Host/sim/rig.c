@@ -0,0 +1,81 @@
+/**
+  ******************************************************************************
+  * @file    rig.c
+  * @brief   The firmware on the simulated power stage.
+  *
+  *          The control ISR is Control_Period(), which runs the voltage
+  *          loop in the host build (VLOOP_BUCKBOOST), as the firmware does.
+  *          The loop is VLoopHook, BUCKVLoopCtlPID() unless bench_transient
+  *          swaps it.
+  ******************************************************************************
+  */
+#include "rig.h"
+#include "host.h"
+#include "hrtim.h"
+#include "function.h"
+#include "CtlLoop.h"
+#include "string.h"
+
+extern SState_M STState;
+
+struct _RIG Rig;
+
+static void Rig_Isr(void)
+{
+	Control_Period();
+	if(Rig.Probe)
+		Rig.Probe();
+}
+
+/** ===================================================================
+**     Function Name : void Rig_Start(uint8_t model)
+**     Description : Power up as main() does, reset the control state
+**       and soft-start to VOUT_REF_SET, 700ms
+**     Parameters  : model - PLANT_xxx
+**     Returns     :
+** ===================================================================*/
+void Rig_Start(uint8_t model)
+{
+	Host_Reset();
+	MX_HRTIM1_Init();
+	MX_ADC1_Init();
+	ADC1_StartScan(ADC1_RESULT);
+	HAL_HRTIM_WaveformOutputStart(&hhrtim1, HRTIM_OUTPUT_TA1 | HRTIM_OUTPUT_TA2 | HRTIM_OUTPUT_TB1 | HRTIM_OUTPUT_TB2);
+	HAL_HRTIM_WaveformCounterStart(&hhrtim1, HRTIM_TIMERID_TIMER_A | HRTIM_TIMERID_TIMER_B);
+
+	memset(&DF, 0, sizeof(DF));
+	memset(&CtrValue, 0, sizeof(CtrValue));
+	CtrValue.BUCKMaxDuty = MAX_BUCK_DUTY;
+	VErr0 = VErr1 = VErr2 = 0;
+	u0 = u1 = u2 = 0;
+	STState = SSInit;
+	Rig.Ms = 0;
+
+	Plant_Init(&Rig.Plant, model);
+	Rig_Advance(700);
+}
+
+/** ===================================================================
+**     Function Name : void Rig_Advance(uint32_t ms)
+**     Description : Run the stage, the control ISR and the 1ms/10ms
+**       tasks
+**     Parameters  : ms - milliseconds
+**     Returns     :
+** ===================================================================*/
+void Rig_Advance(uint32_t ms)
+{
+	while(ms--)
+	{
+		Plant_Run(&Rig.Plant, 1e-3, Rig_Isr);
+		Host_AdvanceMs(1);
+		Protect_Task();
+		if(++Rig.Ms % 10 == 0)
+			SoftStart_Task();
+	}
+}
+
+// Vout the loop regulates to at Voref = VOUT_REF_SET, through the Vout calibration
+double Rig_Target(void)
+{
+	return (double)((VOUT_REF_SET - CAL_VOUT_B) << 12) / CAL_VOUT_K / Rig.Plant.Cfg.VoutGain;
+}
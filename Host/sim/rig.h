@@ -0,0 +1,29 @@
+/**
+  ******************************************************************************
+  * @file    rig.h
+  * @brief   The firmware on the simulated power stage.
+  *
+  *          Boots the HRTIM, ADC and control state as main() does, then
+  *          runs the control ISR once per PWM period against the plant and
+  *          Protect_Task() and SoftStart_Task() at their scheduler rates.
+  ******************************************************************************
+  */
+#ifndef __RIG_H
+#define __RIG_H
+
+#include "plant.h"
+
+struct _RIG
+{
+	struct _PLANT	Plant;
+	uint32_t	Ms;//Milliseconds run since Rig_Start()
+	void		(*Probe)(void);//Called after each control ISR, may be 0
+};
+
+extern struct _RIG Rig;
+
+void Rig_Start(uint8_t model);
+void Rig_Advance(uint32_t ms);
+double Rig_Target(void);
+
+#endif
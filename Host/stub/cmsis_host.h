@@ -0,0 +1,88 @@
+/**
+  ******************************************************************************
+  * @file    cmsis_host.h
+  * @brief   Host replacement for cmsis_gcc.h.
+  *
+  *          Defines the CMSIS compiler macros and the core intrinsics the
+  *          firmware uses as plain C for a Linux build. PRIMASK is a
+  *          variable; __WFI() calls Host_Wfi(), where a test advances
+  *          simulated time. Sets the cmsis_gcc.h include guard so the
+  *          Arm inline assembly is never seen.
+  ******************************************************************************
+  */
+#ifndef __CMSIS_HOST_H
+#define __CMSIS_HOST_H
+#define __CMSIS_GCC_H
+
+#include <stdint.h>
+
+#define __ASM					__asm
+#define __INLINE				inline
+#define __STATIC_INLINE			static inline
+#define __STATIC_FORCEINLINE	__attribute__((always_inline)) static inline
+#define __NO_RETURN				__attribute__((__noreturn__))
+#define __USED					__attribute__((used))
+#define __WEAK					__attribute__((weak))
+#define __PACKED				__attribute__((packed, aligned(1)))
+#define __PACKED_STRUCT			struct __attribute__((packed, aligned(1)))
+#define __PACKED_UNION			union __attribute__((packed, aligned(1)))
+#define __ALIGNED(x)			__attribute__((aligned(x)))
+#define __RESTRICT				__restrict
+#define __COMPILER_BARRIER()	__asm volatile("":::"memory")
+#define __UNALIGNED_UINT16_READ(addr)			(*(const uint16_t *)(const void *)(addr))
+#define __UNALIGNED_UINT16_WRITE(addr, val)		((void)(*(uint16_t *)(void *)(addr) = (val)))
+#define __UNALIGNED_UINT32_READ(addr)			(*(const uint32_t *)(const void *)(addr))
+#define __UNALIGNED_UINT32_WRITE(addr, val)		((void)(*(uint32_t *)(void *)(addr) = (val)))
+
+extern volatile uint32_t HostPrimask;//1 while interrupts are masked
+extern uint32_t HostMsp;//Value returned by __get_MSP()
+void Host_Wfi(void);
+
+#define __NOP()		((void)0)
+#define __WFI()		Host_Wfi()
+#define __WFE()		Host_Wfi()
+#define __SEV()		((void)0)
+#define __ISB()		__sync_synchronize()
+#define __DSB()		__sync_synchronize()
+#define __DMB()		__sync_synchronize()
+#define __BKPT(value)	((void)0)
+
+static inline void __enable_irq(void)		{ HostPrimask = 0; }
+static inline void __disable_irq(void)		{ HostPrimask = 1; }
+static inline uint32_t __get_PRIMASK(void)	{ return HostPrimask; }
+static inline void __set_PRIMASK(uint32_t v)	{ HostPrimask = v & 1; }
+static inline uint32_t __get_MSP(void)		{ return HostMsp; }
+static inline void __set_MSP(uint32_t v)	{ HostMsp = v; }
+static inline uint32_t __get_BASEPRI(void)	{ return 0; }
+static inline void __set_BASEPRI(uint32_t v)	{ (void)v; }
+static inline uint32_t __get_IPSR(void)		{ return 0; }
+static inline uint32_t __get_CONTROL(void)	{ return 0; }
+static inline uint32_t __get_FPSCR(void)	{ return 0; }
+static inline void __set_FPSCR(uint32_t v)	{ (void)v; }
+
+static inline uint32_t __REV(uint32_t v)	{ return __builtin_bswap32(v); }
+static inline uint32_t __REV16(uint32_t v)	{ return ((v & 0xFF00FF00u) >> 8) | ((v & 0x00FF00FFu) << 8); }
+static inline uint8_t __CLZ(uint32_t v)		{ return v ? (uint8_t)__builtin_clz(v) : 32; }
+static inline uint32_t __RBIT(uint32_t v)
+{
+	uint32_t r = 0;
+	int i;
+
+	for(i = 0; i < 32; i++, v >>= 1)
+		r = (r << 1) | (v & 1);
+	return r;
+}
+static inline int32_t __SSAT(int32_t v, uint32_t bits)
+{
+	int32_t max = (int32_t)((1u << (bits - 1)) - 1);
+
+	return v > max ? max : (v < -max - 1 ? -max - 1 : v);
+}
+static inline uint32_t __USAT(int32_t v, uint32_t bits)
+{
+	uint32_t max = (bits >= 32) ? 0xFFFFFFFFu : (1u << bits) - 1;
+
+	return v < 0 ? 0 : ((uint32_t)v > max ? max : (uint32_t)v);
+}
+
+#endif
@@ -0,0 +1,35 @@
+/**
+  ******************************************************************************
+  * @file    core_cm4.h
+  * @brief   Host wrapper around the CMSIS Cortex-M4 core header.
+  *
+  *          Found before Drivers/CMSIS/Include on the host include path. It
+  *          loads cmsis_host.h in place of cmsis_gcc.h, includes the real
+  *          core header for its register types, then points SCB, NVIC,
+  *          SysTick, DWT and CoreDebug at host memory.
+  ******************************************************************************
+  */
+#ifndef __CORE_CM4_HOST_H
+#define __CORE_CM4_HOST_H
+
+#include "cmsis_host.h"
+#include_next <core_cm4.h>
+
+extern SCB_Type HostSCB;
+extern NVIC_Type HostNVIC;
+extern SysTick_Type HostSysTick;
+extern DWT_Type HostDWT;
+extern CoreDebug_Type HostCoreDebug;
+
+#undef SCB
+#undef NVIC
+#undef SysTick
+#undef DWT
+#undef CoreDebug
+#define SCB			(&HostSCB)
+#define NVIC		(&HostNVIC)
+#define SysTick		(&HostSysTick)
+#define DWT			(&HostDWT)
+#define CoreDebug	(&HostCoreDebug)
+
+#endif
@@ -0,0 +1,561 @@
+/**
+  ******************************************************************************
+  * @file    hal_stub.c
+  * @brief   HAL stand-ins for the host build.
+  *
+  *          HRTIM and GPIO use the real HAL drivers on the host register
+  *          blocks. The drivers that wait on hardware are replaced here:
+  *          the tick, NVIC, DMA, ADC, I2C and UART. A DMA or interrupt
+  *          transfer is started and left pending; Host_I2cComplete(),
+  *          Host_UartTxComplete() and Host_UartRx() finish it and run the
+  *          firmware callbacks, the way the DMA and USART interrupts would.
+  *          The ADC converts the regular sequence adc.c configures, on the
+  *          trigger it selects, into the DMA buffer in the DMA mode it sets.
+  *          Also holds the handles of the CubeMX files that are not built
+  *          on the host, and Error_Handler().
+  ******************************************************************************
+  */
+#include "host.h"
+#include "adc.h"
+#include "usart.h"
+#include "memmon.h"
+#include "string.h"
+
+void Host_RegsReset(void);
+
+extern DMA_HandleTypeDef hdma_adc1;
+
+// Handles defined by the CubeMX files not built on the host
+I2C_HandleTypeDef hi2c3;
+TIM_HandleTypeDef htim2;
+
+uint32_t SystemCoreClock = 100000000;//SystemClock_Config() result
+
+volatile uint32_t uwTick;
+uint32_t uwTickPrio = (1UL << __NVIC_PRIO_BITS);
+uint32_t uwTickFreq = HAL_TICK_FREQ_DEFAULT;
+
+struct _HOST_I2C HostI2c;
+uint32_t HostErrorCount = 0;
+
+static uint16_t AdcIn[19];//Input level of each ADC1 channel, as the code it converts to
+static uint8_t AdcRankCh[16];//Channel of each regular rank, from HAL_ADC_ConfigChannel()
+static ADC_HandleTypeDef *AdcRun;//ADC started, converts on its trigger
+static uint32_t *AdcDmaBuf;//ADC1 DMA destination, 16-bit codes in a uint32_t* as the HAL takes it
+static uint32_t AdcDmaLen;
+static uint32_t AdcDmaPos;//Next transfer, AdcDmaLen once a normal-mode transfer is done
+static char UartCap[HOST_UART_CAP + 1];
+static uint32_t UartCapLen;
+static uint8_t UartTxPending;
+
+/** ===================================================================
+**     Function Name : void Host_Reset(void)
+**     Description : Power-on state: registers cleared, tick at zero,
+**       handles bound to their instances and idle, captures empty
+**     Parameters  :
+**     Returns     :
+** ===================================================================*/
+void Host_Reset(void)
+{
+	Host_RegsReset();
+	uwTick = 0;
+	HostErrorCount = 0;
+	memset(&HostI2c, 0, sizeof(HostI2c));
+	memset(&hadc1, 0, sizeof(hadc1));
+	memset(&hdma_adc1, 0, sizeof(hdma_adc1));
+	memset(&hi2c3, 0, sizeof(hi2c3));
+	memset(&htim2, 0, sizeof(htim2));
+	hadc1.Instance = ADC1;
+	hi2c3.Instance = I2C3;
+	hi2c3.State = HAL_I2C_STATE_READY;
+	htim2.Instance = TIM2;
+	huart2.Instance = USART2;
+	huart2.gState = HAL_UART_STATE_READY;
+	huart2.RxState = HAL_UART_STATE_READY;
+	memset(AdcIn, 0, sizeof(AdcIn));
+	memset(AdcRankCh, 0, sizeof(AdcRankCh));
+	AdcRun = 0;
+	AdcDmaBuf = 0;
+	AdcDmaLen = 0;
+	AdcDmaPos = 0;
+	UartTxPending = 0;
+	Host_UartClear();
+}
+
+void Host_AdvanceMs(uint32_t ms)
+{
+	uwTick += ms;
+}
+
+__WEAK void Host_Wfi(void)
+{
+}
+
+void Error_Handler(void)
+{
+	HostErrorCount++;
+}
+
+/***************************** Tick and core *****************/
+HAL_StatusTypeDef HAL_Init(void)
+{
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_InitTick(uint32_t TickPriority)
+{
+	(void)TickPriority;
+	return HAL_OK;
+}
+
+void HAL_IncTick(void)
+{
+	uwTick += uwTickFreq;
+}
+
+uint32_t HAL_GetTick(void)
+{
+	return uwTick;
+}
+
+// Returns at once with the tick moved on, nothing runs meanwhile
+void HAL_Delay(uint32_t Delay)
+{
+	uwTick += Delay;
+}
+
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority)
+{
+	(void)IRQn; (void)PreemptPriority; (void)SubPriority;
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn)
+{
+	(void)IRQn;
+}
+
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn)
+{
+	(void)IRQn;
+}
+
+HAL_StatusTypeDef HAL_RCCEx_PeriphCLKConfig(RCC_PeriphCLKInitTypeDef *PeriphClkInit)
+{
+	(void)PeriphClkInit;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef *hdma)
+{
+	hdma->State = HAL_DMA_STATE_READY;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_DeInit(DMA_HandleTypeDef *hdma)
+{
+	hdma->State = HAL_DMA_STATE_RESET;
+	return HAL_OK;
+}
+
+// HRTIM DMA bursts are not modelled
+HAL_StatusTypeDef HAL_DMA_Start_IT(DMA_HandleTypeDef *hdma, uint32_t SrcAddress, uint32_t DstAddress, uint32_t DataLength)
+{
+	(void)hdma; (void)SrcAddress; (void)DstAddress; (void)DataLength;
+	return HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_DMA_Abort(DMA_HandleTypeDef *hdma)
+{
+	(void)hdma;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *htim)
+{
+	htim->Instance->CR1 |= TIM_CR1_CEN;
+	return HAL_OK;
+}
+
+/***************************** ADC *****************/
+static const uint32_t AdcRank[16] = {
+	ADC_REGULAR_RANK_1, ADC_REGULAR_RANK_2, ADC_REGULAR_RANK_3, ADC_REGULAR_RANK_4,
+	ADC_REGULAR_RANK_5, ADC_REGULAR_RANK_6, ADC_REGULAR_RANK_7, ADC_REGULAR_RANK_8,
+	ADC_REGULAR_RANK_9, ADC_REGULAR_RANK_10, ADC_REGULAR_RANK_11, ADC_REGULAR_RANK_12,
+	ADC_REGULAR_RANK_13, ADC_REGULAR_RANK_14, ADC_REGULAR_RANK_15, ADC_REGULAR_RANK_16
+};
+
+HAL_StatusTypeDef HAL_ADC_Init(ADC_HandleTypeDef *hadc)
+{
+	if(hadc->Instance->CR & ADC_CR_ADSTART)
+		return HAL_ERROR;
+	if(hadc->State == HAL_ADC_STATE_RESET)
+		HAL_ADC_MspInit(hadc);
+	hadc->State = HAL_ADC_STATE_READY;
+	return HAL_OK;
+}
+
+__WEAK void HAL_ADC_MspInit(ADC_HandleTypeDef *hadc)
+{
+	(void)hadc;
+}
+
+HAL_StatusTypeDef HAL_ADCEx_MultiModeConfigChannel(ADC_HandleTypeDef *hadc, const ADC_MultiModeTypeDef *multimode)
+{
+	(void)hadc; (void)multimode;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_ConfigChannel(ADC_HandleTypeDef *hadc, const ADC_ChannelConfTypeDef *sConfig)
+{
+	uint32_t r;
+
+	if(hadc->Instance->CR & ADC_CR_ADSTART)
+		return HAL_ERROR;
+	for(r = 0; r < 16 && AdcRank[r] != sConfig->Rank; r++)
+		;
+	if(r == 16)
+		return HAL_ERROR;
+	AdcRankCh[r] = __LL_ADC_CHANNEL_TO_DECIMAL_NB(sConfig->Channel);
+	return HAL_OK;
+}
+
+// One regular sequence: NbrOfConversion ranks with the scan on, rank 1 without
+static void Host_AdcSequence(ADC_HandleTypeDef *hadc)
+{
+	uint32_t n = (hadc->Init.ScanConvMode == ADC_SCAN_DISABLE) ? 1 : hadc->Init.NbrOfConversion;
+	uint8_t circ = hadc->DMA_Handle != 0 && hadc->DMA_Handle->Init.Mode == DMA_CIRCULAR &&
+		hadc->Init.DMAContinuousRequests == ENABLE;
+	uint32_t r;
+
+	for(r = 0; r < n && r < 16; r++)
+	{
+		hadc->Instance->DR = AdcIn[AdcRankCh[r]];
+		if(AdcDmaBuf == 0 || AdcDmaPos >= AdcDmaLen)
+			continue;//No DMA request: the code stays in DR
+		((uint16_t *)AdcDmaBuf)[AdcDmaPos++] = hadc->Instance->DR;
+		if(AdcDmaPos == AdcDmaLen && circ)
+			AdcDmaPos = 0;
+	}
+	// A software-started single sequence ends here, a triggered one waits for the next trigger
+	if(hadc->Init.ExternalTrigConv == ADC_SOFTWARE_START && hadc->Init.ContinuousConvMode == DISABLE)
+		hadc->Instance->CR &= ~ADC_CR_ADSTART;
+}
+
+// Start as the HAL does: busy while a conversion is on, software trigger converts at once
+static HAL_StatusTypeDef Host_AdcStart(ADC_HandleTypeDef *hadc)
+{
+	if(hadc->State == HAL_ADC_STATE_RESET)
+		return HAL_ERROR;
+	if(hadc->Instance->CR & ADC_CR_ADSTART)
+		return HAL_BUSY;
+	hadc->Instance->CR |= ADC_CR_ADSTART;
+	AdcRun = hadc;
+	if(hadc->Init.ExternalTrigConv == ADC_SOFTWARE_START)
+		Host_AdcSequence(hadc);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_Start(ADC_HandleTypeDef *hadc)
+{
+	AdcDmaBuf = 0;
+	AdcDmaLen = 0;
+	return Host_AdcStart(hadc);
+}
+
+HAL_StatusTypeDef HAL_ADC_Start_DMA(ADC_HandleTypeDef *hadc, uint32_t *pData, uint32_t Length)
+{
+	if(hadc->Instance->CR & ADC_CR_ADSTART)
+		return HAL_BUSY;
+	AdcDmaBuf = pData;
+	AdcDmaLen = Length;
+	AdcDmaPos = 0;
+	// HAL_DMA_Start_IT() enables the channel with the error, half and full transfer interrupts
+	if(hadc->DMA_Handle)
+		hadc->DMA_Handle->Instance->CCR |= DMA_IT_TE | DMA_IT_HT | DMA_IT_TC | DMA_CCR_EN;
+	return Host_AdcStart(hadc);
+}
+
+HAL_StatusTypeDef HAL_ADC_Stop_DMA(ADC_HandleTypeDef *hadc)
+{
+	hadc->Instance->CR &= ~ADC_CR_ADSTART;
+	AdcRun = 0;
+	AdcDmaBuf = 0;
+	AdcDmaLen = 0;
+	return HAL_OK;
+}
+
+/** ===================================================================
+**     Function Name : void Host_AdcSet(...)
+**     Description : Levels on the four sense inputs, held until the
+**       next call. They reach the DMA buffer only through a conversion:
+**       at HAL_ADC_Start_DMA() with a software trigger, or on the
+**       trigger adc.c selects, see Host_AdcTrigger().
+**     Parameters  : ch0..ch3 - 12-bit codes on ADC1_IN1..IN4: Vin, Iin,
+**       Vout, Iout
+**     Returns     :
+** ===================================================================*/
+void Host_AdcSet(uint16_t ch0, uint16_t ch1, uint16_t ch2, uint16_t ch3)
+{
+	AdcIn[1] = ch0;
+	AdcIn[2] = ch1;
+	AdcIn[3] = ch2;
+	AdcIn[4] = ch3;
+}
+
+/** ===================================================================
+**     Function Name : void Host_AdcTrigger(uint32_t trig)
+**     Description : An external trigger event. A started ADC set to that
+**       source and an edge converts one sequence. In continuous mode the
+**       ADC converts at every event, whatever the source, which stands
+**       for free-running conversions.
+**     Parameters  : trig - ADC_EXTERNALTRIG_xxx
+**     Returns     :
+** ===================================================================*/
+void Host_AdcTrigger(uint32_t trig)
+{
+	ADC_HandleTypeDef *hadc = AdcRun;
+
+	if(hadc == 0 || !(hadc->Instance->CR & ADC_CR_ADSTART))
+		return;
+	if(hadc->Init.ContinuousConvMode == ENABLE ||
+		(hadc->Init.ExternalTrigConv == trig && hadc->Init.ExternalTrigConvEdge != ADC_EXTERNALTRIGCONVEDGE_NONE))
+		Host_AdcSequence(hadc);
+}
+
+/***************************** I2C *****************/
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+	uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+	(void)MemAddSize; (void)Timeout;
+	if(hi2c->State != HAL_I2C_STATE_READY)
+		return HAL_BUSY;
+	HostI2c.DevAddr = DevAddress;
+	HostI2c.MemAddr = MemAddress;
+	HostI2c.Size = Size;
+	HostI2c.Data = pData;
+	HostI2c.Transfers++;
+	HostI2c.Bytes += Size;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+	uint16_t MemAddSize, uint8_t *pData, uint16_t Size)
+{
+	if(HAL_I2C_Mem_Write(hi2c, DevAddress, MemAddress, MemAddSize, pData, Size, 0) != HAL_OK)
+		return HAL_BUSY;
+	hi2c->State = HAL_I2C_STATE_BUSY_TX;
+	HostI2c.Pending = 1;
+	return HAL_OK;
+}
+
+__WEAK void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+	(void)hi2c;
+}
+
+__WEAK void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+	(void)hi2c;
+}
+
+/** ===================================================================
+**     Function Name : uint8_t Host_I2cComplete(void)
+**     Description : Finish the pending I2C3 DMA transfer and run the
+**       completion callback, which may start the next one
+**     Parameters  :
+**     Returns     : 1 if a transfer was pending
+** ===================================================================*/
+uint8_t Host_I2cComplete(void)
+{
+	if(!HostI2c.Pending)
+		return 0;
+	HostI2c.Pending = 0;
+	hi2c3.State = HAL_I2C_STATE_READY;
+	HAL_I2C_MemTxCpltCallback(&hi2c3);
+	return 1;
+}
+
+/***************************** UART *****************/
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart)
+{
+	huart->gState = HAL_UART_STATE_READY;
+	huart->RxState = HAL_UART_STATE_READY;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_DeInit(UART_HandleTypeDef *huart)
+{
+	huart->gState = HAL_UART_STATE_RESET;
+	huart->RxState = HAL_UART_STATE_RESET;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UARTEx_SetTxFifoThreshold(UART_HandleTypeDef *huart, uint32_t Threshold)
+{
+	(void)huart; (void)Threshold;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UARTEx_SetRxFifoThreshold(UART_HandleTypeDef *huart, uint32_t Threshold)
+{
+	(void)huart; (void)Threshold;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UARTEx_DisableFifoMode(UART_HandleTypeDef *huart)
+{
+	(void)huart;
+	return HAL_OK;
+}
+
+static void Uart_Capture(const uint8_t *p, uint16_t n)
+{
+	while(n-- && UartCapLen < HOST_UART_CAP)
+		UartCap[UartCapLen++] = (char)*p++;
+	UartCap[UartCapLen] = '\0';
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+	(void)Timeout;
+	if(huart->gState != HAL_UART_STATE_READY)
+		return HAL_BUSY;
+	Uart_Capture(pData, Size);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size)
+{
+	if(huart->gState != HAL_UART_STATE_READY)
+		return HAL_BUSY;
+	Uart_Capture(pData, Size);
+	huart->gState = HAL_UART_STATE_BUSY_TX;
+	UartTxPending = 1;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size)
+{
+	if(huart->RxState != HAL_UART_STATE_READY)
+		return HAL_BUSY;
+	huart->pRxBuffPtr = pData;
+	huart->RxXferSize = Size;
+	huart->RxXferCount = Size;
+	huart->RxState = HAL_UART_STATE_BUSY_RX;
+	return HAL_OK;
+}
+
+__WEAK void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+	(void)huart;
+}
+
+__WEAK void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
+{
+	(void)huart;
+}
+
+__WEAK void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+	(void)huart;
+}
+
+/** ===================================================================
+**     Function Name : uint8_t Host_UartTxComplete(void)
+**     Description : Finish the pending USART2 DMA transmit
+**     Parameters  :
+**     Returns     : 1 if a transmit was pending
+** ===================================================================*/
+uint8_t Host_UartTxComplete(void)
+{
+	if(!UartTxPending)
+		return 0;
+	UartTxPending = 0;
+	huart2.gState = HAL_UART_STATE_READY;
+	HAL_UART_TxCpltCallback(&huart2);
+	return 1;
+}
+
+/** ===================================================================
+**     Function Name : void Host_UartRx(const char *s)
+**     Description : Receive a string on USART2, one byte per receive
+**       interrupt. Bytes that arrive with no receive armed are lost,
+**       as an overrun would lose them.
+**     Parameters  : s - bytes to receive
+**     Returns     :
+** ===================================================================*/
+void Host_UartRx(const char *s)
+{
+	while(*s)
+	{
+		if(huart2.RxState == HAL_UART_STATE_BUSY_RX && huart2.RxXferCount)
+		{
+			*huart2.pRxBuffPtr++ = (uint8_t)*s;
+			if(--huart2.RxXferCount == 0)
+			{
+				huart2.RxState = HAL_UART_STATE_READY;
+				HAL_UART_RxCpltCallback(&huart2);
+			}
+		}
+		s++;
+	}
+}
+
+const char *Host_UartOutput(void)
+{
+	return UartCap;
+}
+
+void Host_UartClear(void)
+{
+	UartCapLen = 0;
+	UartCap[0] = '\0';
+}
+
+/** ===================================================================
+**     Function Name : void Host_RunIrqs(void)
+**     Description : Complete every pending transfer, including those the
+**       callbacks start, as if the interrupts had all been served
+**     Parameters  :
+**     Returns     :
+** ===================================================================*/
+void Host_RunIrqs(void)
+{
+	while(Host_I2cComplete() || Host_UartTxComplete())
+		;
+}
+
+/** ===================================================================
+**     Function Name : void Host_GpioSetInput(...)
+**     Description : Drive an input pin level seen through IDR
+**     Parameters  : port - GPIO port
+**                   pin - GPIO_PIN_x mask
+**                   level - 0 low, 1 high
+**     Returns     :
+** ===================================================================*/
+void Host_GpioSetInput(GPIO_TypeDef *port, uint16_t pin, uint8_t level)
+{
+	if(level)
+		port->IDR |= pin;
+	else
+		port->IDR &= ~(uint32_t)pin;
+}
+
+/***************************** Memory monitor *****************/
+// memmon.c needs the target linker symbols; the host has no MSP stack to measure
+struct _MEM Mem;
+
+void Mem_Init(void)
+{
+	memset(&Mem, 0, sizeof(Mem));
+}
+
+void Mem_Task(void)
+{
+}
+
+uint8_t Mem_Format(uint8_t line, char *buf)
+{
+	(void)buf;
+	return 0;//No [MEM] line on the host
+}
@@ -0,0 +1,48 @@
+/**
+  ******************************************************************************
+  * @file    host.h
+  * @brief   Test-side interface of the host HAL stub.
+  *
+  *          The stub stands in for the hardware behind HRTIM1, ADC1, I2C3,
+  *          USART2 and TIM2. Register writes land in host memory and can be
+  *          read back; transfers that complete by DMA or interrupt on the
+  *          board stay pending until the test completes them, so callback
+  *          order matches the target.
+  ******************************************************************************
+  */
+#ifndef __HOST_H
+#define __HOST_H
+
+#include "main.h"
+
+#define HOST_UART_CAP	4096	// USART2 transmit capture, bytes
+
+// Last I2C transfer started, for display checks
+struct _HOST_I2C
+{
+	uint16_t	DevAddr;
+	uint16_t	MemAddr;//Control byte: 0x00 command, 0x40 data
+	uint16_t	Size;
+	const uint8_t	*Data;
+	uint8_t		Pending;//DMA transfer not completed yet
+	uint32_t	Transfers;//Transfers started since Host_Reset()
+	uint32_t	Bytes;//Bytes sent since Host_Reset()
+};
+
+extern struct _HOST_I2C HostI2c;
+extern uint32_t HostErrorCount;//Error_Handler() calls since Host_Reset()
+
+void Host_Reset(void);
+void Host_AdvanceMs(uint32_t ms);
+uint8_t Host_I2cComplete(void);
+uint8_t Host_UartTxComplete(void);
+void Host_RunIrqs(void);
+void Host_UartRx(const char *s);
+const char *Host_UartOutput(void);
+void Host_UartClear(void);
+void Host_AdcSet(uint16_t ch0, uint16_t ch1, uint16_t ch2, uint16_t ch3);
+void Host_AdcTrigger(uint32_t trig);
+void Host_GpioSetInput(GPIO_TypeDef *port, uint16_t pin, uint8_t level);
+uint32_t Host_HrtimOutputs(void);
+
+#endif
@@ -0,0 +1,97 @@
+/**
+  ******************************************************************************
+  * @file    host_regs.c
+  * @brief   Peripheral and core register blocks for the host build.
+  *
+  *          stm32g4xx.h and core_cm4.h in this directory point the
+  *          peripheral macros here. The blocks are plain memory: a write
+  *          reads back unchanged and nothing happens on its own, apart
+  *          from the few status bits Host_Reset() sets for the HAL drivers
+  *          that wait on them.
+  ******************************************************************************
+  */
+#include "host.h"
+#include "string.h"
+
+HRTIM_TypeDef HostHRTIM1;
+ADC_TypeDef HostADC1;
+ADC_TypeDef HostADC2;
+ADC_Common_TypeDef HostADC12;
+I2C_TypeDef HostI2C3;
+USART_TypeDef HostUSART2;
+TIM_TypeDef HostTIM2;
+GPIO_TypeDef HostGPIO[7];
+RCC_TypeDef HostRCC;
+DMA_TypeDef HostDMA1;
+DMA_Channel_TypeDef HostDMA1Ch[8];
+DMAMUX_Channel_TypeDef HostDMAMUX1[16];
+EXTI_TypeDef HostEXTI;
+SYSCFG_TypeDef HostSYSCFG;
+PWR_TypeDef HostPWR;
+FLASH_TypeDef HostFLASH;
+DBGMCU_TypeDef HostDBGMCU;
+
+SCB_Type HostSCB;
+NVIC_Type HostNVIC;
+SysTick_Type HostSysTick;
+DWT_Type HostDWT;
+CoreDebug_Type HostCoreDebug;
+
+volatile uint32_t HostPrimask = 0;
+uint32_t HostMsp = 0x20000A88;//Top of the 1KB MSP stack in the target map
+
+/** ===================================================================
+**     Function Name : void Host_RegsReset(void)
+**     Description : Clear all register blocks and set the status bits
+**       of a running, calibrated chip
+**     Parameters  :
+**     Returns     :
+** ===================================================================*/
+void Host_RegsReset(void)
+{
+	memset(&HostHRTIM1, 0, sizeof(HostHRTIM1));
+	memset(&HostADC1, 0, sizeof(HostADC1));
+	memset(&HostADC2, 0, sizeof(HostADC2));
+	memset(&HostADC12, 0, sizeof(HostADC12));
+	memset(&HostI2C3, 0, sizeof(HostI2C3));
+	memset(&HostUSART2, 0, sizeof(HostUSART2));
+	memset(&HostTIM2, 0, sizeof(HostTIM2));
+	memset(HostGPIO, 0, sizeof(HostGPIO));
+	memset(&HostRCC, 0, sizeof(HostRCC));
+	memset(&HostDMA1, 0, sizeof(HostDMA1));
+	memset(HostDMA1Ch, 0, sizeof(HostDMA1Ch));
+	memset(HostDMAMUX1, 0, sizeof(HostDMAMUX1));
+	memset(&HostEXTI, 0, sizeof(HostEXTI));
+	memset(&HostSYSCFG, 0, sizeof(HostSYSCFG));
+	memset(&HostPWR, 0, sizeof(HostPWR));
+	memset(&HostFLASH, 0, sizeof(HostFLASH));
+	memset(&HostDBGMCU, 0, sizeof(HostDBGMCU));
+	memset(&HostSCB, 0, sizeof(HostSCB));
+	memset(&HostNVIC, 0, sizeof(HostNVIC));
+	memset(&HostSysTick, 0, sizeof(HostSysTick));
+	memset(&HostDWT, 0, sizeof(HostDWT));
+	memset(&HostCoreDebug, 0, sizeof(HostCoreDebug));
+
+	// HAL_HRTIM_PollForDLLCalibration() waits for the DLL to lock
+	HostHRTIM1.sCommonRegs.ISR = HRTIM_ISR_DLLRDY;
+	// Key inputs have pull-ups: idle high
+	HostGPIO[0].IDR = 0xFFFF;
+	HostGPIO[1].IDR = 0xFFFF;
+	HostPrimask = 0;
+}
+
+/** ===================================================================
+**     Function Name : uint32_t Host_HrtimOutputs(void)
+**     Description : Outputs the HRTIM drives. OENR and ODISR are set-only
+**       on the chip: a write to ODISR clears the OENR bits. The blocks
+**       here are plain memory, so the pending disables are folded into
+**       OENR on each call.
+**     Parameters  :
+**     Returns     : HRTIM_OUTPUT_xxx bits that are enabled
+** ===================================================================*/
+uint32_t Host_HrtimOutputs(void)
+{
+	HostHRTIM1.sCommonRegs.OENR &= ~HostHRTIM1.sCommonRegs.ODISR;
+	HostHRTIM1.sCommonRegs.ODISR = 0;
+	return HostHRTIM1.sCommonRegs.OENR;
+}
@@ -0,0 +1,128 @@
+/**
+  ******************************************************************************
+  * @file    stm32g4xx.h
+  * @brief   Host wrapper around the STM32G4 device header.
+  *
+  *          Found before the CMSIS device directory on the host include
+  *          path. It includes the real header for the register types and
+  *          bit definitions, then points the peripherals the firmware and
+  *          the HAL drivers touch at register blocks in host memory (see
+  *          host_regs.c). Peripherals left out keep their hardware address,
+  *          so an access that is not modelled faults at once.
+  ******************************************************************************
+  */
+#ifndef __STM32G4xx_HOST_H
+#define __STM32G4xx_HOST_H
+
+// Pull in the HAL after the peripherals are redirected
+#ifdef USE_HAL_DRIVER
+#undef USE_HAL_DRIVER
+#define HOST_USE_HAL_DRIVER
+#endif
+
+#include_next <stm32g4xx.h>
+
+extern HRTIM_TypeDef HostHRTIM1;
+extern ADC_TypeDef HostADC1;
+extern ADC_TypeDef HostADC2;
+extern ADC_Common_TypeDef HostADC12;
+extern I2C_TypeDef HostI2C3;
+extern USART_TypeDef HostUSART2;
+extern TIM_TypeDef HostTIM2;
+extern GPIO_TypeDef HostGPIO[7];
+extern RCC_TypeDef HostRCC;
+extern DMA_TypeDef HostDMA1;
+extern DMA_Channel_TypeDef HostDMA1Ch[8];
+extern DMAMUX_Channel_TypeDef HostDMAMUX1[16];
+extern EXTI_TypeDef HostEXTI;
+extern SYSCFG_TypeDef HostSYSCFG;
+extern PWR_TypeDef HostPWR;
+extern FLASH_TypeDef HostFLASH;
+extern DBGMCU_TypeDef HostDBGMCU;
+
+#undef HRTIM1
+#undef HRTIM1_TIMA
+#undef HRTIM1_TIMB
+#undef HRTIM1_TIMC
+#undef HRTIM1_TIMD
+#undef HRTIM1_TIME
+#undef HRTIM1_TIMF
+#undef HRTIM1_COMMON
+#define HRTIM1			(&HostHRTIM1)
+#define HRTIM1_TIMA		(&HostHRTIM1.sTimerxRegs[0])
+#define HRTIM1_TIMB		(&HostHRTIM1.sTimerxRegs[1])
+#define HRTIM1_TIMC		(&HostHRTIM1.sTimerxRegs[2])
+#define HRTIM1_TIMD		(&HostHRTIM1.sTimerxRegs[3])
+#define HRTIM1_TIME		(&HostHRTIM1.sTimerxRegs[4])
+#define HRTIM1_TIMF		(&HostHRTIM1.sTimerxRegs[5])
+#define HRTIM1_COMMON	(&HostHRTIM1.sCommonRegs)
+
+#undef ADC1
+#undef ADC2
+#undef ADC12_COMMON
+#define ADC1			(&HostADC1)
+#define ADC2			(&HostADC2)
+#define ADC12_COMMON	(&HostADC12)
+
+#undef I2C3
+#undef USART2
+#undef TIM2
+#define I2C3			(&HostI2C3)
+#define USART2			(&HostUSART2)
+#define TIM2			(&HostTIM2)
+
+#undef GPIOA
+#undef GPIOB
+#undef GPIOC
+#undef GPIOD
+#undef GPIOE
+#undef GPIOF
+#undef GPIOG
+#define GPIOA			(&HostGPIO[0])
+#define GPIOB			(&HostGPIO[1])
+#define GPIOC			(&HostGPIO[2])
+#define GPIOD			(&HostGPIO[3])
+#define GPIOE			(&HostGPIO[4])
+#define GPIOF			(&HostGPIO[5])
+#define GPIOG			(&HostGPIO[6])
+
+#undef DMA1
+#undef DMA1_Channel1
+#undef DMA1_Channel2
+#undef DMA1_Channel3
+#undef DMA1_Channel4
+#undef DMA1_Channel5
+#undef DMA1_Channel6
+#undef DMA1_Channel7
+#undef DMA1_Channel8
+#undef DMAMUX1
+#define DMA1			(&HostDMA1)
+#define DMA1_Channel1	(&HostDMA1Ch[0])
+#define DMA1_Channel2	(&HostDMA1Ch[1])
+#define DMA1_Channel3	(&HostDMA1Ch[2])
+#define DMA1_Channel4	(&HostDMA1Ch[3])
+#define DMA1_Channel5	(&HostDMA1Ch[4])
+#define DMA1_Channel6	(&HostDMA1Ch[5])
+#define DMA1_Channel7	(&HostDMA1Ch[6])
+#define DMA1_Channel8	(&HostDMA1Ch[7])
+#define DMAMUX1			(&HostDMAMUX1[0])
+
+#undef RCC
+#undef EXTI
+#undef SYSCFG
+#undef PWR
+#undef FLASH
+#undef DBGMCU
+#define RCC				(&HostRCC)
+#define EXTI			(&HostEXTI)
+#define SYSCFG			(&HostSYSCFG)
+#define PWR				(&HostPWR)
+#define FLASH			(&HostFLASH)
+#define DBGMCU			(&HostDBGMCU)
+
+#ifdef HOST_USE_HAL_DRIVER
+#define USE_HAL_DRIVER
+#include "stm32g4xx_hal.h"
+#endif
+
+#endif
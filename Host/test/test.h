@@ -0,0 +1,40 @@
+/**
+  ******************************************************************************
+  * @file    test.h
+  * @brief   Minimal check macros for the host tests.
+  *
+  *          A failed CHECK prints the location and the expression and
+  *          counts the failure; the test keeps going. TEST_END() returns
+  *          the exit status for ctest.
+  ******************************************************************************
+  */
+#ifndef __TEST_H
+#define __TEST_H
+
+#include <stdio.h>
+
+extern int TestFail;
+extern int TestRun;
+
+#define TEST_DEFINE()	int TestFail = 0; int TestRun = 0
+
+#define CHECK(expr) do { \
+	TestRun++; \
+	if(!(expr)) { \
+		TestFail++; \
+		printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #expr); \
+	} \
+} while(0)
+
+#define CHECK_EQ(a, b) do { \
+	long long _a = (long long)(a), _b = (long long)(b); \
+	TestRun++; \
+	if(_a != _b) { \
+		TestFail++; \
+		printf("%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #a, #b, _a, _b); \
+	} \
+} while(0)
+
+#define TEST_END() (printf("%d checks, %d failed\n", TestRun, TestFail), TestFail != 0)
+
+#endif
@@ -0,0 +1,205 @@
+/**
+  ******************************************************************************
+  * @file    test_host.c
+  * @brief   Host build smoke test: the firmware runs on the stub HAL.
+  *
+  *          Brings the HRTIM up through MX_HRTIM1_Init() on the real HAL
+  *          driver and checks the registers that SetPWMFrequency(), the
+  *          queued setpoints, the ADC path and the USART2 command line
+  *          leave behind, and that the boot benchmark leaves nothing.
+  ******************************************************************************
+  */
+#include "host.h"
+#include "hrtim.h"
+#include "usart.h"
+#include "function.h"
+#include "snap.h"
+#include "setp.h"
+#include "cmd.h"
+#include "bench.h"
+#include "CtlLoop.h"
+#include "test.h"
+#include "string.h"
+
+TEST_DEFINE();
+
+#define TIMA	HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A]
+#define TIMB	HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_B]
+
+static void Boot(void)
+{
+	Host_Reset();
+	MX_HRTIM1_Init();
+	MX_USART2_UART_Init();
+	MX_ADC1_Init();
+	ADC1_StartScan(ADC1_RESULT);
+}
+
+static void Test_HrtimInit(void)
+{
+	Boot();
+	CHECK_EQ(HostErrorCount, 0);
+	CHECK_EQ(TIMA.PERxR, 16000);//100kHz at MUL16
+	CHECK_EQ(TIMB.PERxR, 16000);
+	CHECK_EQ(TIMA.TIMxCR & HRTIM_TIMCR_CK_PSC, HRTIM_PRESCALERRATIO_MUL16);
+}
+
+static void Test_SetPWMFrequency(void)
+{
+	Boot();
+	CHECK_EQ(SetPWMFrequency(120000), HAL_OK);
+	CHECK_EQ(TIMA.PERxR, 1600000000UL / 120000);
+	CHECK_EQ(TIMB.PERxR, 1600000000UL / 120000);
+	CHECK_EQ(TIMA.CMP2xR, 1600000000UL / 120000 / 2 - 1);
+	CHECK_EQ(currentPWMFreqHz, 120000);
+
+	// Below 100kHz the prescaler drops to MUL8
+	CHECK_EQ(SetPWMFrequency(80000), HAL_OK);
+	CHECK_EQ(TIMA.TIMxCR & HRTIM_TIMCR_CK_PSC, HRTIM_PRESCALERRATIO_MUL8);
+	CHECK_EQ(TIMA.PERxR, 800000000UL / 80000);
+
+	CHECK_EQ(SetPWMFrequency(60000), HAL_ERROR);//Below FREQ_MIN
+	CHECK_EQ(currentPWMFreqHz, 80000);
+}
+
+static void Test_Setpoints(void)
+{
+	Boot();
+	// Queued, untouched until the next control period
+	CHECK_EQ(RequestPWMFrequency(110000), HAL_OK);
+	CHECK_EQ(TIMA.PERxR, 16000);
+	Control_Period();
+	CHECK_EQ(TIMA.PERxR, 1600000000UL / 110000);
+	CHECK_EQ(TIMB.PERxR, 1600000000UL / 110000);
+	CHECK_EQ(currentPWMFreqHz, 110000);
+
+	CHECK(RequestDeadTime(20));
+	Control_Period();
+	CHECK_EQ(TIMA.CMP2xR, TIMA.PERxR * 20 / 1000);
+	CHECK_EQ(TIMB.CMP2xR, TIMB.PERxR - TIMA.PERxR * 20 / 1000);
+	CHECK(!RequestDeadTime(DEADTIME_MAX_PX1000 + 1));
+	CHECK(!RequestDeadTime(0));
+}
+
+static void Test_AdcSnapshot(void)
+{
+	struct _SNAP s;
+	uint32_t seq;
+	int i;
+
+	Boot();
+	Host_AdcSet(1000, 2048, 2000, 2100);
+	Host_AdcTrigger(ADC_EXTERNALTRIG_HRTIM_TRG1);
+	seq = Snap_Read(&s);
+	for(i = 0; i < 32; i++)//Let the moving averages settle
+		Control_Period();
+	CHECK_EQ(Snap_Read(&s), seq + 32);
+	CHECK_EQ(s.Seq, seq + 32);
+	CHECK_EQ(s.Adc.Vout, (2000 * CAL_VOUT_K >> 12) + CAL_VOUT_B);
+	CHECK_EQ(s.Adc.Iout, (2100 * CAL_IOUT_K >> 12) + CAL_IOUT_B);
+	CHECK(s.Adc.VoutAvg >= s.Adc.Vout - 4 && s.Adc.VoutAvg <= s.Adc.Vout);
+}
+
+static void Test_Adc(void)
+{
+	uint16_t none[4] = {0, 0, 0, 0};
+
+	// One scan of the four channels per HRTIM trigger, the circular DMA wraps
+	Boot();
+	CHECK_EQ(HostErrorCount, 0);
+	memset(ADC1_RESULT, 0, sizeof(ADC1_RESULT));
+	Host_AdcSet(100, 200, 300, 400);
+	CHECK(memcmp(ADC1_RESULT, none, sizeof(none)) == 0);//Nothing until the trigger
+	Host_AdcTrigger(ADC_EXTERNALTRIG_HRTIM_TRG3);
+	CHECK_EQ(ADC1_RESULT[0], 0);//Not the source adc.c selects
+	Host_AdcTrigger(ADC_EXTERNALTRIG_HRTIM_TRG1);
+	CHECK(ADC1_RESULT[0] == 100 && ADC1_RESULT[1] == 200 && ADC1_RESULT[2] == 300 && ADC1_RESULT[3] == 400);
+	Host_AdcSet(101, 201, 301, 401);
+	Host_AdcTrigger(ADC_EXTERNALTRIG_HRTIM_TRG1);
+	CHECK(ADC1_RESULT[0] == 101 && ADC1_RESULT[1] == 201 && ADC1_RESULT[2] == 301 && ADC1_RESULT[3] == 401);
+	CHECK_EQ(HAL_ADC_Start_DMA(&hadc1, (uint32_t *)ADC1_RESULT, ADC_RANKS), HAL_BUSY);
+	// No DMA interrupt per scan, the control ISR reads the buffer itself; errors still interrupt
+	CHECK_EQ(hadc1.DMA_Handle->Instance->CCR & (DMA_IT_HT | DMA_IT_TC), 0);
+	CHECK(hadc1.DMA_Handle->Instance->CCR & DMA_IT_TE);
+
+	// The old setup: rank 1 alone, software start, normal DMA. One conversion
+	// at the start, then nothing until the next restart.
+	Boot();
+	memset(ADC1_RESULT, 0, sizeof(ADC1_RESULT));
+	hadc1.Init.ScanConvMode = ADC_SCAN_DISABLE;
+	hadc1.Init.NbrOfConversion = 1;
+	hadc1.Init.ExternalTrigConv = ADC_SOFTWARE_START;
+	hadc1.Init.DMAContinuousRequests = DISABLE;
+	hadc1.DMA_Handle->Init.Mode = DMA_NORMAL;
+	HAL_ADC_Stop_DMA(&hadc1);
+	Host_AdcSet(100, 200, 300, 400);
+	CHECK_EQ(HAL_ADC_Start_DMA(&hadc1, (uint32_t *)ADC1_RESULT, 4), HAL_OK);
+	CHECK(ADC1_RESULT[0] == 100 && ADC1_RESULT[1] == 0 && ADC1_RESULT[2] == 0);
+	Host_AdcSet(101, 201, 301, 401);
+	Host_AdcTrigger(ADC_EXTERNALTRIG_HRTIM_TRG1);
+	CHECK_EQ(ADC1_RESULT[0], 100);
+	CHECK_EQ(HAL_ADC_Start_DMA(&hadc1, (uint32_t *)ADC1_RESULT, 4), HAL_OK);
+	CHECK(ADC1_RESULT[0] == 101 && ADC1_RESULT[2] == 0);
+}
+
+static void Test_Command(void)
+{
+	Boot();
+	Cmd_Init();
+	Host_UartRx("f 120000\r\nD 30\r\nX 1\r\n");
+	Cmd_Task();
+	Host_RunIrqs();
+	Cmd_Task();
+	Host_RunIrqs();
+	Cmd_Task();
+	CHECK(strstr(Host_UartOutput(), "OK\r\n") != NULL);
+	CHECK(strstr(Host_UartOutput(), "ERR\r\n") != NULL);
+	Control_Period();
+	CHECK_EQ(TIMA.PERxR, 1600000000UL / 120000);
+	CHECK_EQ(TIMA.CMP2xR, TIMA.PERxR * 30 / 1000);
+}
+
+static void Test_Bench(void)
+{
+	char line[128];
+	uint16_t adc[4] = {1000, 2048, 2000, 2100};
+	uint32_t cmp1a;
+	uint8_t i;
+
+	Boot();
+	Host_AdcSet(adc[0], adc[1], adc[2], adc[3]);
+	Host_AdcTrigger(ADC_EXTERNALTRIG_HRTIM_TRG1);
+	CtrValue.BuckDuty = 1234;
+	CtrValue.Voref = 0;
+	DF.PWMENFlag = 0;
+	u1 = 77;
+	cmp1a = TIMA.CMP1xR;
+	Bench_Run();
+	// The control state is put back
+	CHECK_EQ(CtrValue.BuckDuty, 1234);
+	CHECK_EQ(CtrValue.Voref, 0);
+	CHECK_EQ(DF.PWMENFlag, 0);
+	CHECK_EQ(DF.ErrFlag, F_NOERR);
+	CHECK_EQ(u1, 77);
+	CHECK_EQ(TIMA.CMP1xR, cmp1a);
+	CHECK(memcmp(ADC1_RESULT, adc, sizeof(adc)) == 0);
+	CHECK_EQ(HostPrimask, 0);
+	// Build line then one line per item, in the bench_gate.py format
+	CHECK(Bench_Format(0, line) && strstr(line, "[BEN] build gcc ") == line);
+	for(i = 1; i <= BENCH_NUM; i++)
+		CHECK(Bench_Format(i, line) && strstr(line, " cyc\r\n") != NULL);
+	CHECK(Bench_Format(1, line) && strncmp(line, "[BEN] adc min=", 14) == 0);
+	CHECK(!Bench_Format(BENCH_NUM + 1, line));
+}
+
+int main(void)
+{
+	Test_HrtimInit();
+	Test_SetPWMFrequency();
+	Test_Setpoints();
+	Test_AdcSnapshot();
+	Test_Adc();
+	Test_Command();
+	Test_Bench();
+	return TEST_END();
+}
@@ -0,0 +1,396 @@
+/**
+  ******************************************************************************
+  * @file    test_hrtim.c
+  * @brief   Waveform checks of the HRTIM setup functions on the emulator.
+  *
+  *          Each setting is applied through the firmware function on the
+  *          real HAL driver, then the emulator runs the timers and the
+  *          TA1/TA2/TB1/TB2 pins are measured over two settled periods:
+  *          high time, the gaps between one leg switching off and the
+  *          other switching on, and overlap, which must be zero for every
+  *          accepted setting. Each function is swept over its parameter
+  *          range, including the values it has to refuse.
+  ******************************************************************************
+  */
+#include "host.h"
+#include "hrsim.h"
+#include "hrtim.h"
+#include "function.h"
+#include "CtlLoop.h"
+#include "psfb.h"
+#include "setp.h"
+#include "fm.h"
+#include "test.h"
+
+TEST_DEFINE();
+
+static struct _HRSIM Sim;
+static uint32_t SimPer;//Timer A period, base ticks
+static uint32_t SimFrom;//Measurement window [SimFrom, SimFrom + 2 * SimPer)
+
+// Power up as main() does
+static void Boot(void)
+{
+	Host_Reset();
+	MX_HRTIM1_Init();
+	HAL_HRTIM_WaveformOutputStart(&hhrtim1, HRTIM_OUTPUT_TA1 | HRTIM_OUTPUT_TA2 | HRTIM_OUTPUT_TB1 | HRTIM_OUTPUT_TB2);
+	HAL_HRTIM_WaveformCounterStart(&hhrtim1, HRTIM_TIMERID_TIMER_A | HRTIM_TIMERID_TIMER_B);
+}
+
+// Run periods of Timer A and measure over the last two
+static void Capture(uint32_t periods)
+{
+	HrSim_Start(&Sim);
+	SimPer = HrSim_Period(HRSIM_TIMA);
+	SimFrom = (periods - 2) * SimPer;
+	HrSim_Run(&Sim, periods * SimPer + 2);
+}
+
+// Time from output a switching off to output b switching on
+static uint32_t Gap(uint8_t a, uint8_t b)
+{
+	uint32_t fa = HrSim_Edge(&Sim, a, 0, SimFrom);
+
+	if(fa == HRSIM_NONE || HrSim_Edge(&Sim, b, 1, fa) == HRSIM_NONE)
+		return HRSIM_NONE;
+	return HrSim_Edge(&Sim, b, 1, fa) - fa;
+}
+
+/** ===================================================================
+**     Function Name : static int Pair(...)
+**     Description : Check one leg pair over the window: no overlap,
+**       high time per period of each output, and both gaps
+**     Parameters  : a, b - HRSIM_Txx outputs
+**                   ha, hb - expected high time per period, base ticks
+**                   gab - expected time from a off to b on
+**                   gba - expected time from b off to a on
+**     Returns     : 1 if all checks passed
+** ===================================================================*/
+static int Pair(uint8_t a, uint8_t b, uint32_t ha, uint32_t hb, uint32_t gab, uint32_t gba)
+{
+	int fail = TestFail;
+	uint32_t to = SimFrom + 2 * SimPer;
+
+	CHECK_EQ(HrSim_Overlap(&Sim, a, b, SimFrom, to), 0);
+	CHECK_EQ(HrSim_High(&Sim, a, SimFrom, to), 2 * ha);
+	CHECK_EQ(HrSim_High(&Sim, b, SimFrom, to), 2 * hb);
+	if(ha && hb)
+	{
+		CHECK_EQ(Gap(a, b), gab);
+		CHECK_EQ(Gap(b, a), gba);
+	}
+	CHECK_EQ(Sim.Out[a].Lost + Sim.Out[b].Lost, 0);
+	return TestFail == fail;
+}
+
+// ADC trigger 1 on Timer A CMP3 only, in the middle of the TA1 pulse
+static int AdcTrig(uint32_t per)
+{
+	int ok = HRTIM1->sCommonRegs.ADC1R == HRTIM_ADC1R_AD1TAC3 &&
+		HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A].CMP3xR == HRTIM_ADC_POINT(per);
+
+	CHECK(ok);
+	return ok;
+}
+
+static void Test_Init(void)
+{
+	Boot();
+	Capture(3);
+	CHECK_EQ(SimPer, 16000 << 1);//100kHz at MUL16
+	AdcTrig(16000);
+	// TA active low: pin high from the period start to CMP2, TB from CMP2 to CMP1 = 0
+	Pair(HRSIM_TA1, HRSIM_TB1, 8000 << 1, 8000 << 1, 0, 0);
+	Pair(HRSIM_TA2, HRSIM_TB2, 8000 << 1, 8000 << 1, 0, 0);
+}
+
+static void Test_SetPWMFrequency(void)
+{
+	uint32_t f, per, c, sh;
+	int ok;
+
+	for(f = 70000; f <= 130000; f += 1000)
+	{
+		Boot();
+		CHECK_EQ(SetPWMFrequency(f), HAL_OK);
+		sh = (f >= 100000) ? 1 : 2;//MUL16 or MUL8
+		per = (f >= 100000) ? 1600000000UL / f : 800000000UL / f;
+		c = per / 2 - 1;
+		Capture(3);
+		CHECK_EQ(SimPer, per << sh);
+		ok = Pair(HRSIM_TA1, HRSIM_TB1, c << sh, (per - c) << sh, 0, 0);
+		ok &= Pair(HRSIM_TA2, HRSIM_TB2, c << sh, (per - c) << sh, 0, 0);
+		ok &= AdcTrig(per);
+		if(!ok)
+			printf("  SetPWMFrequency(%u)\n", f);
+	}
+	Boot();
+	CHECK_EQ(SetPWMFrequency(69999), HAL_ERROR);
+	CHECK_EQ(SetPWMFrequency(130001), HAL_ERROR);
+	Capture(3);
+	CHECK_EQ(SimPer, 16000 << 1);
+}
+
+static void Test_SetDeadTimeManual(void)
+{
+	uint32_t d, t;
+	int ok;
+
+	for(d = 0; d <= DEADTIME_MAX_PX1000 + 5; d++)
+	{
+		Boot();
+		SetDeadTimeManual(d);
+		Capture(3);
+		if(d < DEADTIME_MIN_PX1000 || d > DEADTIME_MAX_PX1000)
+		{
+			// Refused, the power-up waveform stays
+			ok = Pair(HRSIM_TA1, HRSIM_TB1, 8000 << 1, 8000 << 1, 0, 0);
+		}
+		else
+		{
+			// TA1 on for t after the period start, TB1 on for t before its end
+			t = 16000 * d / 1000;
+			ok = Pair(HRSIM_TA1, HRSIM_TB1, t << 1, t << 1, (16000 - 2 * t) << 1, 0);
+		}
+		if(!ok)
+			printf("  SetDeadTimeManual(%u)\n", d);
+	}
+}
+
+static void Test_SetDutyCycle(void)
+{
+	uint32_t d, c;
+	int ok;
+
+	for(d = 0; d <= 100; d++)
+	{
+		Boot();
+		if(d < 5 || d > 95)
+		{
+			CHECK_EQ(SetDutyCycle_TA1_TB1(d), HAL_ERROR);
+			c = 8000;
+		}
+		else
+		{
+			CHECK_EQ(SetDutyCycle_TA1_TB1(d), HAL_OK);
+			c = 16000 * d / 100;
+		}
+		Capture(3);
+		ok = Pair(HRSIM_TA1, HRSIM_TB1, c << 1, (16000 - c) << 1, 0, 0);
+		if(!ok)
+			printf("  SetDutyCycle_TA1_TB1(%u)\n", d);
+	}
+	for(d = 0; d <= 50; d++)
+	{
+		Boot();
+		if(d < 5 || d > 45)
+		{
+			CHECK_EQ(SetDutyCycle_TA2_TB2(d), HAL_ERROR);
+			c = 8000;
+		}
+		else
+		{
+			CHECK_EQ(SetDutyCycle_TA2_TB2(d), HAL_OK);
+			c = 16000 * d / 100;
+		}
+		Capture(3);
+		ok = Pair(HRSIM_TA2, HRSIM_TB2, c << 1, (16000 - c) << 1, 0, 0);
+		if(!ok)
+			printf("  SetDutyCycle_TA2_TB2(%u)\n", d);
+	}
+}
+
+static void Test_UpdateHRTIM(void)
+{
+	static const int Half[] = {6000, 7680, 8000, 8500};
+	int per, h, dc, dt, i, d, t, ok;
+
+	for(per = CNTR_MIN; per <= CNTR_MAX; per += 2500)
+	for(i = 0; i < (int)(sizeof(Half) / sizeof(Half[0])); i++)
+	for(d = 0; d <= 9000; d += 2250)
+	for(t = 0; t <= 1200; t += 400)
+	{
+		Boot();
+		h = Half[i] * per / 16000;
+		dc = d * per / 16000;
+		dt = t * per / 16000;
+		if(UpdateHRTIM(per, Half[i], d, dt) != HAL_OK)
+		{
+			// Refused only where TA and TB would be on together
+			CHECK(dt > h || 2 * h - dt > per || dc > h || h + dc > per);
+			continue;
+		}
+		// Timer B runs half_period behind Timer A
+		Capture(4);
+		CHECK_EQ(SimPer, per << 1);
+		ok = Pair(HRSIM_TA1, HRSIM_TB1, (h - dt) << 1, (h - dt) << 1, dt << 1, (per - 2 * h + dt) << 1);
+		ok &= Pair(HRSIM_TA2, HRSIM_TB2, dc << 1, dc << 1, (h - dc) << 1, (per - h - dc) << 1);
+		if(!ok)
+			printf("  UpdateHRTIM(%d, %d, %d, %d)\n", per, Half[i], d, dt);
+	}
+	CHECK_EQ(HostErrorCount, 0);
+}
+
+static void Test_Psfb(void)
+{
+	static const uint32_t Dead[] = {0, 2, 160, 1022};
+	uint32_t per, i, ph, d, h, ov, t0, c;
+	int ok;
+
+	for(per = CNTR_MIN; per <= CNTR_MAX; per += 3000)
+	for(i = 0; i < sizeof(Dead) / sizeof(Dead[0]); i++)
+	for(ph = PSFB_PHASE_MIN; ph <= per / 2; ph += per / 10 + 1)
+	{
+		Boot();
+		d = Dead[i];
+		if(Psfb_Init(per, d) != HAL_OK)
+		{
+			CHECK(d >= per / 2);
+			break;
+		}
+		Psfb_SetPhase(ph);
+		// Each leg at 50% less the dead time, both gaps the dead time
+		Capture(4);
+		CHECK_EQ(SimPer, per << 1);
+		h = per / 2 - d;
+		ok = Pair(HRSIM_TA1, HRSIM_TA2, h << 1, h << 1, d << 1, d << 1);
+		ok &= Pair(HRSIM_TB1, HRSIM_TB2, h << 1, h << 1, d << 1, d << 1);
+		ok &= AdcTrig(per);
+		// Leg B behind leg A by the phase, the diagonals on for the phase less the dead time
+		t0 = HrSim_Edge(&Sim, HRSIM_TA1, 1, SimFrom);
+		CHECK_EQ(HrSim_Edge(&Sim, HRSIM_TB1, 1, t0) - t0, ph << 1);
+		ov = (ph > d) ? 2 * (ph - d) << 1 : 0;
+		CHECK_EQ(HrSim_Overlap(&Sim, HRSIM_TA1, HRSIM_TB2, SimFrom, SimFrom + 2 * SimPer), ov);
+		CHECK_EQ(HrSim_Overlap(&Sim, HRSIM_TA2, HRSIM_TB1, SimFrom, SimFrom + 2 * SimPer), ov);
+		if(!ok)
+			printf("  Psfb(%u, %u, %u)\n", per, d, ph);
+	}
+
+	// One count of phase moves leg B by one count
+	Boot();
+	CHECK_EQ(Psfb_Init(PSFB_PERIOD, PSFB_DEAD), HAL_OK);
+	for(ph = 4000; ph <= 4003; ph++)
+	{
+		Psfb_SetPhase(ph);
+		Capture(3);
+		t0 = HrSim_Edge(&Sim, HRSIM_TA1, 1, SimFrom);
+		CHECK_EQ(HrSim_Edge(&Sim, HRSIM_TB1, 1, t0) - t0, ph << 1);
+	}
+
+	// A phase written early in a period applies from the next one
+	Boot();
+	CHECK_EQ(Psfb_Init(PSFB_PERIOD, PSFB_DEAD), HAL_OK);
+	HrSim_Start(&Sim);
+	SimPer = HrSim_Period(HRSIM_TIMA);
+	HrSim_Run(&Sim, 2 * SimPer + 20);
+	Psfb_SetPhase(4000);
+	HrSim_Run(&Sim, 2 * SimPer);
+	CHECK_EQ(HrSim_Edge(&Sim, HRSIM_TB1, 1, 2 * SimPer), 2 * SimPer + ((PSFB_PHASE_MIN + PSFB_DEAD) << 1));
+	CHECK_EQ(HrSim_Edge(&Sim, HRSIM_TB1, 1, 3 * SimPer), 3 * SimPer + ((4000 + PSFB_DEAD) << 1));
+	CHECK_EQ(HrSim_Overlap(&Sim, HRSIM_TB1, HRSIM_TB2, 0, 4 * SimPer), 0);
+
+	// Duty to phase, limited to the smallest phase and half the period
+	CHECK_EQ((Psfb_SetDuty(4096), HRTIM1->sMasterRegs.MCMP1R), PSFB_PERIOD / 2);
+	CHECK_EQ((Psfb_SetDuty(2048), HRTIM1->sMasterRegs.MCMP1R), PSFB_PERIOD / 4);
+	CHECK_EQ((Psfb_SetDuty(5000), HRTIM1->sMasterRegs.MCMP1R), PSFB_PERIOD / 2);
+	CHECK_EQ((Psfb_SetDuty(1), HRTIM1->sMasterRegs.MCMP1R), PSFB_PHASE_MIN);
+	CHECK_EQ((Psfb_SetDuty(-100), HRTIM1->sMasterRegs.MCMP1R), PSFB_PHASE_MIN);
+
+	// The voltage loop drives the phase and leaves the leg compares alone
+	DF.PWMENFlag = 1;
+	CtrValue.BUCKMaxDuty = MAX_BUCK_DUTY;
+	CtrValue.Voref = 2000;
+	ADC1_RESULT[2] = 0;
+	VErr0 = VErr1 = VErr2 = 0;
+	u0 = u1 = u2 = 2048 << 8;
+	BUCKVLoopCtlPID();
+	CHECK_EQ(HRTIM1->sMasterRegs.MCMP1R, Psfb.Phase);
+	CHECK_EQ(Psfb.Phase, CtrValue.BuckDuty * PSFB_PERIOD >> 13);
+	CHECK_EQ(HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A].CMP1xR, PSFB_PERIOD / 2);
+	CHECK_EQ(HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_B].CMP1xR, PSFB_PERIOD / 2);
+	CHECK_EQ(HRTIM1->sCommonRegs.BMCR & HRTIM_BMCR_BME, 0);
+	// Frequency and dead-time setpoints are refused while the bridge runs
+	CHECK(Setp_Post(SETP_FREQ, 90000));
+	Setp_Apply();
+	CHECK_EQ(HRTIM1->sMasterRegs.MPER, PSFB_PERIOD);
+	CHECK_EQ(HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_B].PERxR, PSFB_TIMB_PER);
+	// So are both mode switches, which would reset Timers A and B under the bridge
+	Mode_Switch();
+	Mode_Switch();
+	CHECK_EQ(Psfb.Active, 1);
+	CHECK_EQ(Fm.Active, 0);
+	CHECK_EQ(HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A].PERxR, PSFB_PERIOD);
+	CHECK_EQ(HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_B].PERxR, PSFB_TIMB_PER);
+	// And the direct writers
+	c = HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A].CMP2xR;
+	CHECK_EQ(SetPWMFrequency(90000), HAL_ERROR);
+	CHECK_EQ(RequestPWMFrequency(90000), HAL_BUSY);
+	CHECK_EQ(RequestDeadTime(DEADTIME_MIN_PX1000), 0);
+	SetDeadTimeManual(DEADTIME_MIN_PX1000);
+	CHECK_EQ(SetDutyCycle_TA1_TB1(50), HAL_ERROR);
+	CHECK_EQ(SetDutyCycle_TA2_TB2(25), HAL_ERROR);
+	CHECK_EQ(UpdateHRTIM(PSFB_PERIOD, 8000, 0, 0), HAL_ERROR);
+	CHECK_EQ(HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A].CMP2xR, c);
+	CHECK_EQ(HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A].CMP1xR, PSFB_PERIOD / 2);
+	CHECK_EQ(HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A].PERxR, PSFB_PERIOD);
+	CHECK_EQ(HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_B].PERxR, PSFB_TIMB_PER);
+	// The control period runs the loop on the bridge
+	Psfb_SetPhase(PSFB_PHASE_MIN);
+	VErr0 = VErr1 = VErr2 = 0;
+	u0 = u1 = u2 = 2048 << 8;
+	Control_Period();
+	CHECK(Psfb.Phase > PSFB_PHASE_MIN);
+	CHECK_EQ(Psfb.Phase, CtrValue.BuckDuty * PSFB_PERIOD >> 13);
+	CHECK_EQ(HRTIM1->sMasterRegs.MCMP1R, Psfb.Phase);
+
+	// Refused settings
+	CHECK_EQ(Psfb_Init(CNTR_MIN - 1, PSFB_DEAD), HAL_ERROR);
+	CHECK_EQ(Psfb_Init(CNTR_MAX + 1, PSFB_DEAD), HAL_ERROR);
+	CHECK_EQ(Psfb_Init(PSFB_PERIOD, PSFB_DEAD_MAX + 2), HAL_ERROR);
+	CHECK_EQ(HostErrorCount, 0);
+	// MX_HRTIM1_Init() puts the buck-boost layout back
+	Boot();
+	CHECK_EQ(Psfb.Active, 0);
+}
+
+static void Test_Fm(void)
+{
+	uint32_t i, per, c;
+	int ok;
+
+	// The loop walks the period to either end of the range at MUL8, the legs stay apart
+	for(i = 0; i < 2; i++)
+	{
+		Boot();
+		CHECK_EQ(Fm_Start(), HAL_OK);
+		DF.PWMENFlag = 1;
+		CtrValue.Voref = i ? 0 : 4095;
+		ADC1_RESULT[2] = 2048;
+		Fm.Err1 = 0;
+		for(c = 0; c < 1000; c++)
+			Fm_Step();
+		per = i ? Fm.PerMin : Fm.PerMax;
+		CHECK_EQ(Fm.Per, per);
+		c = per / 2 - 1;
+		Capture(3);
+		CHECK_EQ(SimPer, per << 2);
+		ok = Pair(HRSIM_TA1, HRSIM_TB1, c << 2, (per - c) << 2, 0, 0);
+		ok &= Pair(HRSIM_TA2, HRSIM_TB2, c << 2, (per - c) << 2, 0, 0);
+		ok &= AdcTrig(per);
+		if(!ok)
+			printf("  Fm period %u\n", per);
+	}
+	CHECK_EQ(HostErrorCount, 0);
+}
+
+int main(void)
+{
+	Test_Init();
+	Test_SetPWMFrequency();
+	Test_SetDeadTimeManual();
+	Test_SetDutyCycle();
+	Test_UpdateHRTIM();
+	Test_Psfb();
+	Test_Fm();
+	return TEST_END();
+}
@@ -0,0 +1,412 @@
+/**
+  ******************************************************************************
+  * @file    test_loop.c
+  * @brief   Range, overflow and saturation checks of the control math.
+  *
+  *          ADCSample() is run over every ADC code on every channel and
+  *          BUCKVLoopCtlPID() over every Vout code against a sweep of
+  *          references, from the worst-case error history, then through
+  *          long pseudo-random sequences with rail-to-rail runs, limit and
+  *          enable changes. Each loop step is compared with a 64-bit model
+  *          of the same difference equation and clamps: any int32 overflow
+  *          or int16 truncation in the firmware shows up as a mismatch, and
+  *          the model itself checks that the unclamped output fits int32.
+  *          The model also follows pulse skipping below MIN_BUKC_DUTY and
+  *          checks the pulse duty and which periods the firmware skips.
+  *          The frequency loop is closed around a series-resonant tank
+  *          model and checked for its range, slew limit and windup.
+  ******************************************************************************
+  */
+#include "host.h"
+#include "hrtim.h"
+#include "function.h"
+#include "CtlLoop.h"
+#include "CtlCoef.h"
+#include "burst.h"
+#include "fm.h"
+#include "setp.h"
+#include "math.h"
+#include "test.h"
+
+TEST_DEFINE();
+
+#define TIMA	HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A]
+#define TIMB	HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_B]
+
+#define VOUT_MAX	((4095 * CAL_VOUT_K >> 12) + CAL_VOUT_B)	// Calibrated Vout of the top ADC code
+#define ERR_MAX		VOUT_MAX								// Largest |Voref - Vout| for Voref 0~4095
+#define ABS(x)		((x) < 0 ? -(x) : (x))
+// Largest |u0| the loop can form with u1, u2 within the duty limits, the bound CtlCoef.h states
+#define U0_BOUND	((int64_t)(ABS(BUCKPIDb0) + ABS(BUCKPIDb1) + ABS(BUCKPIDb2)) * ERR_MAX + (MAX_BUCK_DUTY << 8) \
+	+ ((int64_t)ABS(BUCKPIDa) * ((MAX_BUCK_DUTY << 8) - VLOOP_U_MIN) >> 10))
+
+// 64-bit model of BUCKVLoopCtlPID()
+struct _MODEL
+{
+	int64_t		Err1;
+	int64_t		Err2;
+	int64_t		U1;
+	int64_t		U2;
+	int64_t		Peak;//Largest |u0| before the clamp
+	uint8_t		Pfm;//1 while skipping pulses
+	int64_t		Acc;//Output summed since the last pulse
+};
+
+static struct _MODEL Model;
+static uint32_t Seed = 1;
+
+static uint32_t Rand(uint32_t n)
+{
+	Seed = Seed * 1664525 + 1013904223;
+	return (Seed >> 8) % n;
+}
+
+// Put the firmware and the model into the same history
+static void Loop_Set(int32_t e1, int32_t e2, int32_t v1, int32_t v2)
+{
+	VErr1 = e1;
+	VErr2 = e2;
+	u1 = v1;
+	u2 = v2;
+	Model.Err1 = e1;
+	Model.Err2 = e2;
+	Model.U1 = v1;
+	Model.U2 = v2;
+}
+
+/** ===================================================================
+**     Function Name : static int Loop_Step(uint16_t code)
+**     Description : Run one loop step on a Vout ADC code in the firmware
+**       and in the model and compare the state, the duty and the
+**       compare registers. The first mismatch is printed.
+**     Parameters  : code - Vout ADC code, 0~4095
+**     Returns     : 1 if firmware and model agree
+** ===================================================================*/
+static int Loop_Step(uint16_t code)
+{
+	static int Reported = 0;
+	int64_t v = ((int64_t)code * CAL_VOUT_K >> 12) + CAL_VOUT_B;
+	int64_t e0 = CtrValue.Voref - v;
+	int64_t u = Model.U1 + e0 * BUCKPIDb0 + Model.Err1 * BUCKPIDb1 + Model.Err2 * BUCKPIDb2
+		+ ((BUCKPIDa * (Model.U1 - Model.U2)) >> 10);
+	int64_t duty;
+	uint8_t skip = 0;
+	int ok;
+
+	if(u > Model.Peak || -u > Model.Peak)
+		Model.Peak = u < 0 ? -u : u;
+	if(u > (int64_t)CtrValue.BUCKMaxDuty << 8)
+		u = (int64_t)CtrValue.BUCKMaxDuty << 8;
+	if(DF.PWMENFlag == 0)
+		u = MIN_BUKC_DUTY << 8;
+	else if(u < VLOOP_U_MIN)
+		u = VLOOP_U_MIN;
+	Model.Err2 = Model.Err1;
+	Model.Err1 = e0;
+	Model.U2 = Model.U1;
+	Model.U1 = u;
+	duty = u >> 8;
+#if PFM_ENABLE
+	// Pulse skipping from below MIN_BUKC_DUTY up to PFM_DUTY
+	if(DF.PWMENFlag == 0 || u > PFM_DUTY << 8)
+		Model.Pfm = 0;
+	else if(Model.Pfm || u < MIN_BUKC_DUTY << 8)
+	{
+		if(!Model.Pfm)
+			Model.Acc = 0;
+		Model.Pfm = 1;
+		Model.Acc += u;
+		if(Model.Acc >= PFM_DUTY << 8)
+			Model.Acc -= PFM_DUTY << 8;
+		else
+			skip = 1;
+		duty = PFM_DUTY;
+	}
+#endif
+	if(duty > CtrValue.BUCKMaxDuty)
+		duty = CtrValue.BUCKMaxDuty;
+	if(duty < MIN_BUKC_DUTY)
+		duty = MIN_BUKC_DUTY;
+
+	ADC1_RESULT[2] = code;
+	HRTIM1->sCommonRegs.BMTRGR = 0;
+	BUCKVLoopCtlPID();
+
+	ok = u1 == Model.U1 && u2 == Model.U2 && VErr1 == Model.Err1 && VErr2 == Model.Err2 && CtrValue.BuckDuty == duty
+		&& TIMA.CMP1xR == (uint32_t)(duty * PERIOD >> 12) && TIMA.CMP3xR == TIMA.CMP1xR >> 1
+		&& TIMB.CMP1xR == PERIOD - (MIN_BOOST_DUTY1 * PERIOD >> 12)
+		&& Burst.Pfm == Model.Pfm && !(HRTIM1->sCommonRegs.BMTRGR & HRTIM_BMTRGR_SW) == !skip;
+	if(!ok && !Reported++)
+		printf("  code %u Voref %d max %d en %u: u1 %d/%lld duty %d/%lld\n", code, (int)CtrValue.Voref,
+			CtrValue.BUCKMaxDuty, DF.PWMENFlag, (int)u1, (long long)Model.U1, CtrValue.BuckDuty, (long long)duty);
+	return ok;
+}
+
+static void Boot(void)
+{
+	Host_Reset();
+	MX_HRTIM1_Init();
+	CtrValue.BUCKMaxDuty = MAX_BUCK_DUTY;
+	CtrValue.Voref = VOUT_REF_SET;
+	DF.PWMENFlag = 1;
+	Loop_Set(0, 0, 0, 0);
+	Model.Peak = 0;
+	Model.Pfm = 0;
+}
+
+static void Test_AdcRange(void)
+{
+	uint32_t code, v, i;
+	int ok = 1;
+
+	Host_Reset();
+	for(code = 0; code < 4096; code++)
+	{
+		ADC1_RESULT[0] = ADC1_RESULT[1] = ADC1_RESULT[2] = ADC1_RESULT[3] = code;
+		for(i = 0; i < 48; i++)//Settle the moving averages
+			ADCSample();
+		v = (code * CAL_VIN_K >> 12) + CAL_VIN_B;
+		ok &= SADC.Vin == (v < 100 ? 0 : (int32_t)v);
+		ok &= SADC.VinAvg <= SADC.Vin && SADC.VinAvg >= SADC.Vin - 3;
+		v = (code * CAL_IIN_K >> 12) + CAL_IIN_B;
+		ok &= SADC.Iin == (v < 2048 ? 2048 : (int32_t)v);
+		ok &= SADC.IinAvg <= SADC.Iin && SADC.IinAvg >= SADC.Iin - 3;
+		v = (code * CAL_VOUT_K >> 12) + CAL_VOUT_B;
+		ok &= SADC.Vout == (v < 100 ? 0 : (int32_t)v);
+		ok &= SADC.VoutAvg <= SADC.Vout && SADC.VoutAvg >= SADC.Vout - 3;
+		v = (code * CAL_IOUT_K >> 12) + CAL_IOUT_B;
+		ok &= SADC.Iout == (v < 2048 ? 2048 : (int32_t)v);
+		ok &= SADC.IoutAvg <= SADC.Iout && SADC.IoutAvg >= SADC.Iout - 3;
+		if(!ok)
+		{
+			printf("  ADCSample code %u\n", code);
+			break;
+		}
+	}
+	CHECK(ok);
+
+	// Rail-to-rail steps: the averages stay within the calibrated range
+	for(i = 0; i < 100000 && ok; i++)
+	{
+		code = Rand(2) ? 4095 : 0;
+		ADC1_RESULT[0] = ADC1_RESULT[1] = ADC1_RESULT[2] = ADC1_RESULT[3] = code;
+		ADCSample();
+		ok = SADC.VoutAvg >= 0 && SADC.VoutAvg <= VOUT_MAX && SADC.IoutAvg >= 2048 && SADC.IoutAvg <= 4095 + CAL_IOUT_B;
+	}
+	CHECK(ok);
+}
+
+static void Test_LoopRange(void)
+{
+	// Histories that push u0 furthest either way
+	static const int32_t Hist[4][4] = {
+		{-ERR_MAX, ERR_MAX, MAX_BUCK_DUTY << 8, VLOOP_U_MIN}, {ERR_MAX, -ERR_MAX, VLOOP_U_MIN, MAX_BUCK_DUTY << 8},
+		{0, 0, MAX_BUCK_DUTY << 8, MAX_BUCK_DUTY << 8}, {0, 0, VLOOP_U_MIN, VLOOP_U_MIN},
+	};
+	int32_t voref;
+	uint32_t code, h;
+	int ok = 1;
+
+	Boot();
+	for(voref = 0; voref < 4096 && ok; voref += 5)
+	for(h = 0; h < 4 && ok; h++)
+	for(code = 0; code < 4096 && ok; code++)
+	{
+		CtrValue.Voref = voref;
+		Loop_Set(Hist[h][0], Hist[h][1], Hist[h][2], Hist[h][3]);
+		ok = Loop_Step(code);
+	}
+	CHECK(ok);
+	// The worst case reaches the stated bound, which fits int32
+	CHECK(Model.Peak <= U0_BOUND);
+	CHECK(U0_BOUND < (1LL << 31));
+}
+
+static void Test_LoopFuzz(void)
+{
+	uint32_t i, run = 0;
+	uint16_t code = 0;
+	int ok = 1;
+
+	Boot();
+	Seed = 43;
+	for(i = 0; i < 2000000 && ok; i++)
+	{
+		if(run == 0)
+		{
+			// A new input: mostly near the reference, or a run at a rail
+			run = 1 + Rand(2000);
+			switch(Rand(4))
+			{
+				case 0: code = 0; break;
+				case 1: code = 4095; break;
+				case 2: code = Rand(4096); break;
+				default: code = (uint16_t)(CtrValue.Voref < 4032 ? CtrValue.Voref + Rand(64) : 4095); break;
+			}
+			if(Rand(8) == 0)
+				CtrValue.Voref = Rand(4096);
+			if(Rand(16) == 0)
+				CtrValue.BUCKMaxDuty = MIN_BUKC_DUTY + Rand(MAX_BUCK_DUTY - MIN_BUKC_DUTY + 1);
+			if(Rand(32) == 0)
+				DF.PWMENFlag = !DF.PWMENFlag;
+		}
+		run--;
+		ok = Loop_Step(Rand(4) == 0 ? Rand(4096) : code);
+		ok &= CtrValue.BuckDuty >= MIN_BUKC_DUTY && CtrValue.BuckDuty <= CtrValue.BUCKMaxDuty;
+		ok &= u1 >= VLOOP_U_MIN && u1 <= CtrValue.BUCKMaxDuty << 8;
+	}
+	CHECK(ok);
+	CHECK(Model.Peak < (1LL << 31));
+}
+
+static void Test_Windup(void)
+{
+	uint32_t i;
+	int ok = 1;
+
+	// Vout held at 0 for 20s at the full reference, e.g. a shorted output
+	Boot();
+	for(i = 0; i < 2000000 && ok; i++)
+		ok = Loop_Step(0);
+	CHECK(ok);
+	CHECK_EQ(u1, MAX_BUCK_DUTY << 8);
+	CHECK_EQ(CtrValue.BuckDuty, MAX_BUCK_DUTY);
+	// The duty comes off the limit as soon as Vout goes past the reference
+	Loop_Step(VOUT_REF_SET + 100);
+	CHECK(CtrValue.BuckDuty < MAX_BUCK_DUTY);
+
+	// Vout held above the reference: the output goes below MIN_BUKC_DUTY and every period is skipped
+	for(i = 0; i < 100000 && ok; i++)
+		ok = Loop_Step(VOUT_REF_SET + 100);
+	CHECK(ok);
+	CHECK_EQ(u1, VLOOP_U_MIN);
+#if PFM_ENABLE
+	CHECK_EQ(Burst.Pfm, 1);
+	CHECK(HRTIM1->sCommonRegs.BMTRGR & HRTIM_BMTRGR_SW);
+#endif
+
+	// Output off: the loop rests at the minimum and restarts from there
+	DF.PWMENFlag = 0;
+	for(i = 0; i < 1000; i++)
+		Loop_Step(0);
+	CHECK_EQ(u1, MIN_BUKC_DUTY << 8);
+	DF.PWMENFlag = 1;
+	Loop_Step(0);
+	CHECK(CtrValue.BuckDuty > MIN_BUKC_DUTY && CtrValue.BuckDuty < MAX_BUCK_DUTY);
+}
+
+// Series-resonant tank above resonance: Vout follows Vin times the tank gain with a lag
+#define TANK_FR		65000.0		// Resonant frequency, Hz
+#define TANK_VIN	3000.0		// Q12 Vout at unity gain
+#define TANK_LAG	30.0		// Output filter, control periods
+
+static double TankQ;//Quality factor, rises with the load
+static double TankVout;//Q12
+
+// One control period of the tank at the period the loop has written, then the Vout sample
+static void Tank_Step(void)
+{
+	double x = (double)Fm_FreqHz() / TANK_FR;
+	double g = 1.0 / sqrt(1.0 + TankQ * TankQ * (x - 1.0 / x) * (x - 1.0 / x));
+	double code;
+
+	TankVout += (TANK_VIN * g - TankVout) / TANK_LAG;
+	code = (TankVout - CAL_VOUT_B) * 4096.0 / CAL_VOUT_K;
+	ADC1_RESULT[2] = (code < 0) ? 0 : (code > 4095) ? 4095 : (uint16_t)code;
+}
+
+// Run the loop and check its limits each period
+// Returns the periods until Vout settled within 1% for good, n if it did not
+static uint32_t Fm_Run(uint32_t n)
+{
+	uint32_t i, settled = n;
+	uint16_t per;
+	int32_t vout;
+
+	for(i = 0; i < n; i++)
+	{
+		per = Fm.Per;
+		Tank_Step();
+		Fm_Step();
+		// The slew limit holds while the output is on
+		if((DF.PWMENFlag && (Fm.Per > per + FM_SLEW || Fm.Per + FM_SLEW < per)) || Fm.Per < Fm.PerMin || Fm.Per > Fm.PerMax ||
+			TIMA.PERxR != Fm.Per || TIMB.PERxR != Fm.Per || TIMA.CMP2xR != Fm.Per / 2u - 1 || TIMB.CMP2xR != Fm.Per / 2u - 1)
+		{
+			CHECK(0);
+			printf("  period %u: %u -> %u\n", i, per, Fm.Per);
+			return n;
+		}
+		vout = ((uint32_t)ADC1_RESULT[2] * CAL_VOUT_K >> 12) + CAL_VOUT_B;
+		if(ABS(vout - (int32_t)CtrValue.Voref) > 41)
+			settled = n;
+		else if(settled == n)
+			settled = i;
+	}
+	return settled;
+}
+
+static void Test_Fm(void)
+{
+	uint32_t t;
+
+	Boot();
+	CHECK_EQ(Fm_Start(), HAL_OK);
+	CHECK_EQ(TIMA.TIMxCR & HRTIM_TIMCR_CK_PSC, HRTIM_PRESCALERRATIO_MUL8);
+	CHECK_EQ(TIMA.PERxR, 8000);//100kHz at MUL8
+	CHECK_EQ(Fm.PerMin, 6153);//130kHz
+	CHECK_EQ(Fm.PerMax, 11428);//70kHz
+	TankQ = 1.0;
+	TankVout = 0;
+
+	// Output off: waits at the top frequency
+	DF.PWMENFlag = 0;
+	Fm_Run(10);
+	CHECK_EQ(Fm.Per, Fm.PerMin);
+
+	// Settles from there within 1% and stays, the slew limit holding the first steps
+	DF.PWMENFlag = 1;
+	t = Fm_Run(10000);
+	CHECK(t < 500);
+	CHECK(Fm.SlewCnt > 0);
+	CHECK(Fm.Per > Fm.PerMin && Fm.Per < Fm.PerMax);
+
+	// Heavier load, lower tank gain: the frequency comes down and Vout recovers
+	TankQ = 2.0;
+	t = Fm_Run(10000);
+	CHECK(t < 500);
+	CHECK(Fm_FreqHz() < 100000);
+
+	// Out of reach: held at the lowest frequency without winding up
+	CtrValue.Voref = 4000;
+	Fm_Run(20000);
+	CHECK_EQ(Fm.Per, Fm.PerMax);
+	CHECK_EQ(Fm.U, (int32_t)Fm.PerMax << 8);
+	CtrValue.Voref = VOUT_REF_SET;
+	t = Fm_Run(10000);
+	CHECK(t < 500);
+
+	// The frequency belongs to the loop: key, command and queued changes are refused
+	CHECK_EQ(RequestPWMFrequency(90000), HAL_BUSY);
+	t = Fm.Per;
+	CHECK(Setp_Post(SETP_FREQ, 90000));
+	Setp_Apply();
+	CHECK_EQ(TIMA.PERxR, t);
+
+	// Back to open loop: the period stays until SetPWMFrequency(), the loop no longer writes it
+	Fm_Stop();
+	CHECK_EQ(SetPWMFrequency(100000), HAL_OK);
+	CHECK_EQ(TIMA.PERxR, 16000);
+	Fm_Step();
+	CHECK_EQ(TIMA.PERxR, 16000);
+	CHECK_EQ(HostErrorCount, 0);
+}
+
+int main(void)
+{
+	Test_AdcRange();
+	Test_LoopRange();
+	Test_LoopFuzz();
+	Test_Windup();
+	Test_Fm();
+	return TEST_END();
+}
@@ -0,0 +1,261 @@
+/**
+  ******************************************************************************
+  * @file    test_plant.c
+  * @brief   Closed-loop tests of the voltage loop on the simulated stage.
+  *
+  *          The control ISR runs Control_Period(), the voltage loop with
+  *          it, once per PWM period against the plant; Protect_Task() and
+  *          SoftStart_Task() run at their scheduler rates. Soft start,
+  *          load and line steps and a PWM frequency change are checked for
+  *          overshoot and settling time, the refused switch to closed-loop
+  *          mode for leaving the stage alone, light-load
+  *          burst mode for idle periods and its exit on a load step,
+  *          pulse skipping below the minimum duty and its hand-back, and
+  *          the software protections for tripping and shutting the stage off.
+  ******************************************************************************
+  */
+#include "host.h"
+#include "rig.h"
+#include "hrtim.h"
+#include "function.h"
+#include "burst.h"
+#include "fm.h"
+#include "test.h"
+
+TEST_DEFINE();
+
+#define SHORT_TRIP_MAX	(SHORT_TRIP_CNT + 1)	// Control periods from the short to F_SW_SHORT, SHORT_TRIP_CNT plus the current rise
+
+extern SState_M STState;
+
+static void Test_SoftStart(uint8_t model)
+{
+	double v;
+
+	Rig_Start(model);
+	v = Rig_Target();
+	CHECK_EQ(HostErrorCount, 0);
+	CHECK_EQ(DF.SMFlag, Run);
+	CHECK_EQ(DF.ErrFlag, F_NOERR);
+	CHECK_EQ(CtrValue.Voref, VOUT_REF_SET);
+	Plant_Watch(&Rig.Plant, v, v * 0.01);
+	Rig_Advance(20);
+	CHECK(Plant_Settle(&Rig.Plant) == 0);//Stays within 1%
+}
+
+static void Test_LoadStep(uint8_t model)
+{
+	double v;
+
+	Rig_Start(model);
+	v = Rig_Target();
+	// 1A to 2A
+	Rig.Plant.Cfg.Rload = 6.0;
+	Plant_Watch(&Rig.Plant, v, v * 0.01);
+	Rig_Advance(20);
+	CHECK(Rig.Plant.Min > v * 0.95);
+	CHECK(Plant_Settle(&Rig.Plant) < 5e-3);
+	// And back
+	Rig.Plant.Cfg.Rload = 12.0;
+	Plant_Watch(&Rig.Plant, v, v * 0.01);
+	Rig_Advance(20);
+	CHECK(Rig.Plant.Max < v * 1.05);
+	CHECK(Plant_Settle(&Rig.Plant) < 5e-3);
+	CHECK_EQ(DF.ErrFlag, F_NOERR);
+}
+
+static void Test_LineStep(uint8_t model)
+{
+	double v;
+
+	Rig_Start(model);
+	v = Rig_Target();
+	// 24V to 20V, the voltage loop sees it only through Vout
+	Rig.Plant.Cfg.Vin = 20.0;
+	Plant_Watch(&Rig.Plant, v, v * 0.01);
+	Rig_Advance(30);
+	CHECK(Rig.Plant.Min > v * 0.85);
+	CHECK(Plant_Settle(&Rig.Plant) < 20e-3);
+	Rig.Plant.Cfg.Vin = 24.0;
+	Plant_Watch(&Rig.Plant, v, v * 0.01);
+	Rig_Advance(30);
+	CHECK(Rig.Plant.Max < v * 1.15);
+	CHECK(Plant_Settle(&Rig.Plant) < 20e-3);
+	CHECK_EQ(DF.ErrFlag, F_NOERR);
+}
+
+static void Test_ModeSwitch(void)
+{
+	double v;
+
+	Rig_Start(PLANT_AVERAGED);
+	v = Rig_Target();
+	// A period change scales the duty the loop writes, the loop takes it up
+	CHECK_EQ(RequestPWMFrequency(120000), HAL_OK);
+	Plant_Watch(&Rig.Plant, v, v * 0.01);
+	Rig_Advance(20);
+	CHECK_EQ(HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A].PERxR, 1600000000UL / 120000);
+	CHECK(Rig.Plant.Max < v * 1.25);
+	CHECK(Plant_Settle(&Rig.Plant) < 10e-3);
+	// Closed-loop mode is refused on the buck-boost stage: the frequency loop
+	// would fight the duty loop. Neither switch touches the timers or the output.
+	Mode_Switch();
+	Plant_Watch(&Rig.Plant, v, v * 0.01);
+	Rig_Advance(20);
+	CHECK_EQ(Fm.Active, 0);
+	Mode_Switch();
+	Rig_Advance(20);
+	CHECK_EQ(Fm.Active, 0);
+	CHECK_EQ(HRTIM1->sTimerxRegs[HRTIM_TIMERINDEX_TIMER_A].PERxR, 1600000000UL / 120000);
+	CHECK(Rig.Plant.Min > v * 0.99);
+	CHECK(Rig.Plant.Max < v * 1.01);
+	CHECK_EQ(HostErrorCount, 0);
+	CHECK_EQ(DF.ErrFlag, F_NOERR);
+}
+
+static void Test_Burst(uint8_t model)
+{
+	double v;
+	uint32_t per, sw;
+
+	Rig_Start(model);
+	v = Rig_Target();
+	// 20mA: the loop goes to burst mode and most periods stay idle
+	Rig.Plant.Cfg.Rload = 0;
+	Rig.Plant.Cfg.Iload = 0.02;
+	Rig_Advance(20);
+	CHECK_EQ(Burst.Active, 1);
+	CHECK_EQ(Burst.Entries, 1);
+	per = Rig.Plant.Periods;
+	sw = Rig.Plant.Switching;
+	Plant_Watch(&Rig.Plant, v, v * 0.03);
+	Rig_Advance(50);
+	CHECK((Rig.Plant.Switching - sw) * 2 < Rig.Plant.Periods - per);
+	CHECK(Plant_Settle(&Rig.Plant) == 0);//Within 3% throughout
+	CHECK(Burst.Idle > 0);
+	// Back to 1A: out of burst mode and regulating at once
+	Rig.Plant.Cfg.Rload = 12.0;
+	Rig.Plant.Cfg.Iload = 0;
+	Plant_Watch(&Rig.Plant, v, v * 0.01);
+	per = Rig.Plant.Periods;
+	sw = Rig.Plant.Switching;
+	Rig_Advance(20);
+	CHECK_EQ(Burst.Active, 0);
+	CHECK(Rig.Plant.Min > v * 0.95);
+	CHECK(Plant_Settle(&Rig.Plant) < 5e-3);
+	CHECK(Rig.Plant.Periods - Rig.Plant.Switching < per - sw + 2 * BURST_IDLE);//At most the burst in progress
+	CHECK_EQ(DF.ErrFlag, F_NOERR);
+}
+
+static void Test_Pfm(uint8_t model)
+{
+	double v, v0;
+	uint32_t per, sw, n;
+
+	Rig_Start(model);
+	v = Rig_Target();
+	CHECK(Burst.PfmEntries > 0);
+	CHECK_EQ(Burst.Pfm, 0);
+	// Restart the soft start: at Voref 0 with the output enabled most periods are skipped
+	// rather than switched at MIN_BUKC_DUTY, and Vout falls from where that held it
+	STState = SSInit;
+	Rig_Advance(110);
+	CHECK_EQ(DF.PWMENFlag, 1);
+	CHECK_EQ(CtrValue.Voref, 0);
+	v0 = Rig.Plant.Vout;
+	Rig_Advance(2);
+	per = Rig.Plant.Periods;
+	sw = Rig.Plant.Switching;
+	n = Burst.PfmEntries;
+	Rig_Advance(7);
+	CHECK_EQ(CtrValue.Voref, 0);
+	CHECK_EQ(Burst.Pfm, 1);
+	CHECK_EQ(Burst.PfmEntries, n);//Held in, no chatter on the ADC noise
+	CHECK((Rig.Plant.Switching - sw) * 5 < Rig.Plant.Periods - per);
+	CHECK(Rig.Plant.Vout < v0 * 0.8);
+	// Up the ramp and back to fixed frequency
+	Rig_Advance(600);
+	CHECK_EQ(Burst.Pfm, 0);
+	per = Rig.Plant.Periods;
+	sw = Rig.Plant.Switching;
+	n = Burst.Skips;
+	Plant_Watch(&Rig.Plant, v, v * 0.01);
+	Rig_Advance(10);
+	CHECK_EQ(Rig.Plant.Switching - sw, Rig.Plant.Periods - per);
+	CHECK_EQ(Burst.Skips, n);
+	CHECK(Plant_Settle(&Rig.Plant) == 0);
+	CHECK_EQ(DF.ErrFlag, F_NOERR);
+}
+
+static void Test_Ocp(void)
+{
+	Rig_Start(PLANT_AVERAGED);
+	Rig.Plant.Cfg.Rload = 2.0;//About 6A, over IOUT_OCP_VAL and under IOUT_SHORT_VAL
+	Rig_Advance(30);
+	CHECK(DF.ErrFlag & F_SW_IOUT_OCP);
+	CHECK_EQ(DF.ErrFlag & F_SW_SHORT, 0);
+	CHECK_EQ(DF.SMFlag, Err);
+	CHECK_EQ(Host_HrtimOutputs() & (HRTIM_OUTPUT_TA1 | HRTIM_OUTPUT_TB1), 0);
+	// Latched: the stage stays off and the output discharges
+	Rig_Advance(100);
+	CHECK(Rig.Plant.Vout < 0.1);
+	CHECK_EQ(DF.PWMENFlag, 0);
+}
+
+static uint32_t ShortPeriods;//Control periods from the short to the trip
+
+static void Short_Probe(void)
+{
+	if(!(DF.ErrFlag & F_SW_SHORT))
+		ShortPeriods++;
+}
+
+static void Test_Short(uint8_t model)
+{
+	Rig_Start(model);
+	Rig.Plant.Cfg.Rload = 0.05;
+	ShortPeriods = 0;
+	Rig.Probe = Short_Probe;
+	Rig_Advance(1);
+	Rig.Probe = 0;
+	// Tripped in the ISR within a few periods of the current reaching full scale
+	CHECK(DF.ErrFlag & F_SW_SHORT);
+	CHECK(ShortPeriods <= SHORT_TRIP_MAX);
+	CHECK_EQ(DF.ErrFlag & F_SW_IOUT_OCP, 0);
+	CHECK_EQ(DF.SMFlag, Err);
+	CHECK_EQ(Host_HrtimOutputs() & (HRTIM_OUTPUT_TA1 | HRTIM_OUTPUT_TB1), 0);
+	if(ShortPeriods > SHORT_TRIP_MAX)
+		printf("  Short trip after %u periods\n", (unsigned)ShortPeriods);
+	Rig_Advance(100);
+	CHECK_EQ(DF.PWMENFlag, 0);
+}
+
+static void Test_Ovp(void)
+{
+	Rig_Start(PLANT_AVERAGED);
+	CtrValue.Voref = VOUT_OVP_VAL + 200;//A reference past the threshold must still trip
+	Rig_Advance(30);
+	CHECK(DF.ErrFlag & F_SW_VOUT_OVP);
+	CHECK_EQ(Host_HrtimOutputs() & (HRTIM_OUTPUT_TA1 | HRTIM_OUTPUT_TB1), 0);
+	CHECK(Rig.Plant.Vout < (double)VOUT_OVP_VAL / Rig.Plant.Cfg.VoutGain * 1.1);
+}
+
+int main(void)
+{
+	Test_SoftStart(PLANT_AVERAGED);
+	Test_SoftStart(PLANT_SWITCHING);
+	Test_LoadStep(PLANT_AVERAGED);
+	Test_LoadStep(PLANT_SWITCHING);
+	Test_LineStep(PLANT_AVERAGED);
+	Test_LineStep(PLANT_SWITCHING);
+	Test_ModeSwitch();
+	Test_Burst(PLANT_AVERAGED);
+	Test_Burst(PLANT_SWITCHING);
+	Test_Pfm(PLANT_AVERAGED);
+	Test_Pfm(PLANT_SWITCHING);
+	Test_Ocp();
+	Test_Short(PLANT_AVERAGED);
+	Test_Short(PLANT_SWITCHING);
+	Test_Ovp();
+	return TEST_END();
+}
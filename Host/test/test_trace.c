@@ -0,0 +1,312 @@
+/**
+  ******************************************************************************
+  * @file    test_trace.c
+  * @brief   Golden-trace regression of the closed loop on the simulated stage.
+  *
+  *          Each scenario records Vout, Iout, the buck duty and the state
+  *          flags every few PWM periods and compares them with the trace
+  *          kept in golden/: every point must lie in the band the golden
+  *          trace spans over the neighbouring points, widened by a fixed
+  *          tolerance, and the peaks and settling time must match within
+  *          the same tolerances. A change to the loop, the protections or
+  *          the calibration that alters the dynamics fails here. The loop
+  *          runs from Control_Period() as in a VLOOP_BUCKBOOST firmware
+  *          build, pulse skipping and burst mode included; the traces say
+  *          nothing about this board's bridge layout, where it is off.
+  *
+  *          test_trace <golden dir>            compare
+  *          test_trace --record <golden dir>   write new golden traces
+  ******************************************************************************
+  */
+#include "host.h"
+#include "rig.h"
+#include "function.h"
+#include "test.h"
+#include "string.h"
+
+TEST_DEFINE();
+
+#define TRACE_MAX		1024	// Points per scenario
+
+/***************************** Tolerances *****************/
+#define TOL_VOUT		0.1		// V
+#define TOL_IOUT		0.1		// A
+#define TOL_DUTY		40		// Q12, 1%
+#define TOL_SETTLE		1e-3	// s
+#define TOL_SLACK		2		// Points either side a golden point may be matched against
+#define SETTLE_BAND		0.01	// Settled within +-1% of the target
+#define TRIP_SHORT		100e-6	// s from the short to the first point with F_SW_SHORT, at most
+
+struct _TRACE_PT
+{
+	double		T;//Since the scenario start, s
+	double		Vout;//V
+	double		Iout;//A
+	int			Duty;//CtrValue.BuckDuty
+	int			State;//DF.SMFlag
+	int			Err;//DF.ErrFlag
+};
+
+struct _TRACE
+{
+	int			Num;
+	struct _TRACE_PT	Pt[TRACE_MAX];
+};
+
+// Response figures of a trace
+struct _METRIC
+{
+	double		Max;//Highest Vout, V
+	double		Min;//Lowest Vout, V
+	double		Settle;//Last time outside the settling band, s
+};
+
+static struct _TRACE Trace, Golden;
+static uint32_t TraceDecim;//Periods per point
+static uint32_t TraceCnt;
+static double TraceT0;
+
+static void Trace_Probe(void)
+{
+	struct _TRACE_PT *p;
+
+	if(++TraceCnt < TraceDecim || Trace.Num >= TRACE_MAX)
+		return;
+	TraceCnt = 0;
+	p = &Trace.Pt[Trace.Num++];
+	p->T = Rig.Plant.Time - TraceT0;
+	p->Vout = Rig.Plant.Vout;
+	p->Iout = Rig.Plant.Iout;
+	p->Duty = CtrValue.BuckDuty;
+	p->State = DF.SMFlag;
+	p->Err = DF.ErrFlag;
+}
+
+// Record from now on, one point every decim periods
+static void Trace_Begin(uint32_t decim)
+{
+	Trace.Num = 0;
+	TraceDecim = decim;
+	TraceCnt = 0;
+	TraceT0 = Rig.Plant.Time;
+	Rig.Probe = Trace_Probe;
+}
+
+/***************************** Scenarios *****************/
+static void Scn_SoftStart(void)
+{
+	Trace_Begin(100);
+	Rig_Start(PLANT_AVERAGED);
+	Rig_Advance(20);
+}
+
+static void Scn_LoadStep(void)
+{
+	Rig_Start(PLANT_AVERAGED);
+	Trace_Begin(5);
+	Rig_Advance(2);
+	Rig.Plant.Cfg.Rload = 6.0;
+	Rig_Advance(20);
+	Rig.Plant.Cfg.Rload = 12.0;
+	Rig_Advance(20);
+}
+
+static void Scn_LineStep(void)
+{
+	Rig_Start(PLANT_AVERAGED);
+	Trace_Begin(10);
+	Rig_Advance(2);
+	Rig.Plant.Cfg.Vin = 20.0;
+	Rig_Advance(30);
+	Rig.Plant.Cfg.Vin = 24.0;
+	Rig_Advance(30);
+}
+
+static void Scn_Short(void)
+{
+	double t;
+	int i;
+
+	Rig_Start(PLANT_AVERAGED);
+	Trace_Begin(5);
+	Rig_Advance(2);
+	Rig.Plant.Cfg.Rload = 0.05;
+	t = Rig.Plant.Time - TraceT0;
+	Rig_Advance(30);
+	// Whatever the golden trace says, the stage must be off within TRIP_SHORT
+	for(i = 0; i < Trace.Num && !(Trace.Pt[i].Err & F_SW_SHORT); i++)
+		;
+	CHECK(i < Trace.Num && Trace.Pt[i].T - t <= TRIP_SHORT);
+}
+
+static void Scn_ModeChange(void)
+{
+	Rig_Start(PLANT_AVERAGED);
+	Trace_Begin(10);
+	Rig_Advance(2);
+	RequestPWMFrequency(120000);
+	Rig_Advance(20);
+	Mode_Switch(); // Refused on the buck-boost stage, nothing moves
+	Rig_Advance(10);
+	Mode_Switch();
+	Rig_Advance(10);
+}
+
+static const struct
+{
+	const char	*Name;
+	void		(*Run)(void);
+} Scn[] = {
+	{"softstart", Scn_SoftStart},
+	{"loadstep", Scn_LoadStep},
+	{"linestep", Scn_LineStep},
+	{"short", Scn_Short},
+	{"modechange", Scn_ModeChange},
+};
+
+/***************************** Files *****************/
+static int Trace_Write(const char *path, const struct _TRACE *t)
+{
+	FILE *f = fopen(path, "w");
+	int i;
+
+	if(!f)
+		return 0;
+	fprintf(f, "# t_s,vout_v,iout_a,duty,state,err\n");
+	for(i = 0; i < t->Num; i++)
+		fprintf(f, "%.6f,%.4f,%.4f,%d,%d,%d\n", t->Pt[i].T, t->Pt[i].Vout, t->Pt[i].Iout,
+			t->Pt[i].Duty, t->Pt[i].State, t->Pt[i].Err);
+	fclose(f);
+	return 1;
+}
+
+static int Trace_Read(const char *path, struct _TRACE *t)
+{
+	FILE *f = fopen(path, "r");
+	struct _TRACE_PT *p;
+	char line[128];
+
+	if(!f)
+		return 0;
+	t->Num = 0;
+	while(fgets(line, sizeof(line), f) && t->Num < TRACE_MAX)
+	{
+		p = &t->Pt[t->Num];
+		if(line[0] != '#' && sscanf(line, "%lf,%lf,%lf,%d,%d,%d", &p->T, &p->Vout, &p->Iout,
+			&p->Duty, &p->State, &p->Err) == 6)
+			t->Num++;
+	}
+	fclose(f);
+	return 1;
+}
+
+/***************************** Comparison *****************/
+static void Trace_Metric(const struct _TRACE *t, double target, struct _METRIC *m)
+{
+	int i;
+
+	m->Max = m->Min = t->Num ? t->Pt[0].Vout : 0;
+	m->Settle = 0;
+	for(i = 0; i < t->Num; i++)
+	{
+		if(t->Pt[i].Vout > m->Max)
+			m->Max = t->Pt[i].Vout;
+		if(t->Pt[i].Vout < m->Min)
+			m->Min = t->Pt[i].Vout;
+		if(t->Pt[i].Vout > target * (1 + SETTLE_BAND) || t->Pt[i].Vout < target * (1 - SETTLE_BAND))
+			m->Settle = t->Pt[i].T;
+	}
+}
+
+/** ===================================================================
+**     Function Name : static int Trace_Compare(const char *name)
+**     Description : Check Trace against Golden point by point and by
+**       its response figures; the first point out of band is printed
+**     Parameters  : name - scenario, for the messages
+**     Returns     : 1 if within the tolerances
+** ===================================================================*/
+static int Trace_Compare(const char *name)
+{
+	struct _METRIC m, g;
+	double vlo, vhi, ilo, ihi;
+	int dlo, dhi, state;
+	int i, j, ok = 1;
+
+	if(Trace.Num != Golden.Num)
+	{
+		printf("  %s: %d points, golden %d\n", name, Trace.Num, Golden.Num);
+		return 0;
+	}
+	for(i = 0; i < Trace.Num && ok; i++)
+	{
+		const struct _TRACE_PT *p = &Trace.Pt[i];
+
+		vlo = vhi = Golden.Pt[i].Vout;
+		ilo = ihi = Golden.Pt[i].Iout;
+		dlo = dhi = Golden.Pt[i].Duty;
+		state = 0;
+		for(j = i - TOL_SLACK; j <= i + TOL_SLACK; j++)
+		{
+			const struct _TRACE_PT *q;
+
+			if(j < 0 || j >= Golden.Num)
+				continue;
+			q = &Golden.Pt[j];
+			if(q->Vout < vlo) vlo = q->Vout;
+			if(q->Vout > vhi) vhi = q->Vout;
+			if(q->Iout < ilo) ilo = q->Iout;
+			if(q->Iout > ihi) ihi = q->Iout;
+			if(q->Duty < dlo) dlo = q->Duty;
+			if(q->Duty > dhi) dhi = q->Duty;
+			state |= q->State == p->State && q->Err == p->Err;
+		}
+		ok = p->Vout >= vlo - TOL_VOUT && p->Vout <= vhi + TOL_VOUT
+			&& p->Iout >= ilo - TOL_IOUT && p->Iout <= ihi + TOL_IOUT
+			&& p->Duty >= dlo - TOL_DUTY && p->Duty <= dhi + TOL_DUTY && state;
+		if(!ok)
+			printf("  %s: t=%.3fms Vout %.3f [%.3f, %.3f] Iout %.3f [%.3f, %.3f] duty %d [%d, %d] state %d/%d\n",
+				name, p->T * 1e3, p->Vout, vlo, vhi, p->Iout, ilo, ihi, p->Duty, dlo, dhi, p->State, p->Err);
+	}
+
+	Trace_Metric(&Trace, Rig_Target(), &m);
+	Trace_Metric(&Golden, Rig_Target(), &g);
+	printf("  %-10s Vmax %.3f/%.3f  Vmin %.3f/%.3f  settle %.2f/%.2fms\n", name,
+		m.Max, g.Max, m.Min, g.Min, m.Settle * 1e3, g.Settle * 1e3);
+	if(m.Max > g.Max + TOL_VOUT || m.Max < g.Max - TOL_VOUT || m.Min > g.Min + TOL_VOUT || m.Min < g.Min - TOL_VOUT
+		|| m.Settle > g.Settle + TOL_SETTLE || m.Settle < g.Settle - TOL_SETTLE)
+	{
+		printf("  %s: response figures out of tolerance\n", name);
+		ok = 0;
+	}
+	return ok;
+}
+
+int main(int argc, char **argv)
+{
+	char path[512];
+	int record = argc > 2 && strcmp(argv[1], "--record") == 0;
+	const char *dir = argv[argc - 1];
+	uint32_t i;
+
+	if(argc < 2)
+	{
+		printf("usage: test_trace [--record] <golden dir>\n");
+		return 2;
+	}
+	for(i = 0; i < sizeof(Scn) / sizeof(Scn[0]); i++)
+	{
+		Rig.Probe = 0;
+		Scn[i].Run();
+		Rig.Probe = 0;
+		snprintf(path, sizeof(path), "%s/%s.csv", dir, Scn[i].Name);
+		if(record)
+		{
+			CHECK(Trace_Write(path, &Trace));
+			printf("  %s: %d points\n", path, Trace.Num);
+			continue;
+		}
+		CHECK(Trace_Read(path, &Golden));
+		CHECK(Trace_Compare(Scn[i].Name));
+	}
+	return TEST_END();
+}
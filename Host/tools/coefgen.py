@@ -0,0 +1,251 @@
+#!/usr/bin/env python3
+"""Voltage loop coefficient generator for BUCKVLoopCtlPID().
+
+Designs the compensator for the power stage, discretises it at the control
+rate (one update per PWM period), quantises it to the firmware formats and
+writes Core/Inc/CtlCoef.h:
+
+    python Host/tools/coefgen.py --L 22e-6 --C 470e-6 --esr 0.01 \\
+        --vin 18:30 --fsw 100e3 --fc 3e3 --pm 50 --form 2p2z --verify
+
+The loop is u0 = u1 + a*(u1 - u2) + b0*e0 + b1*e1 + b2*e2, e in Q12 codes,
+u in Q8 of the Q12 buck duty, a in Q10. --form pid keeps a = 0, the
+integrator and two zeros; --form 2p2z adds the second pole. Both zeros sit
+together at a frequency chosen, with the pole, for the phase margin at the
+crossover; the gain sets the crossover at the highest Vin. The stage is the
+buck leg with the boost leg at its fixed duty, seen as a buck from Vin/Db
+through L/Db^2. The loop includes one period of computation delay.
+
+--coef b0 b1 b2 a skips the design and reports and writes the given values.
+--verify builds the host tests against the new header in a temporary
+directory and runs the closed-loop tests and one transient benchmark point.
+Firmware constants (PERIOD, MIN_BOOST_DUTY1, the Vout calibration and the
+duty limits) are read from Core/Inc.
+"""
+import argparse
+import cmath
+import math
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+
+REPO = os.path.abspath(os.path.join(os.path.dirname(__file__), '..', '..'))
+A_Q = 10        # Fraction bits of BUCKPIDa
+U_Q = 8         # Fraction bits of u over the Q12 duty
+
+
+def defines(*names):
+    """Integer #defines of Core/Inc/CtlLoop.h and function.h"""
+    vals = {}
+    for f in ('CtlLoop.h', 'function.h'):
+        with open(os.path.join(REPO, 'Core', 'Inc', f), encoding='latin-1') as h:
+            for line in h:
+                m = re.match(r'\s*#define\s+(\w+)\s+(-?\d+)', line)
+                if m:
+                    vals[m.group(1)] = int(m.group(2))
+    return [vals[n] for n in names]
+
+
+PERIOD, BOOST, CAL_K, CAL_B, DMAX = defines(
+    'PERIOD', 'MIN_BOOST_DUTY1', 'CAL_VOUT_K', 'CAL_VOUT_B', 'MAX_BUCK_DUTY')
+ERR_MAX = (4095 * CAL_K >> 12) + CAL_B      # Largest |Voref - Vout| in codes
+
+
+class Stage(object):
+    def __init__(self, a, vin):
+        self.a, self.vin = a, vin
+        self.T = 1.0 / a.fsw
+        # Timer period in counts, MUL16 from 100kHz up, MUL8 below (SetPWMFrequency)
+        per = (1.6e9 if a.fsw >= 100e3 else 0.8e9) / a.fsw
+        self.db = (PERIOD - (BOOST * PERIOD >> 12)) / per
+        self.kpwm = PERIOD / 4096.0 / (1 << U_Q) / per       # Buck duty per u count
+        self.ksense = a.vgain * CAL_K / 4096.0               # Error codes per volt
+
+    def plant(self, w):
+        """Vout per buck duty, the buck leg into the boost leg at fixed duty"""
+        a, s, db = self.a, 1j * w, self.db
+        L, r = a.L / db ** 2, a.rl / db ** 2
+        R, C, rc = a.rload, a.C, a.esr
+        num = (self.vin / db) * R * (1 + s * C * rc)
+        den = (R + r) + s * (L + C * (r * R + rc * R + r * rc)) + s * s * L * C * (R + rc)
+        return num / den
+
+    def loop(self, w, b, p):
+        z1 = cmath.exp(-1j * w * self.T)
+        comp = (b[0] + b[1] * z1 + b[2] * z1 * z1) / ((1 - z1) * (1 - p * z1))
+        return comp * self.kpwm * self.plant(w) * self.ksense * z1
+
+    def margins(self, b, p):
+        """Crossover Hz, phase margin and gain margin in degrees and dB"""
+        fc = pm = gm = None
+        nyq = 0.5 / self.T
+        prev = None
+        n = 4000
+        for k in range(1, n):
+            f = 10 ** (1 + (math.log10(nyq * 0.999) - 1) * k / n)
+            l = self.loop(2 * math.pi * f, b, p)
+            mag, ph = abs(l), math.degrees(cmath.phase(l))
+            if prev and fc is None and prev[1] >= 1 > mag:
+                # Past -180 the phase wraps to positive values
+                fc, pm = f, (180 + ph if ph <= 0 else ph - 180)
+            if prev and gm is None and prev[2] < -90 and ph >= 0:
+                gm = -20 * math.log10(mag)
+            prev = (f, mag, ph)
+        return fc, pm, gm
+
+
+def zeros(fz, T, g):
+    z = math.exp(-2 * math.pi * fz * T)
+    return [g, -2 * z * g, z * z * g]
+
+
+def design(a, vin_hi):
+    st = Stage(a, vin_hi)
+    wc = 2 * math.pi * a.fc
+    best = None
+    poles = [0.0] if a.form == 'pid' else [math.exp(-2 * math.pi * a.fc * k * st.T) for k in (2, 3, 4, 6, 8, 12, 16)] + [0.0]
+    for i in range(60):
+        fz = a.fc * 10 ** (-1.5 + 1.5 * i / 59)
+        for p in poles:
+            b = zeros(fz, st.T, 1.0)
+            g = 1.0 / abs(st.loop(wc, b, p))
+            q, a_q = quantise([g * c for c in b], p)
+            if q is None:
+                continue
+            # Judge the design as the firmware will run it
+            fc, pm, gm = st.margins(q, a_q / float(1 << A_Q))
+            if fc is None or pm is None:
+                continue
+            ok = pm >= a.pm
+            key = (ok, gm if ok and gm is not None else pm)
+            if best is None or key > best[0]:
+                best = (key, q, a_q, fz)
+    if best is None:
+        sys.exit('coefgen: no stable design, lower --fc')
+    return best[1], best[2], best[3]
+
+
+def quantise(b, p):
+    """Integer b0..b2 and Q10 a. The integral gain b0+b1+b2 is rounded on
+    its own and b1 takes up the difference, so a low zero does not round
+    the integrator away; None if it comes out below one count."""
+    ki = int(round(sum(b)))
+    if ki < 1:
+        return None, None
+    b0, b2 = int(round(b[0])), int(round(b[2]))
+    return [b0, ki - b0 - b2, b2], int(round(p * (1 << A_Q)))
+
+
+def peak(q, a):
+    """Largest |u0| BUCKVLoopCtlPID() can form, with u1, u2 from 0 (pulse skipping) to the duty limit"""
+    hist = DMAX << U_Q
+    return sum(abs(c) for c in q) * ERR_MAX + (DMAX << U_Q) + (abs(a) * hist >> A_Q), abs(a) * hist
+
+
+def header(args, q, a, rows, bound):
+    cmd = ' '.join(['coefgen.py'] + sys.argv[1:])
+    out = ['/**',
+           '  ******************************************************************************',
+           '  * @file    CtlCoef.h',
+           '  * @brief   Voltage loop coefficients, written by Host/tools/coefgen.py.',
+           '  *',
+           '  *          %s' % cmd,
+           '  *          %s L %.1fuH, C %.0fuF, ESR %.0fmohm, RL %.0fmohm, Rload %.1fohm, Vin %sV' % (
+               'Given coefficients, checked on' if args.coef else 'Designed for', args.L * 1e6, args.C * 1e6,
+               args.esr * 1e3, args.rl * 1e3, args.rload, args.vin),
+           '  *          Predicted loop at fsw %.0fkHz, one period delay:' % (args.fsw / 1e3)]
+    for vin, fc, pm, gm in rows:
+        out.append('  *            Vin %5.1fV  fc %s  PM %s  GM %s' % (
+            vin, '%6.0fHz' % fc if fc else '     -', '%5.1fdeg' % pm if pm is not None else '    -',
+            '%5.1fdB' % gm if gm is not None else '    -'))
+    out += ['  *          int32 range: |u0| <= %d, %d bits spare' % (bound, 30 - int(math.log2(bound))),
+            '  ******************************************************************************',
+            '  */',
+            '#ifndef __CTLCOEF_H',
+            '#define __CTLCOEF_H',
+            '',
+            '#define BUCKPIDb0\t%d\t\t//Q8 duty per Q12 error code' % q[0],
+            '#define BUCKPIDb1\t%d\t\t//Q8' % q[1],
+            '#define BUCKPIDb2\t%d\t\t//Q8' % q[2],
+            '#define BUCKPIDa\t%d\t\t\t//Q10, second pole, 0 for the PID form' % a,
+            '',
+            '#endif',
+            '']
+    return '\n'.join(out)
+
+
+def verify(text):
+    tmp = tempfile.mkdtemp()
+    build = os.path.join(tmp, 'build')
+    try:
+        with open(os.path.join(tmp, 'CtlCoef.h'), 'w') as f:
+            f.write(text)
+        subprocess.check_call(['cmake', '-S', REPO, '-B', build, '-DCTL_COEF_DIR=' + tmp], stdout=subprocess.DEVNULL)
+        subprocess.check_call(['cmake', '--build', build, '--target', 'test_plant', 'test_loop', 'bench_transient'],
+                              stdout=subprocess.DEVNULL)
+        status = 0
+        for exe in (['test_loop'], ['test_plant'], ['bench_transient', '--quick']):
+            print('Verify: %s' % ' '.join(exe))
+            r = subprocess.run([os.path.join(build, 'Host', exe[0])] + exe[1:], stdout=subprocess.PIPE,
+                               universal_newlines=True)
+            print(r.stdout.rstrip())
+            status |= r.returncode
+        return status
+    finally:
+        shutil.rmtree(tmp)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument('--L', type=float, default=22e-6, help='inductance, H')
+    ap.add_argument('--C', type=float, default=470e-6, help='output capacitance, F')
+    ap.add_argument('--esr', type=float, default=0.01, help='output capacitor ESR, ohm')
+    ap.add_argument('--rl', type=float, default=0.03, help='inductor and switch resistance, ohm')
+    ap.add_argument('--rload', type=float, default=12.0, help='load for the design, ohm')
+    ap.add_argument('--vin', default='18:30', help='input range min:max, V; the gain is set at max')
+    ap.add_argument('--fsw', type=float, default=100e3, help='switching and control rate, Hz')
+    ap.add_argument('--vgain', type=float, default=2048 / 12.0, help='Vout ADC codes per volt')
+    ap.add_argument('--fc', type=float, default=3e3, help='target crossover, Hz')
+    ap.add_argument('--pm', type=float, default=50.0, help='target phase margin, deg')
+    ap.add_argument('--form', choices=('pid', '2p2z'), default='2p2z')
+    ap.add_argument('--coef', type=int, nargs=4, metavar=('B0', 'B1', 'B2', 'A'), help='report these instead')
+    ap.add_argument('--out', default=os.path.join(REPO, 'Core', 'Inc', 'CtlCoef.h'), help='header to write')
+    ap.add_argument('--dry-run', action='store_true', help='print the header, do not write it')
+    ap.add_argument('--verify', action='store_true', help='run the closed-loop host tests on the result')
+    args = ap.parse_args()
+
+    lo, hi = [float(v) for v in args.vin.split(':')]
+    if args.coef:
+        q, a = args.coef[:3], args.coef[3]
+    else:
+        q, a, fz = design(args, hi)
+        print('Design: %s, zeros at %.0fHz, pole %s' % (args.form, fz,
+              '%.0fHz' % (-math.log(a / float(1 << A_Q)) * args.fsw / 2 / math.pi) if a else 'none'))
+
+    bound, prod = peak(q, a)
+    if bound >= 1 << 31 or prod >= 1 << 31:
+        sys.exit('coefgen: b0..b2 = %s, a = %d can overflow int32 (|u0| up to %d), lower --fc' % (q, a, bound))
+
+    rows = []
+    for vin in (lo, (lo + hi) / 2, hi):
+        fc, pm, gm = Stage(args, vin).margins(q, a / float(1 << A_Q))
+        rows.append((vin, fc, pm, gm))
+        print('  Vin %5.1fV  fc %s  PM %s  GM %s' % (vin, '%6.0fHz' % fc if fc else '     -',
+              '%5.1fdeg' % pm if pm is not None else '    -', '%5.1fdB' % gm if gm is not None else '    -'))
+    print('  b0..b2 = %d %d %d, a = %d, |u0| <= %d' % (q[0], q[1], q[2], a, bound))
+
+    text = header(args, q, a, rows, bound)
+    if args.dry_run:
+        print(text)
+    else:
+        with open(args.out, 'w') as f:
+            f.write(text)
+        print('coefgen: wrote %s' % args.out)
+    return verify(text) if args.verify else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
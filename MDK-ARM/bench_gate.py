@@ -0,0 +1,85 @@
+#!/usr/bin/env python3
+"""Cycle regression gate for the hot path benchmark.
+
+Build with BENCH_ENABLE set in bench.h, capture the boot output on USART2
+into a file and compare it against the baseline of the same build:
+
+    python bench_gate.py boot.log --base bench_armcc.txt
+    python bench_gate.py boot.log --base bench_armcc.txt --update
+
+Prints min, max and mean cycles per call of every item next to the
+baseline. Exits with 1 when the max of an item grew by more than --limit
+cycles, or when the log comes from a different compiler or call count
+than the baseline. --update writes the log's numbers as the new baseline.
+"""
+import argparse
+import re
+import sys
+
+BUILD_RE = re.compile(r'\[BEN\] build (.*\S)')
+ITEM_RE = re.compile(r'\[BEN\] (\w+) min=(\d+) max=(\d+) mean=(\d+) cyc')
+
+
+def parse(path):
+    build, items = None, {}
+    with open(path, encoding='latin-1') as f:
+        for line in f:
+            m = BUILD_RE.search(line)
+            if m:
+                # A later boot in the same capture replaces the earlier one
+                build, items = m.group(1), {}
+                continue
+            m = ITEM_RE.search(line)
+            if m:
+                items[m.group(1)] = tuple(int(v) for v in m.groups()[1:])
+    return build, items
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument('log', help='captured USART2 output with the [BEN] lines')
+    ap.add_argument('--base', required=True, help='baseline, a log of the same build')
+    ap.add_argument('--limit', type=int, default=200, help='fail when max grows by more cycles than this')
+    ap.add_argument('--update', action='store_true', help='write the log as the new baseline')
+    args = ap.parse_args()
+
+    build, items = parse(args.log)
+    if not items:
+        sys.exit('bench_gate: no [BEN] lines in %s, build with BENCH_ENABLE 1' % args.log)
+
+    if args.update:
+        with open(args.base, 'w') as f:
+            f.write('[BEN] build %s\n' % build)
+            for name, (lo, hi, mean) in items.items():
+                f.write('[BEN] %s min=%d max=%d mean=%d cyc\n' % (name, lo, hi, mean))
+        print('bench_gate: baseline %s written, %d items' % (args.base, len(items)))
+        return 0
+
+    try:
+        base_build, base = parse(args.base)
+    except IOError:
+        sys.exit('bench_gate: no baseline %s, run once with --update' % args.base)
+    if base_build != build:
+        sys.exit('bench_gate: log built by %s, baseline by %s' % (build, base_build))
+
+    status = 0
+    print('Cycle benchmark: %s (%s)' % (args.log, build))
+    print('  %-8s %6s %6s %6s %9s %7s' % ('Item', 'Min', 'Max', 'Mean', 'Base max', 'Delta'))
+    for name, (lo, hi, mean) in items.items():
+        note = ''
+        if name in base:
+            delta = hi - base[name][1]
+            if delta > args.limit:
+                note, status = '  error: %d cycles over the limit' % (delta - args.limit), 1
+            print('  %-8s %6d %6d %6d %9d %+7d%s' % (name, lo, hi, mean, base[name][1], delta, note))
+        else:
+            print('  %-8s %6d %6d %6d %9s %7s  new' % (name, lo, hi, mean, '-', '-'))
+    for name in base:
+        if name not in items:
+            print('  %-8s missing from the log' % name)
+            status = 1
+    return status
+
+
+if __name__ == '__main__':
+    sys.exit(main())
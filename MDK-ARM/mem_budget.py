@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+"""Static RAM/flash budget from an armlink map file.
+
+Run by Keil after each build (Options for Target > User > After Build):
+
+    python mem_budget.py "$L@L.map"
+
+Prints the fill level of every load and execution region and the size of
+the RAM consumers: initialised data, zero-init data, heap, stack, no-init
+RAM and the "ccmram" hot-code section. Exits with 1 when a region is over
+the --fail limit so the build output shows the error.
+"""
+import argparse
+import re
+import sys
+
+REGION_RE = re.compile(
+    r'^\s*(Load|Execution) Region (\S+) \((?:Exec base|Base): (0x[0-9a-fA-F]+),'
+    r'.*?Size: (0x[0-9a-fA-F]+), Max: (0x[0-9a-fA-F]+)')
+# Exec Addr, Load Addr (or "-" for ZI), Size, Type, Attr, Idx, [E], Section, Object
+ENTRY_RE = re.compile(
+    r'^\s*(0x[0-9a-fA-F]+)\s+(0x[0-9a-fA-F]+|-)\s+(0x[0-9a-fA-F]+)\s+'
+    r'(Code|Data|Zero|PAD)\s+(\S+)\s+(\d+)?\s*(?:\*\s+)?(\S+)\s*(\S*)')
+
+# Report rows: label, match on (type, attr, section name)
+CATEGORIES = (
+    ('.data',   lambda t, a, s: t == 'Data' and a == 'RW'),
+    ('.bss',    lambda t, a, s: t == 'Zero' and s not in ('HEAP', 'STACK', '.bss.NoInit')),
+    ('heap',    lambda t, a, s: s == 'HEAP'),
+    ('stack',   lambda t, a, s: s == 'STACK'),
+    ('noinit',  lambda t, a, s: s == '.bss.NoInit'),
+    ('ccmram',  lambda t, a, s: s == 'ccmram'),
+)
+
+
+def parse(path):
+    regions = []
+    sizes = dict((name, 0) for name, _ in CATEGORIES)
+    where = dict((name, set()) for name, _ in CATEGORIES)
+    region = None
+    with open(path, encoding='latin-1') as f:
+        for line in f:
+            m = REGION_RE.match(line)
+            if m:
+                kind, name, base, size, limit = m.groups()
+                regions.append((kind, name, int(base, 16), int(size, 16), int(limit, 16)))
+                region = name if kind == 'Execution' else None
+                continue
+            if region is None:
+                continue
+            m = ENTRY_RE.match(line)
+            if not m:
+                continue
+            size, typ, attr, sec = int(m.group(3), 16), m.group(4), m.group(5), m.group(7)
+            for name, match in CATEGORIES:
+                if match(typ, attr, sec):
+                    sizes[name] += size
+                    where[name].add(region)
+                    break
+    return regions, sizes, where
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument('map', help='armlink .map file')
+    ap.add_argument('--warn', type=float, default=85.0, help='warn above this fill level, %%')
+    ap.add_argument('--fail', type=float, default=100.0, help='fail above this fill level, %%')
+    args = ap.parse_args()
+
+    regions, sizes, where = parse(args.map)
+    if not regions:
+        sys.exit('mem_budget: no region table in %s, link with --map --info=sizes,totals' % args.map)
+
+    status = 0
+    print('Memory budget: %s' % args.map)
+    print('  %-10s %-9s %-10s %8s %8s %6s' % ('Region', 'Kind', 'Base', 'Used', 'Max', 'Fill'))
+    for kind, name, base, size, limit in regions:
+        fill = 100.0 * size / limit if limit else 0.0
+        note = ''
+        if fill > args.fail:
+            note, status = '  error: over budget', 1
+        elif fill > args.warn:
+            note = '  warning: above %.0f%%' % args.warn
+        print('  %-10s %-9s 0x%08X %8d %8d %5.1f%%%s' % (name, kind, base, size, limit, fill, note))
+
+    print('  %-10s %8s  %s' % ('Section', 'Bytes', 'Region'))
+    for name, _ in CATEGORIES:
+        print('  %-10s %8d  %s' % (name, sizes[name], ', '.join(sorted(where[name])) or '-'))
+    return status
+
+
+if __name__ == '__main__':
+    sys.exit(main())
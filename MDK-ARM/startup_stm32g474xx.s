@@ -59,14 +59,19 @@ __heap_limit
                 EXPORT  __Vectors
                 EXPORT  __Vectors_End
                 EXPORT  __Vectors_Size
+                IMPORT  BB_NMI_Handler
+                IMPORT  BB_HardFault_Handler
+                IMPORT  BB_MemManage_Handler
+                IMPORT  BB_BusFault_Handler
+                IMPORT  BB_UsageFault_Handler
 
 __Vectors       DCD     __initial_sp               ; Top of Stack
                 DCD     Reset_Handler              ; Reset Handler
-                DCD     NMI_Handler                ; NMI Handler
-                DCD     HardFault_Handler          ; Hard Fault Handler
-                DCD     MemManage_Handler          ; MPU Fault Handler
-                DCD     BusFault_Handler           ; Bus Fault Handler
-                DCD     UsageFault_Handler         ; Usage Fault Handler
+                DCD     BB_NMI_Handler             ; NMI Handler, black box entry in stm32g4xx_it.c
+                DCD     BB_HardFault_Handler       ; Hard Fault Handler, black box entry in stm32g4xx_it.c
+                DCD     BB_MemManage_Handler       ; MPU Fault Handler, black box entry in stm32g4xx_it.c
+                DCD     BB_BusFault_Handler        ; Bus Fault Handler, black box entry in stm32g4xx_it.c
+                DCD     BB_UsageFault_Handler      ; Usage Fault Handler, black box entry in stm32g4xx_it.c
                 DCD     0                          ; Reserved
                 DCD     0                          ; Reserved
                 DCD     0                          ; Reserved